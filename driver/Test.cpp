@@ -2,9 +2,11 @@
 #include <fstream>
 #include <filesystem>
 #include <functional>
+#include <optional>
 #include "../shared/Components.h"
 #include "../shared/Dump.h"
 #include "../shared/DocTree2Json.h"
+#include "../shared/MappedFile.hpp"
 
 //#define DEBUG
 
@@ -28,36 +30,23 @@ int main(int argc, char* argv[])
     if ((argc == 2 || argc == 3) && argVector[1] == "--parse") {
         int retVal = 0;
         const auto inputPath = argc == 2 ? "" : argVector[2];
-        std::list<std::fstream*> openedFileStreams;
-        auto getStreamForDiskFile = [&openedFileStreams](const std::string& path, std::ios_base::openmode mode) -> std::iostream* {
-            if ((mode & std::ios::out) && !std::filesystem::exists(path)) {
-                std::ofstream(path, std::ios::out).close();
-            }
-            auto file = new std::fstream(path, mode);
-            if (!file->is_open()) {
-                throw std::runtime_error("unable to open " + path);
-            }
-            openedFileStreams.push_back(file);
-            return file;
-        };
-        std::istream* inputStream;
-		if (inputPath.empty() || inputPath == "-") {
-			inputStream = &std::cin;
-		}
-		else if (std::filesystem::is_regular_file(inputPath)) {
-            inputStream = getStreamForDiskFile(inputPath, std::ios::in);
-        }
-        else {
+        if (!inputPath.empty() && inputPath != "-" && !std::filesystem::is_regular_file(inputPath)) {
             std::cerr << "input path is not a file" << std::endl;
             return 1;
         }
 #ifndef DEBUG
         try {
 #endif // DEBUG
+            // stdin cannot be mapped, it is read into a buffer by the lexer
+            std::optional<MappedFile> inputFile;
+            if (!inputPath.empty() && inputPath != "-") {
+                inputFile.emplace(inputPath);
+            }
             std::vector<std::tuple<std::string, FilePosition::Region>> errors;
             std::vector<std::tuple<std::string, FilePosition::Region>> warnings;
-            auto [tokenList, lexErrors, lexWarnings] = TomlLexerMain(*inputStream, true);
-            auto [docTree, parseErrors, parseWarnings, tokenDocTreeMapping] = TomlRdparserMain(tokenList);
+            auto [tokenList, lexErrors, lexWarnings] = inputFile ? TomlLexerMain(inputFile->view(), true) : TomlLexerMain(std::cin, true);
+            auto [document, parseErrors, parseWarnings, tokenDocTreeMapping] = TomlRdparserMain(tokenList);
+            auto docTree = document->getRoot();
             errors.insert(errors.end(), lexErrors.begin(), lexErrors.end());
             errors.insert(errors.end(), parseErrors.begin(), parseErrors.end());
             warnings.insert(warnings.end(), lexWarnings.begin(), lexWarnings.end());
@@ -81,9 +70,9 @@ int main(int argc, char* argv[])
             }
 #endif // DEBUG
 
-            std::cout << DocTree::toJson(docTree, true) << std::endl;
+            DocTree::writeJson(docTree, true, std::cout);
+            std::cout << std::endl;
 
-            delete docTree;
             retVal = errors.size() ? 1 : 0;
 #ifndef DEBUG
         }
@@ -92,11 +81,6 @@ int main(int argc, char* argv[])
             return 1;
         }
 #endif // DEBUG
-        for (auto& openedFileStream : openedFileStreams) {
-            openedFileStream->flush();
-            openedFileStream->close();
-            delete openedFileStream;
-        }
         return retVal;
     }
     else if (argc == 2 && (argVector[1] == "--help" || argVector[1] == "-h")) {
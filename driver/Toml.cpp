@@ -3,9 +3,19 @@
 #include <sstream>
 #include <filesystem>
 #include <functional>
+#include <list>
+#include <charconv>
 #include "../shared/Components.h"
 #include "../shared/Dump.h"
 #include "../shared/DocTree2Json.h"
+#include "../shared/DocTree2Binary.h"
+#include "../shared/DocSnapshot.h"
+#include "../shared/MappedFile.hpp"
+
+#ifdef _WIN32
+#include <io.h>
+#include <fcntl.h>
+#endif // _WIN32
 
 #ifndef STDIO_ONLY
 #include "../shared/UniSock.hpp"
@@ -32,8 +42,12 @@ int main(int argc, char* argv[]) {
     };
     auto printHelp = [&argVector](std::ostream& stream) {
         stream << "Usage:\n"
-            << argVector[0] << " --parse <path>[ --validate=<path>][ --schema=<name>][ --output=<path>]\n"
-            << argVector[0] << " --parse <path>[ --validate <path>][ --schema <name>][ --output <path>]\n"
+            << argVector[0] << " --parse <path>[ --validate=<path>][ --schema=<name>][ --output=<path>][ --output-format=json|cbor|msgpack][ --pretty]\n"
+            << argVector[0] << " --parse <path>[ --validate <path>][ --schema <name>][ --output <path>][ --output-format json|cbor|msgpack][ --pretty]\n"
+            << argVector[0] << " --compile <path>[ --output=<path>][ --with-regions]\n"
+            << argVector[0] << " --compile <path>[ --output <path>][ -o <path>][ --with-regions]\n"
+            << argVector[0] << " --query <snapshot> <key>[.<key>|.<index>...][ --source=<path>]\n"
+            << argVector[0] << " --query <snapshot> <key>[.<key>|.<index>...][ --source <path>]\n"
             << argVector[0] << " --langsvr --stdio\n"
 #ifndef STDIO_ONLY
             << argVector[0] << " --langsvr --socket=<port>\n"
@@ -48,12 +62,10 @@ int main(int argc, char* argv[]) {
     };
     if (argc >= 3 && argVector[1] == "--langsvr") {
         auto tomlStringLexer = [](const std::string& input, bool multilineToken) -> std::tuple<Token::TokenList<>, std::vector<std::tuple<std::string, FilePosition::Region>>, std::vector<std::tuple<std::string, FilePosition::Region>>> {
-            std::istringstream stream(input);
-            return TomlLexerMain(stream, multilineToken);
+            return TomlLexerMain(std::string_view(input), multilineToken);
         };
         auto cslStringLexer = [](const std::string& input, bool multilineToken) -> std::tuple<Token::TokenList<>, std::vector<std::tuple<std::string, FilePosition::Region>>, std::vector<std::tuple<std::string, FilePosition::Region>>> {
-            std::istringstream stream(input);
-            return CslLexerMain(stream, multilineToken);
+            return CslLexerMain(std::string_view(input), multilineToken);
             };
         int retVal = 1;
         if (argc == 3 && argVector[2] == "--stdio") {
@@ -139,6 +151,8 @@ int main(int argc, char* argv[]) {
         std::string cslPath;
         std::string cslSchemaName;
         std::string outputPath;
+        std::string outputFormat = "json";
+        int jsonIndent = -1;
         for (size_t i = 3; i < argVector.size(); ++i) {
             const std::string& arg = argv[i];
 
@@ -201,6 +215,31 @@ int main(int argc, char* argv[]) {
                 }
             }
 
+            // Check for --output-format
+            else if (arg.rfind("--output-format=", 0) == 0) {
+                outputFormat = arg.substr(16); // skip "--output-format="
+            }
+            else if (arg == "--output-format") {
+                if (i + 1 < argVector.size()) {
+                    outputFormat = argVector[i + 1];
+                    ++i; // skip next since it's used
+                }
+                else {
+                    printInfo(std::cerr);
+                    std::cerr << "invalid arguments:" << arg;
+                    for (const auto& arg : argVector) {
+                        std::cerr << " " << arg;
+                    }
+                    std::cerr << "\n";
+                    return 2;
+                }
+            }
+
+            // Check for --pretty
+            else if (arg == "--pretty") {
+                jsonIndent = 4;
+            }
+
             else {
                 printInfo(std::cerr);
                 std::cerr << "invalid arguments:" << arg;
@@ -211,8 +250,16 @@ int main(int argc, char* argv[]) {
                 return 2;
             }
         }
+        if (outputFormat != "json" && outputFormat != "cbor" && outputFormat != "msgpack") {
+            printInfo(std::cerr);
+            std::cerr << "invalid output format: " << outputFormat << "\n";
+            return 2;
+        }
         const auto inputPath = argVector[2];
-        printInfo(std::cout);
+        // Binary output on standard output is left alone for decoders to
+        // read, so everything else goes to standard error
+        bool isBinaryToStdout = outputFormat != "json" && outputPath.empty();
+        printInfo(isBinaryToStdout ? std::cerr : std::cout);
         std::list<std::fstream*> openedFileStreams;
         auto getStreamForDiskFile = [&openedFileStreams](const std::string& path, std::ios_base::openmode mode) -> std::iostream* {
             if ((mode & std::ios::out) && !std::filesystem::exists(path)) {
@@ -229,20 +276,21 @@ int main(int argc, char* argv[]) {
 #ifndef DEBUG
             try {
 #endif // DEBUG
-                auto inputStream = getStreamForDiskFile(inputPath, std::ios::in);
+                MappedFile inputFile(inputPath);
                 std::vector<std::tuple<std::string, FilePosition::Region>> errors;
                 std::vector<std::tuple<std::string, FilePosition::Region>> warnings;
-                auto [tomlTokenList, tomlLexErrors, tomlLexWarnings] = TomlLexerMain(*inputStream, true);
-                auto [docTree, tomlParseErrors, tomlParseWarnings, tokenDocTreeMapping] = TomlRdparserMain(tomlTokenList);
+                auto [tomlTokenList, tomlLexErrors, tomlLexWarnings] = TomlLexerMain(inputFile.view(), true);
+                auto [document, tomlParseErrors, tomlParseWarnings, tokenDocTreeMapping] = TomlRdparserMain(tomlTokenList);
+                auto docTree = document->getRoot();
                 errors.insert(errors.end(), tomlLexErrors.begin(), tomlLexErrors.end());
                 errors.insert(errors.end(), tomlParseErrors.begin(), tomlParseErrors.end());
                 warnings.insert(warnings.end(), tomlLexWarnings.begin(), tomlLexWarnings.end());
                 warnings.insert(warnings.end(), tomlParseWarnings.begin(), tomlParseWarnings.end());
                 if (cslPath.size() && std::filesystem::is_regular_file(cslPath)) {
-                    auto cslInputStream = getStreamForDiskFile(cslPath, std::ios::in);
-                    auto [cslTokenList, cslLexErrors, cslLexWarnings] = CslLexerMain(*cslInputStream, false);
+                    MappedFile cslInputFile(cslPath);
+                    auto [cslTokenList, cslLexErrors, cslLexWarnings] = CslLexerMain(cslInputFile.view(), false);
                     auto [schemas, cslParseErrors, cslParseWarnings] = CslRdParserMain(cslTokenList);
-                    auto [cslValidationErrors, cslValidationWarnings] = CslValidatorMain("BuildConfig", schemas, docTree);
+                    auto [cslValidationErrors, cslValidationWarnings] = CslValidatorMain("BuildConfig", schemas, document.get());
                     errors.insert(errors.end(), cslLexErrors.begin(), cslLexErrors.end());
                     errors.insert(errors.end(), cslParseErrors.begin(), cslParseErrors.end());
                     errors.insert(errors.end(), cslValidationErrors.begin(), cslValidationErrors.end());
@@ -268,10 +316,28 @@ int main(int argc, char* argv[]) {
                     }
                 }
 
-                std::ostream& outputStream = outputPath.empty() ? std::cout << "\nJSON:\n" : *getStreamForDiskFile(outputPath, std::ios::out);
-                outputStream << DocTree::toJson(docTree, false) << std::endl;
+                if (outputFormat == "json") {
+                    std::ostream& outputStream = outputPath.empty() ? std::cout << "\nJSON:\n" : *getStreamForDiskFile(outputPath, std::ios::out);
+                    DocTree::writeJson(docTree, false, outputStream, jsonIndent);
+                    outputStream << std::endl;
+                }
+                else {
+#ifdef _WIN32
+                    if (isBinaryToStdout) {
+                        std::cout.flush();
+                        _setmode(_fileno(stdout), _O_BINARY);
+                    }
+#endif // _WIN32
+                    std::ostream& outputStream = isBinaryToStdout ? std::cout : *getStreamForDiskFile(outputPath, std::ios::out | std::ios::binary);
+                    if (outputFormat == "cbor") {
+                        DocTree::writeCbor(docTree, outputStream);
+                    }
+                    else {
+                        DocTree::writeMsgPack(docTree, outputStream);
+                    }
+                    outputStream.flush();
+                }
 
-                delete docTree;
                 retVal = errors.size() + warnings.size() ? 1 : 0;
 #ifndef DEBUG
             }
@@ -293,6 +359,136 @@ int main(int argc, char* argv[]) {
         }
         return retVal;
     }
+    else if (argc >= 3 && argVector[1] == "--compile") {
+        const auto inputPath = argVector[2];
+        std::string outputPath = inputPath + "c";
+        bool withRegions = false;
+        for (size_t i = 3; i < argVector.size(); ++i) {
+            const std::string& arg = argVector[i];
+            if (arg.rfind("--output=", 0) == 0) {
+                outputPath = arg.substr(9); // skip "--output="
+            }
+            else if ((arg == "--output" || arg == "-o") && i + 1 < argVector.size()) {
+                outputPath = argVector[i + 1];
+                ++i; // skip next since it's used
+            }
+            else if (arg == "--with-regions") {
+                withRegions = true;
+            }
+            else {
+                printInfo(std::cerr);
+                std::cerr << "invalid arguments:" << arg;
+                for (const auto& arg : argVector) {
+                    std::cerr << " " << arg;
+                }
+                std::cerr << "\n";
+                return 2;
+            }
+        }
+        if (!std::filesystem::is_regular_file(inputPath)) {
+            printInfo(std::cerr);
+            std::cerr << "file " << inputPath << "is not valid\n";
+            return 1;
+        }
+#ifndef DEBUG
+        try {
+#endif // DEBUG
+            MappedFile inputFile(inputPath);
+            auto [tomlTokenList, tomlLexErrors, tomlLexWarnings] = TomlLexerMain(inputFile.view(), true);
+            auto [document, tomlParseErrors, tomlParseWarnings, tokenDocTreeMapping] = TomlRdparserMain(tomlTokenList);
+            std::vector<std::tuple<std::string, FilePosition::Region>> errors;
+            errors.insert(errors.end(), tomlLexErrors.begin(), tomlLexErrors.end());
+            errors.insert(errors.end(), tomlParseErrors.begin(), tomlParseErrors.end());
+            // A snapshot is only written for a document without errors,
+            // so loading one never needs to report them
+            if (errors.size()) {
+                std::cerr << "\nErrors in " << inputPath << ":\n";
+                for (const auto& error : errors) {
+                    auto errorStart = std::get<1>(error).start;
+                    std::cerr << "Error (line " << errorStart.line << ", col " << errorStart.column << "): " << std::get<0>(error) << "\n";
+                }
+                return 1;
+            }
+            std::ofstream outputFile(outputPath, std::ios::out | std::ios::binary);
+            if (!outputFile.is_open()) {
+                throw std::runtime_error("unable to open " + outputPath);
+            }
+            DocSnapshot::writeSnapshot(document->getRoot(), inputFile.view(), withRegions, outputFile);
+            outputFile.close();
+            if (!outputFile) {
+                throw std::runtime_error("unable to write " + outputPath);
+            }
+#ifndef DEBUG
+        }
+        catch (const std::exception& e) {
+            std::cerr << e.what() << '\n';
+            return 1;
+        }
+#endif // DEBUG
+        return 0;
+    }
+    else if (argc >= 4 && argVector[1] == "--query") {
+        const auto snapshotPath = argVector[2];
+        const auto keyPath = argVector[3];
+        std::string sourcePath;
+        for (size_t i = 4; i < argVector.size(); ++i) {
+            const std::string& arg = argVector[i];
+            if (arg.rfind("--source=", 0) == 0) {
+                sourcePath = arg.substr(9); // skip "--source="
+            }
+            else if (arg == "--source" && i + 1 < argVector.size()) {
+                sourcePath = argVector[i + 1];
+                ++i; // skip next since it's used
+            }
+            else {
+                printInfo(std::cerr);
+                std::cerr << "invalid arguments:" << arg;
+                for (const auto& arg : argVector) {
+                    std::cerr << " " << arg;
+                }
+                std::cerr << "\n";
+                return 2;
+            }
+        }
+#ifndef DEBUG
+        try {
+#endif // DEBUG
+            DocSnapshot::Snapshot snapshot(snapshotPath);
+            if (sourcePath.size() && !snapshot.isCurrentFor(MappedFile(sourcePath).view())) {
+                std::cerr << snapshotPath << " is stale for " << sourcePath << "\n";
+                return 1;
+            }
+            // Keys are written as a TOML dotted key, and elements of arrays
+            // are selected by their index
+            auto node = snapshot.getRoot();
+            for (const auto& key : DocSnapshot::parseKeyPath(keyPath)) {
+                std::optional<DocSnapshot::Node> next;
+                if (node.getKind() == DocSnapshot::ValueKind::Array) {
+                    size_t index = 0;
+                    auto [last, error] = std::from_chars(key.data(), key.data() + key.size(), index);
+                    if (error == std::errc() && last == key.data() + key.size() && index < node.size()) {
+                        next = node[index];
+                    }
+                }
+                else {
+                    next = node.find(key);
+                }
+                if (!next) {
+                    std::cerr << "key " << key << " of " << keyPath << " is not defined\n";
+                    return 1;
+                }
+                node = *next;
+            }
+            std::cout << DocSnapshot::toJson(node).dump() << std::endl;
+#ifndef DEBUG
+        }
+        catch (const std::exception& e) {
+            std::cerr << e.what() << '\n';
+            return 1;
+        }
+#endif // DEBUG
+        return 0;
+    }
     else if (argc == 2 && (argVector[1] == "--help" || argVector[1] == "-h")) {
         printInfo(std::cout);
         printHelp(std::cout);
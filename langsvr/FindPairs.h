@@ -8,8 +8,8 @@
 #include <unordered_map>
 #include <string>
 
-template<typename V>
-std::vector<std::pair<std::string, V>> findPairs(const std::unordered_map<std::string, V>& map, const std::string& input) {
+template<typename Map, typename V = typename Map::mapped_type>
+std::vector<std::pair<std::string, V>> findPairs(const Map& map, const std::string& input) {
     std::vector<std::pair<std::string, V>> result;
     std::unordered_set<char> inputChars;
 
@@ -182,6 +182,8 @@ protected:
     CslParserFunction cslParser;
     CslValidatorFunction cslValidator;
     std::unordered_map<std::string, std::string> documentCache;
+    // Kept between formatting requests so its storage is reused
+    std::string formattingBuffer;
     std::vector<std::shared_ptr<CSL::ConfigSchema>> cslSchemas;
     std::string currentCslSchema;
     std::unordered_map<size_t, std::function<void(const json&)>> responseCallbacks;
@@ -478,19 +480,18 @@ protected:
         std::vector<std::tuple<std::string, FilePosition::Region>> errors;
         std::vector<std::tuple<std::string, FilePosition::Region>> warnings;
         auto [tokenList, lexErrors, lexWarnings] = tomlLexer(it->second, clientSupportsMultilineToken);
-        auto [docTree, parseErrors, parseWarnings, tokenDocTreeMapping] = tomlParser(tokenList);
+        auto [document, parseErrors, parseWarnings, tokenDocTreeMapping] = tomlParser(tokenList);
         errors.insert(errors.end(), lexErrors.begin(), lexErrors.end());
         errors.insert(errors.end(), parseErrors.begin(), parseErrors.end());
         warnings.insert(warnings.end(), lexWarnings.begin(), lexWarnings.end());
         warnings.insert(warnings.end(), parseWarnings.begin(), parseWarnings.end());
         if (cslSchemas.size()) {
-            auto [cslErrors, cslWarnings] = cslValidator(currentCslSchema, cslSchemas, docTree);
+            auto [cslErrors, cslWarnings] = cslValidator(currentCslSchema, cslSchemas, document.get());
             errors.insert(errors.end(), cslErrors.begin(), cslErrors.end());
             warnings.insert(warnings.end(), cslWarnings.begin(), cslWarnings.end());
         }
         json diagnostics = genDiagnosticsFromErrorWarningList(errors, warnings);
 
-        delete docTree;
         tokenList.clear();
 
         return diagnostics;
@@ -532,14 +533,13 @@ protected:
 
         // Get tokens with positions
         auto [tokenList, lexErrors, lexWarnings] = tomlLexer(it->second, clientSupportsMultilineToken);
-        auto [docTree, parseErrors, parseWarnings, tokenDocTreeMapping] = tomlParser(tokenList);
-        auto tokens = tokenList.GetTokenList();
-
+        auto [document, parseErrors, parseWarnings, tokenDocTreeMapping] = tomlParser(tokenList);
         std::vector<size_t> data;
+        data.reserve(tokenList.size() * 5);
         size_t prevLine = 0;
         size_t prevChar = 0;
 
-        for (const auto& token : tokens) {
+        for (const auto& token : tokenList) {
             auto [content, type, prop, region] = token;
 
             // Calculate delta positions
@@ -555,7 +555,6 @@ protected:
             prevChar = region.start.column.getValue();
         }
 
-        delete docTree;
         tokenList.clear();
 
         json result;
@@ -568,14 +567,19 @@ protected:
         );
     }
 
-    size_t getTokenTypeIndex(const std::string& type, Type::Type* prop) {
-        static const std::vector<std::string> types = {
-            "datetime", "number", "boolean", "identifier",
-            "punctuator", "operator", "comment", "string", "unknown"
-        };
-
-        auto it = std::find(types.begin(), types.end(), type);
-        return it != types.end() ? std::distance(types.begin(), it) : 8;
+    // Index of the token kind in the legend of tokenTypes
+    size_t getTokenTypeIndex(Token::TokenKind type, Type::Type* prop) {
+        switch (type) {
+        case Token::TokenKind::Datetime: return 0;
+        case Token::TokenKind::Number: return 1;
+        case Token::TokenKind::Boolean: return 2;
+        case Token::TokenKind::Identifier: return 3;
+        case Token::TokenKind::Punctuator: return 4;
+        case Token::TokenKind::Operator: return 5;
+        case Token::TokenKind::Comment: return 6;
+        case Token::TokenKind::String: return 7;
+        default: return 8;
+        }
     }
 
     json handleFormatting(const json& request) {
@@ -586,11 +590,12 @@ protected:
         }
         // Perform formatting here
         auto [tokenList, lexErrors, lexWarnings] = tomlLexer(it->second, clientSupportsMultilineToken);
-        auto [docTree, parseErrors, parseWarnings, tokenDocTreeMapping] = tomlParser(tokenList);
-        auto newToml = DocTree::toToml(docTree);
-        auto edits = computeEdits(it->second, newToml);
+        auto [document, parseErrors, parseWarnings, tokenDocTreeMapping] = tomlParser(tokenList);
+        auto docTree = document->getRoot();
+        formattingBuffer.clear();
+        DocTree::appendToml(docTree, formattingBuffer);
+        auto edits = computeEdits(it->second, formattingBuffer);
 
-        delete docTree;
         tokenList.clear();
 
         json result;
@@ -625,26 +630,25 @@ protected:
         }
         FilePosition::Position position = { { request["params"]["position"]["line"].get<size_t>(), false }, { request["params"]["position"]["character"].get<size_t>(), false } };
         auto [tokenList, lexErrors, lexWarnings] = tomlLexer(it->second, clientSupportsMultilineToken);
-        auto [docTree, parseErrors, parseWarnings, tokenDocTreeMapping] = tomlParser(tokenList);
+        auto [document, parseErrors, parseWarnings, tokenDocTreeMapping] = tomlParser(tokenList);
 		json definition = json::object();
-        for (auto tokenListIterator = tokenList.begin(); tokenListIterator != tokenList.end(); ++tokenListIterator) {
+        for (auto tokenListIterator = tokenList.FindToken(position); tokenListIterator != tokenList.end() && std::get<3>(*tokenListIterator).start <= position; ++tokenListIterator) {
             const auto& token = *tokenListIterator;
             if (std::get<3>(token).contains(position)) {
-                auto tokenIndex = std::distance(tokenList.begin(), tokenListIterator);
-                if (tokenDocTreeMapping.find(tokenIndex) == tokenDocTreeMapping.end()) {
+                auto targetKey = tokenDocTreeMapping[tokenListIterator.GetIndex()];
+                if (!targetKey) {
                     continue;
                 }
-                auto targetKey = tokenDocTreeMapping[std::distance(tokenList.begin(), tokenListIterator)];
-                if (auto table = dynamic_cast<DocTree::Table*>(std::get<1>(targetKey->get()))) {
-                    auto tableRegion = std::get<2>(table->get());
+                if (auto table = DocTree::nodeCast<DocTree::Table>(targetKey->getValue())) {
+                    auto tableRegion = table->getDefPos();
                     definition["uri"] = uri;
                     definition["range"]["start"]["line"] = tableRegion.start.line.getValue();
                     definition["range"]["start"]["character"] = tableRegion.start.column.getValue();
                     definition["range"]["end"]["line"] = tableRegion.end.line.getValue();
                     definition["range"]["end"]["character"] = tableRegion.end.column.getValue();
                 }
-                else if (auto array = dynamic_cast<DocTree::Array*>(std::get<1>(targetKey->get()))) {
-                    auto arrayRegion = std::get<2>(array->get());
+                else if (auto array = DocTree::nodeCast<DocTree::Array>(targetKey->getValue())) {
+                    auto arrayRegion = array->getDefPos();
                     definition["uri"] = uri;
                     definition["range"]["start"]["line"] = arrayRegion.start.line.getValue();
                     definition["range"]["start"]["character"] = arrayRegion.start.column.getValue();
@@ -653,7 +657,6 @@ protected:
                 }
             }
         }
-        delete docTree;
         tokenList.clear();
         return genResponse(
             request["id"].get<size_t>(),
@@ -665,7 +668,8 @@ protected:
     std::shared_ptr<CSL::TableType> findTableType(
         DocTree::Table* currentDocTable,
         DocTree::Table* targetTable,
-        const std::shared_ptr<CSL::TableType>& currentSchemaType
+        const std::shared_ptr<CSL::TableType>& currentSchemaType,
+        const DocTree::KeyInterner& keyInterner
     ) {
         if (currentDocTable == targetTable) {
             return currentSchemaType;
@@ -675,16 +679,23 @@ protected:
         const auto& schemaExplicitKeys = currentSchemaType->getExplicitKeys();
         const auto& schemaWildcardKey = currentSchemaType->getWildcardKey();
 
+        // Schema key names as interned by the document, to be matched
+        // against the document keys by pointer
+        std::vector<std::string_view> schemaKeyNames;
+        for (const auto& keyDef : schemaExplicitKeys) {
+            schemaKeyNames.push_back(keyInterner.find(keyDef.name));
+        }
+
         for (const auto& [keyName, keyNode] : docElems) {
-            auto valueNode = std::get<1>(keyNode->get());
-            if (auto childDocTable = dynamic_cast<DocTree::Table*>(valueNode)) {
+            auto valueNode = keyNode->getValue();
+            if (auto childDocTable = DocTree::nodeCast<DocTree::Table>(valueNode)) {
                 std::shared_ptr<CSL::CSLType> childSchemaType;
 
                 // Check explicit keys
-                auto it = std::find_if(schemaExplicitKeys.begin(), schemaExplicitKeys.end(),
-                    [&](const CSL::TableType::KeyDefinition& kd) { return kd.name == keyName; });
-                if (it != schemaExplicitKeys.end()) {
-                    childSchemaType = it->type;
+                auto it = std::find_if(schemaKeyNames.begin(), schemaKeyNames.end(),
+                    [&](std::string_view name) { return name.data() == keyName.data(); });
+                if (it != schemaKeyNames.end()) {
+                    childSchemaType = schemaExplicitKeys[it - schemaKeyNames.begin()].type;
                 }
                 // Check wildcard
                 else if (schemaWildcardKey) {
@@ -697,7 +708,7 @@ protected:
                 // Handle TableType
                 if (childSchemaType->getKind() == CSL::CSLType::Kind::Table) {
                     auto childSchemaTable = std::static_pointer_cast<CSL::TableType>(childSchemaType);
-                    auto result = findTableType(childDocTable, targetTable, childSchemaTable);
+                    auto result = findTableType(childDocTable, targetTable, childSchemaTable, keyInterner);
                     if (result) return result;
                 }
                 // Handle UnionType
@@ -706,7 +717,7 @@ protected:
                     for (const auto& memberType : unionType->getMemberTypes()) {
                         if (memberType->getKind() == CSL::CSLType::Kind::Table) {
                             auto memberTable = std::static_pointer_cast<CSL::TableType>(memberType);
-                            auto result = findTableType(childDocTable, targetTable, memberTable);
+                            auto result = findTableType(childDocTable, targetTable, memberTable, keyInterner);
                             if (result) return result;
                         }
                     }
@@ -719,12 +730,12 @@ protected:
 
     std::shared_ptr<CSL::TableType> getTableTypeForDocTable(
         DocTree::Table* targetTable,
-        DocTree::Table* docTree,
+        const DocTree::Document* document,
         const std::shared_ptr<CSL::ConfigSchema>& schema
     ) {
-        if (!docTree || !schema) return nullptr;
+        if (!document || !schema) return nullptr;
         auto rootSchemaType = schema->getRootTable();
-        return findTableType(docTree, targetTable, rootSchemaType);
+        return findTableType(document->getRoot(), targetTable, rootSchemaType, document->getKeyInterner());
     }
 
     json handleCompletion(const json& request) {
@@ -735,22 +746,24 @@ protected:
         }
         FilePosition::Position position = { { request["params"]["position"]["line"].get<size_t>(), false }, { request["params"]["position"]["character"].get<size_t>(), false } };
         auto [tokenList, lexErrors, lexWarnings] = tomlLexer(it->second, clientSupportsMultilineToken);
-        auto [docTree, parseErrors, parseWarnings, tokenDocTreeMapping] = tomlParser(tokenList);
+        auto [document, parseErrors, parseWarnings, tokenDocTreeMapping] = tomlParser(tokenList);
+        auto docTree = document->getRoot();
         auto completions = json::array();
         DocTree::Table* lastDefinedTable = docTree;
         for (auto tokenListIterator = tokenList.begin(); tokenListIterator != tokenList.end(); ++tokenListIterator) {
             const auto& token = *tokenListIterator;
-            if (std::get<1>(token) == "identifier" && std::next(tokenListIterator) != tokenList.end() && std::get<0>(*std::next(tokenListIterator)) == "]") {
-                auto lastDefinedTableKeyIndex = std::distance(tokenList.begin(), tokenListIterator);
-                if (tokenDocTreeMapping.find(lastDefinedTableKeyIndex) != tokenDocTreeMapping.end()) {
-                    auto lastDefinedTableKeyValue = std::get<1>(tokenDocTreeMapping[lastDefinedTableKeyIndex]->get());
-                    if (dynamic_cast<DocTree::Table*>(lastDefinedTableKeyValue)) {
-                        lastDefinedTable = dynamic_cast<DocTree::Table*>(lastDefinedTableKeyValue);
+            if (std::get<1>(token) == Token::TokenKind::Identifier && std::next(tokenListIterator) != tokenList.end() && std::get<0>(*std::next(tokenListIterator)) == "]") {
+                auto lastDefinedTableKey = tokenDocTreeMapping[tokenListIterator.GetIndex()];
+                if (lastDefinedTableKey) {
+                    auto lastDefinedTableKeyValue = lastDefinedTableKey->getValue();
+                    if (DocTree::nodeCast<DocTree::Table>(lastDefinedTableKeyValue)) {
+                        lastDefinedTable = DocTree::nodeCast<DocTree::Table>(lastDefinedTableKeyValue);
                     }
-                    else if (auto keyArrayValue = dynamic_cast<DocTree::Array*>(lastDefinedTableKeyValue)) {
-                        auto keyArray = std::get<0>(keyArrayValue->get());
-                        if (keyArray.size() && dynamic_cast<DocTree::Table*>(keyArray.back())) {
-                            lastDefinedTable = dynamic_cast<DocTree::Table*>(keyArray.back());
+                    else if (auto keyArrayValue = DocTree::nodeCast<DocTree::Array>(lastDefinedTableKeyValue)) {
+                        // Packed arrays hold values only
+                        const auto& keyArray = keyArrayValue->getElems();
+                        if (!keyArrayValue->getIsPacked() && keyArray.size() && DocTree::nodeCast<DocTree::Table>(keyArray.back())) {
+                            lastDefinedTable = DocTree::nodeCast<DocTree::Table>(keyArray.back());
                         }
                     }
                 }
@@ -759,25 +772,24 @@ protected:
                 }
             }
             if (std::get<3>(token).contains(position)) {
-                auto tokenIndex = std::distance(tokenList.begin(), tokenListIterator);
-				if (tokenDocTreeMapping.find(tokenIndex) != tokenDocTreeMapping.end() || std::get<0>(token) == ".") {
+				if (tokenDocTreeMapping[tokenListIterator.GetIndex()] || std::get<0>(token) == ".") {
                     std::vector<std::pair<std::string, DocTree::Key*>> docTreeCompletionKeyPairs;
                     std::vector<std::pair<std::string, CSL::TableType::KeyDefinition>> cslSchemaCompletionKeyPairs;
                     if (std::get<0>(token) == ".") {
-                        auto targetKey = tokenDocTreeMapping[std::distance(tokenList.begin(), std::prev(tokenListIterator))];
-                        auto keyValue = std::get<1>(targetKey->get());
-                        DocTree::Table* keyTableValue = dynamic_cast<DocTree::Table*>(keyValue);
-                        if (!keyTableValue && dynamic_cast<DocTree::Array*>(keyValue)) {
+                        auto targetKey = tokenDocTreeMapping[std::prev(tokenListIterator).GetIndex()];
+                        auto keyValue = targetKey->getValue();
+                        DocTree::Table* keyTableValue = DocTree::nodeCast<DocTree::Table>(keyValue);
+                        if (!keyTableValue && DocTree::nodeCast<DocTree::Array>(keyValue)) {
                             auto keyArrayValue = (DocTree::Array*)keyValue;
-                            auto keyArray = std::get<0>(keyArrayValue->get());
-                            if (keyArray.size()) {
-                                keyTableValue = dynamic_cast<DocTree::Table*>(keyArray.back());
+                            const auto& keyArray = keyArrayValue->getElems();
+                            if (!keyArrayValue->getIsPacked() && keyArray.size()) {
+                                keyTableValue = DocTree::nodeCast<DocTree::Table>(keyArray.back());
                             }
                         }
                         if (keyTableValue) {
-                            auto keyTable = std::get<0>(keyTableValue->get());
+                            const auto& keyTable = keyTableValue->getElems();
                             for (auto& keyPair : keyTable) {
-                                docTreeCompletionKeyPairs.push_back(keyPair);
+                                docTreeCompletionKeyPairs.emplace_back(keyPair);
                             }
                             if (cslSchemas.size()) {
                                 std::shared_ptr<CSL::ConfigSchema> schema;
@@ -791,7 +803,7 @@ protected:
                                     }
                                 }
                                 if (schema) {
-                                    auto tableType = getTableTypeForDocTable(keyTableValue, docTree, cslSchemas[0]);
+                                    auto tableType = getTableTypeForDocTable(keyTableValue, document.get(), cslSchemas[0]);
                                     if (tableType) {
                                         auto explicitKeys = tableType->getExplicitKeys();
                                         std::unordered_map<std::string, CSL::TableType::KeyDefinition> keyNameKeyDefMapping;
@@ -804,9 +816,9 @@ protected:
                         }
                     }
                     else {
-                        auto targetKey = tokenDocTreeMapping[std::distance(tokenList.begin(), tokenListIterator)];
-                        auto parentTable = std::get<0>(std::get<2>(targetKey->get())->get());
-                        docTreeCompletionKeyPairs = findPairs(parentTable, std::get<0>(targetKey->get()));
+                        auto targetKey = tokenDocTreeMapping[tokenListIterator.GetIndex()];
+                        const auto& parentTable = targetKey->getParentTable()->getElems();
+                        docTreeCompletionKeyPairs = findPairs(parentTable, std::string(targetKey->getId()));
                         for (auto keyPairIterator = docTreeCompletionKeyPairs.begin(); keyPairIterator != docTreeCompletionKeyPairs.end(); ++keyPairIterator) {
                             if (keyPairIterator->second == targetKey) {
                                 docTreeCompletionKeyPairs.erase(keyPairIterator);
@@ -825,23 +837,23 @@ protected:
                                 }
                             }
                             if (schema) {
-                                auto tableType = getTableTypeForDocTable(std::get<2>(targetKey->get()), docTree, schema);
+                                auto tableType = getTableTypeForDocTable(targetKey->getParentTable(), document.get(), schema);
                                 if (tableType) {
                                     auto explicitKeys = tableType->getExplicitKeys();
                                     std::unordered_map<std::string, CSL::TableType::KeyDefinition> keyNameKeyDefMapping;
                                     for (const auto& keyDef : explicitKeys) {
                                         keyNameKeyDefMapping[keyDef.name] = keyDef;
                                     }
-                                    cslSchemaCompletionKeyPairs = findPairs(keyNameKeyDefMapping, std::get<0>(targetKey->get()));
+                                    cslSchemaCompletionKeyPairs = findPairs(keyNameKeyDefMapping, std::string(targetKey->getId()));
                                 }
                             }
                         }
                     }
                     for (auto& completionKeyPair : docTreeCompletionKeyPairs) {
                         auto completionKeyId = std::get<0>(completionKeyPair);
-                        auto completionKeyValue = std::get<1>(std::get<1>(completionKeyPair)->get());
-                        if (auto table = dynamic_cast<DocTree::Table*>(completionKeyValue)) {
-                            auto tableRegion = std::get<2>(table->get());
+                        auto completionKeyValue = std::get<1>(completionKeyPair)->getValue();
+                        if (auto table = DocTree::nodeCast<DocTree::Table>(completionKeyValue)) {
+                            auto tableRegion = table->getDefPos();
                             auto tableDefStartString = " defined at ln " + std::to_string(tableRegion.start.line.getValue() + 1) + ", col " + std::to_string(tableRegion.start.column.getValue() + 1);
                             json completionItem;
                             completionItem["label"] = completionKeyId;
@@ -850,8 +862,8 @@ protected:
                             completionItem["insertText"] = completionKeyId;
                             completions.push_back(completionItem);
                         }
-                        else if (auto array = dynamic_cast<DocTree::Array*>(completionKeyValue)) {
-                            auto arrayRegion = std::get<2>(array->get());
+                        else if (auto array = DocTree::nodeCast<DocTree::Array>(completionKeyValue)) {
+                            auto arrayRegion = array->getDefPos();
                             auto arrayDefStartString = " defined at ln " + std::to_string(arrayRegion.start.line.getValue() + 1) + ", col " + std::to_string(arrayRegion.start.column.getValue() + 1);
                             json completionItem;
                             completionItem["label"] = completionKeyId;
@@ -873,12 +885,12 @@ protected:
                 }
             }
             else if (lastDefinedTable && std::get<3>(token).end.line > position.line && (std::next(tokenListIterator) == tokenList.end() || std::get<3>(*std::next(tokenListIterator)).start < position)) {
-                auto keyTable = std::get<0>(lastDefinedTable->get());
+                const auto& keyTable = lastDefinedTable->getElems();
                 for (auto& completionKeyPair : keyTable) {
                     auto completionKeyId = std::get<0>(completionKeyPair);
-                    auto completionKeyValue = std::get<1>(std::get<1>(completionKeyPair)->get());
-                    if (auto table = dynamic_cast<DocTree::Table*>(completionKeyValue)) {
-                        auto tableRegion = std::get<2>(table->get());
+                    auto completionKeyValue = std::get<1>(completionKeyPair)->getValue();
+                    if (auto table = DocTree::nodeCast<DocTree::Table>(completionKeyValue)) {
+                        auto tableRegion = table->getDefPos();
                         auto tableDefStartString = " defined at ln " + std::to_string(tableRegion.start.line.getValue() + 1) + ", col " + std::to_string(tableRegion.start.column.getValue() + 1);
                         json completionItem;
                         completionItem["label"] = completionKeyId;
@@ -887,8 +899,8 @@ protected:
                         completionItem["insertText"] = completionKeyId;
                         completions.push_back(completionItem);
                     }
-                    else if (auto array = dynamic_cast<DocTree::Array*>(completionKeyValue)) {
-                        auto arrayRegion = std::get<2>(array->get());
+                    else if (auto array = DocTree::nodeCast<DocTree::Array>(completionKeyValue)) {
+                        auto arrayRegion = array->getDefPos();
                         auto arrayDefStartString = " defined at ln " + std::to_string(arrayRegion.start.line.getValue() + 1) + ", col " + std::to_string(arrayRegion.start.column.getValue() + 1);
                         json completionItem;
                         completionItem["label"] = completionKeyId;
@@ -909,7 +921,7 @@ protected:
                         }
                     }
                     if (schema) {
-                        auto tableType = getTableTypeForDocTable(lastDefinedTable, docTree, cslSchemas[0]);
+                        auto tableType = getTableTypeForDocTable(lastDefinedTable, document.get(), cslSchemas[0]);
                         if (tableType) {
                             auto explicitKeys = tableType->getExplicitKeys();
                             std::unordered_map<std::string, CSL::TableType::KeyDefinition> keyNameKeyDefMapping;
@@ -928,7 +940,6 @@ protected:
                 }
             }
         }
-        delete docTree;
         tokenList.clear();
         json result;
         if (completions.size()) {
@@ -953,23 +964,22 @@ protected:
         }
         FilePosition::Position position = { { request["params"]["position"]["line"].get<size_t>(), false }, { request["params"]["position"]["character"].get<size_t>(), false } };
         auto [tokenList, lexErrors, lexWarnings] = tomlLexer(it->second, clientSupportsMultilineToken);
-        auto [docTree, parseErrors, parseWarnings, tokenDocTreeMapping] = tomlParser(tokenList);
+        auto [document, parseErrors, parseWarnings, tokenDocTreeMapping] = tomlParser(tokenList);
         auto hover = json::object();
-        for (auto tokenListIterator = tokenList.begin(); tokenListIterator != tokenList.end(); ++tokenListIterator) {
+        for (auto tokenListIterator = tokenList.FindToken(position); tokenListIterator != tokenList.end() && std::get<3>(*tokenListIterator).start <= position; ++tokenListIterator) {
             const auto& token = *tokenListIterator;
             const auto tokenRange = std::get<3>(token);
             if (tokenRange.contains(position)) {
-                auto tokenIndex = std::distance(tokenList.begin(), tokenListIterator);
-                if (tokenDocTreeMapping.find(tokenIndex) == tokenDocTreeMapping.end()) {
+                auto targetKey = tokenDocTreeMapping[tokenListIterator.GetIndex()];
+                if (!targetKey) {
                     continue;
                 }
-                auto targetKey = tokenDocTreeMapping[tokenIndex];
-                if (auto table = dynamic_cast<DocTree::Table*>(std::get<1>(targetKey->get()))) {
-                    auto [elems, isMutable, defPos, isExplicitlyDefined] = table->get();
-                    std::string markdown = "## **Table** " + std::get<0>(targetKey->get()) + "\n";
-                    markdown += "- **Mutability**: " + std::string(isMutable ? "mutable" : "immutable") + "\n";
-                    markdown += "- **Explicitly Defined**: " + std::string(isExplicitlyDefined ? "Yes" : "No") + "\n";
-                    markdown += "- **Entries**: " + std::to_string(elems.size()) + "\n";
+                if (auto table = DocTree::nodeCast<DocTree::Table>(targetKey->getValue())) {
+                    const auto& defPos = table->getDefPos();
+                    std::string markdown = "## **Table** " + std::string(targetKey->getId()) + "\n";
+                    markdown += "- **Mutability**: " + std::string(table->getIsMutable() ? "mutable" : "immutable") + "\n";
+                    markdown += "- **Explicitly Defined**: " + std::string(table->getIsExplicitlyDefined() ? "Yes" : "No") + "\n";
+                    markdown += "- **Entries**: " + std::to_string(table->getElems().size()) + "\n";
                     markdown += "- **Defined At**: ln " + std::to_string(defPos.start.line.getValue() + 1) + ", col " + std::to_string(defPos.start.column.getValue() + 1);
                     hover["contents"]["kind"] = "markdown";
                     hover["contents"]["value"] = markdown;
@@ -978,11 +988,11 @@ protected:
                     hover["range"]["end"]["line"] = tokenRange.end.line.getValue();
                     hover["range"]["end"]["character"] = tokenRange.end.column.getValue();
                 }
-                else if (auto array = dynamic_cast<DocTree::Array*>(std::get<1>(targetKey->get()))) {
-                    auto [elems, isMutable, defPos] = array->get();
-                    std::string markdown = "## **Array** " + std::get<0>(targetKey->get()) + "\n";
-                    markdown += "- **Mutability**: " + std::string(isMutable ? "mutable" : "immutable") + "\n";
-                    markdown += "- **Entries**: " + std::to_string(elems.size()) + "\n";
+                else if (auto array = DocTree::nodeCast<DocTree::Array>(targetKey->getValue())) {
+                    const auto& defPos = array->getDefPos();
+                    std::string markdown = "## **Array** " + std::string(targetKey->getId()) + "\n";
+                    markdown += "- **Mutability**: " + std::string(array->getIsMutable() ? "mutable" : "immutable") + "\n";
+                    markdown += "- **Entries**: " + std::to_string(array->size()) + "\n";
                     markdown += "- **Defined At**: ln " + std::to_string(defPos.start.line.getValue() + 1) + ", col " + std::to_string(defPos.start.column.getValue() + 1);
                     hover["contents"]["kind"] = "markdown";
                     hover["contents"]["value"] = markdown;
@@ -993,7 +1003,6 @@ protected:
                 }
             }
         }
-        delete docTree;
         tokenList.clear();
         return genResponse(
             request["id"].get<size_t>(),
@@ -1011,17 +1020,16 @@ protected:
         bool includeDeclaration = request["params"]["context"]["includeDeclaration"].get<bool>();
         FilePosition::Position position = { { request["params"]["position"]["line"].get<size_t>(), false }, { request["params"]["position"]["character"].get<size_t>(), false } };
         auto [tokenList, lexErrors, lexWarnings] = tomlLexer(it->second, clientSupportsMultilineToken);
-        auto [docTree, parseErrors, parseWarnings, tokenDocTreeMapping] = tomlParser(tokenList);
+        auto [document, parseErrors, parseWarnings, tokenDocTreeMapping] = tomlParser(tokenList);
         auto references = json::array();
         std::unordered_map<DocTree::Key*, std::vector<FilePosition::Region>> referencesMap;
         DocTree::Key* targetKey = nullptr;
         for (auto tokenListIterator = tokenList.begin(); tokenListIterator != tokenList.end(); ++tokenListIterator) {
             const auto& token = *tokenListIterator;
-            auto tokenIndex = std::distance(tokenList.begin(), tokenListIterator);
-            if (tokenDocTreeMapping.find(tokenIndex) == tokenDocTreeMapping.end()) {
+            auto curKey = tokenDocTreeMapping[tokenListIterator.GetIndex()];
+            if (!curKey) {
                 continue;
             }
-            auto curKey = tokenDocTreeMapping[tokenIndex];
             referencesMap[curKey].push_back(std::get<3>(token));
             if (std::get<3>(token).contains(position)) {
                 targetKey = curKey;
@@ -1029,14 +1037,14 @@ protected:
         }
         FilePosition::Region targetKeyDefRegion;
         if (targetKey) {
-            if (auto table = dynamic_cast<DocTree::Table*>(std::get<1>(targetKey->get()))) {
-                targetKeyDefRegion = std::get<2>(table->get());
+            if (auto table = DocTree::nodeCast<DocTree::Table>(targetKey->getValue())) {
+                targetKeyDefRegion = table->getDefPos();
             }
-            else if (auto array = dynamic_cast<DocTree::Array*>(std::get<1>(targetKey->get()))) {
-                targetKeyDefRegion = std::get<2>(array->get());
+            else if (auto array = DocTree::nodeCast<DocTree::Array>(targetKey->getValue())) {
+                targetKeyDefRegion = array->getDefPos();
             }
-            else if (auto value = dynamic_cast<DocTree::Value*>(std::get<1>(targetKey->get()))) {
-                targetKeyDefRegion = std::get<2>(value->get());
+            else if (auto value = DocTree::nodeCast<DocTree::Value>(targetKey->getValue())) {
+                targetKeyDefRegion = value->getDefPos();
             }
             for (const auto& keyRef : referencesMap[targetKey]) {
                 if (!includeDeclaration && keyRef == targetKeyDefRegion) {
@@ -1051,7 +1059,6 @@ protected:
                 references.push_back(reference);
             }
         }
-        delete docTree;
         tokenList.clear();
         return genResponse(
             request["id"].get<size_t>(),
@@ -1069,22 +1076,20 @@ protected:
         auto newName = request["params"]["newName"].get<std::string>();
         FilePosition::Position position = { { request["params"]["position"]["line"].get<size_t>(), false }, { request["params"]["position"]["character"].get<size_t>(), false } };
         auto [tokenList, lexErrors, lexWarnings] = tomlLexer(it->second, clientSupportsMultilineToken);
-        auto [docTree, parseErrors, parseWarnings, tokenDocTreeMapping] = tomlParser(tokenList);
+        auto [document, parseErrors, parseWarnings, tokenDocTreeMapping] = tomlParser(tokenList);
         std::unordered_map<DocTree::Key*, std::vector<FilePosition::Region>> referencesMap;
         DocTree::Key* targetKey = nullptr;
         for (auto tokenListIterator = tokenList.begin(); tokenListIterator != tokenList.end(); ++tokenListIterator) {
             const auto& token = *tokenListIterator;
-            auto tokenIndex = std::distance(tokenList.begin(), tokenListIterator);
-            if (tokenDocTreeMapping.find(tokenIndex) == tokenDocTreeMapping.end()) {
+            auto curKey = tokenDocTreeMapping[tokenListIterator.GetIndex()];
+            if (!curKey) {
                 continue;
             }
-            auto curKey = tokenDocTreeMapping[tokenIndex];
             referencesMap[curKey].push_back(std::get<3>(token));
             if (std::get<3>(token).contains(position)) {
                 targetKey = curKey;
             }
         }
-        delete docTree;
         tokenList.clear();
         json result;
         if (targetKey) {
@@ -1117,7 +1122,7 @@ protected:
             throw std::runtime_error("Document not found");
         }
         auto [tokenList, lexErrors, lexWarnings] = tomlLexer(it->second, clientSupportsMultilineToken);
-        auto [docTree, parseErrors, parseWarnings, tokenDocTreeMapping] = tomlParser(tokenList);
+        auto [document, parseErrors, parseWarnings, tokenDocTreeMapping] = tomlParser(tokenList);
         auto ranges = json::array();
         for (auto tokenListIterator = tokenList.begin(); tokenListIterator != tokenList.end() && std::next(tokenListIterator) != tokenList.end(); ++tokenListIterator) {
             const auto& token = *tokenListIterator;
@@ -1147,11 +1152,11 @@ protected:
         for (auto tokenListIterator = tokenList.begin(); tokenListIterator != tokenList.end() && std::next(tokenListIterator) != tokenList.end(); ++tokenListIterator) {
             const auto& token = *tokenListIterator;
             if (std::get<0>(token) == "[") {
-                auto IsTableHeaderDef = [&tokenList, &tokenDocTreeMapping](const auto& tokenListIterator) {
-                    return std::get<0>(*tokenListIterator) == "[" && std::get<1>(*std::next(tokenListIterator)) == "identifier" && tokenDocTreeMapping.find(std::distance(tokenList.begin(), std::next(tokenListIterator))) != tokenDocTreeMapping.end();
+                auto IsTableHeaderDef = [&tokenDocTreeMapping](const auto& tokenListIterator) {
+                    return std::get<0>(*tokenListIterator) == "[" && std::get<1>(*std::next(tokenListIterator)) == Token::TokenKind::Identifier && tokenDocTreeMapping[std::next(tokenListIterator).GetIndex()];
                     };
                 auto IsArrayHeaderDef = [&tokenList, &tokenDocTreeMapping](const auto& tokenListIterator) {
-                    return std::get<0>(*tokenListIterator) == "[" && std::get<0>(*std::next(tokenListIterator)) == "[" && std::next(tokenListIterator, 2) != tokenList.end() && std::get<1>(*std::next(tokenListIterator, 2)) == "identifier" && tokenDocTreeMapping.find(std::distance(tokenList.begin(), std::next(tokenListIterator, 2))) != tokenDocTreeMapping.end();
+                    return std::get<0>(*tokenListIterator) == "[" && std::get<0>(*std::next(tokenListIterator)) == "[" && std::next(tokenListIterator, 2) != tokenList.end() && std::get<1>(*std::next(tokenListIterator, 2)) == Token::TokenKind::Identifier && tokenDocTreeMapping[std::next(tokenListIterator, 2).GetIndex()];
                     };
                 auto IsHeaderDef = [&IsTableHeaderDef, &IsArrayHeaderDef](const auto& tokenListIterator) {
                     return IsArrayHeaderDef(tokenListIterator) || IsTableHeaderDef(tokenListIterator);
@@ -1189,10 +1194,10 @@ protected:
         }
         for (auto tokenListIterator = tokenList.begin(); tokenListIterator != tokenList.end() && std::next(tokenListIterator) != tokenList.end(); ++tokenListIterator) {
             const auto& token = *tokenListIterator;
-            if (std::get<1>(token) == "comment") {
+            if (std::get<1>(token) == Token::TokenKind::Comment) {
                 auto startPosition = std::get<3>(token).start;
                 for (; tokenListIterator != tokenList.end(); ++tokenListIterator) {
-                    if (std::next(tokenListIterator) == tokenList.end() || std::get<1>(*std::next(tokenListIterator)) != "comment") {
+                    if (std::next(tokenListIterator) == tokenList.end() || std::get<1>(*std::next(tokenListIterator)) != Token::TokenKind::Comment) {
                         break;
                     }
                 }
@@ -1212,7 +1217,6 @@ protected:
                 ranges.push_back(range);
             }
         }
-        delete docTree;
         tokenList.clear();
         return genResponse(
             request["id"].get<size_t>(),
@@ -1,449 +1,311 @@
 ﻿#include <iostream>
+#include <iterator>
 #include <string>
-#include <list>
+#include <string_view>
+#include <memory>
 #include <tuple>
-#include <regex>
 #include "../shared/CslCheckFunctions.h"
 #include "../shared/CslStringUtils.h"
 #include "../shared/Token.h"
 #include "../shared/FilePosition.h"
+#include "../shared/Utf8Validation.h"
 
 using namespace CSL;
 
 namespace CSLLexer {
     class Lexer {
     protected:
-        std::istream& inputCode;
+        std::string_view inputCode;
         bool multilineToken;
         std::vector<std::tuple<std::string, FilePosition::Region>> errors;
         std::vector<std::tuple<std::string, FilePosition::Region>> warnings;
 
-        FilePosition::Position getEndPosition(const std::string& text, const FilePosition::Position& start) {
-            auto line = start.line;
-            auto col = start.column;
-
-            for (char ch : text) {
-                if (ch == '\n') {
-                    ++line;
-                    col = 0;
+        // Reads the groups of digits text is split into by underscores.
+        // Fails on an empty group before an underscore, like in "1__000".
+        // Otherwise gives the number of groups, the size of the second and
+        // of the last, whether the groups after the first are all of the
+        // same size and whether the ones between the first and the last are
+        // all of two digits.
+        bool readDigitGroups(std::string_view text, size_t& count, size_t& secondSize, size_t& lastSize, bool& isUniform, bool& isMiddleOfTwo) {
+            count = 0;
+            secondSize = 0;
+            lastSize = 0;
+            isUniform = true;
+            isMiddleOfTwo = true;
+            size_t start = 0;
+            while (true) {
+                size_t end = text.find('_', start);
+                size_t size = (end == std::string_view::npos ? text.size() : end) - start;
+                if (end != std::string_view::npos && !size) {
+                    return false;
+                }
+                if (count >= 2 && lastSize != 2) {
+                    isMiddleOfTwo = false;
+                }
+                if (count == 1) {
+                    secondSize = size;
+                }
+                else if (count > 1 && size != secondSize) {
+                    isUniform = false;
                 }
-                else {
-                    ++col;
+                lastSize = size;
+                ++count;
+                if (end == std::string_view::npos) {
+                    return true;
                 }
+                start = end + 1;
             }
-
-            return { line, col };
         }
 
-        bool isNumberReasonablyGrouped(const std::string& str) {
+        // The groups after the first must all be of one size other than a
+        // single digit, except that the integer part may also be grouped
+        // the Indian way, in twos with a last group of three.
+        bool isNumberReasonablyGrouped(std::string_view str) {
             size_t dotPos = str.find('.');
-            std::string beforeDot = str.substr(0, dotPos);
+            std::string_view beforeDot = str.substr(0, dotPos);
             if (beforeDot.size() && (beforeDot[0] == '+' || beforeDot[0] == '-')) {
-                beforeDot.erase(0, 1);
+                beforeDot.remove_prefix(1);
             }
             if (beforeDot.size() > 2 && beforeDot[0] == '0' && (beforeDot[1] == 'b' || beforeDot[1] == 'o' || beforeDot[1] == 'x')) {
-                beforeDot.erase(0, 2);
+                beforeDot.remove_prefix(2);
             }
-            std::string afterDot = dotPos > str.size() ? "" : str.substr(dotPos + 1);
+            std::string_view afterDot = dotPos > str.size() ? std::string_view() : str.substr(dotPos + 1);
 
-            std::vector<std::string> parts;
-            std::vector<size_t> sizes;
-
-            // Split by underscores
-            size_t start = 0, end;
-            while ((end = beforeDot.find('_', start)) != std::string::npos) {
-                const auto part = beforeDot.substr(start, end - start);
-                if (part.empty()) return false; // invalid like "1__000"
-                parts.push_back(part);
-                sizes.push_back(part.size());
-                start = end + 1;
+            size_t count, secondSize, lastSize;
+            bool isUniform, isMiddleOfTwo;
+            if (!readDigitGroups(beforeDot, count, secondSize, lastSize, isUniform, isMiddleOfTwo)) {
+                return false;
             }
-            parts.push_back(beforeDot.substr(start));
-            sizes.push_back(parts.back().size());
-
-            if (parts.size() != 1) { // Has underscores
-                bool allSame = true;
-
-                for (size_t i = 1; i < sizes.size(); ++i) {
-                    if (sizes[i] != sizes[1]) {
-                        allSame = false;
-                        break;
-                    }
-                }
-                if (allSame) {
-                    if (sizes[1] == 1) {
-                        return false;
-                    }
-                }
-                else {
-                    allSame = true;
-                    for (size_t i = 1; i < sizes.size() - 1; ++i) {
-                        if (sizes[i] != 2) {
-                            allSame = false;
-                            break;
-                        }
-                    }
-                    if (!allSame || sizes[sizes.size() - 1] != 3) {
-                        return false;
-                    }
+            if (count != 1) { // Has underscores
+                if (isUniform ? secondSize == 1 : !isMiddleOfTwo || lastSize != 3) {
+                    return false;
                 }
             }
 
-            parts.clear();
-            sizes.clear();
-            start = 0;
-            while ((end = afterDot.find('_', start)) != std::string::npos) {
-                const auto part = afterDot.substr(start, end - start);
-                if (part.empty()) return false; // invalid like "1__000"
-                parts.push_back(part);
-                sizes.push_back(part.size());
-                start = end + 1;
-            }
-            parts.push_back(afterDot.substr(start));
-            sizes.push_back(parts.back().size());
-
-            if (parts.size() == 1) return true; // No underscores
-
-            bool allSame = true;
-
-            for (size_t i = 1; i < sizes.size(); ++i) {
-                if (sizes[i] != sizes[1]) {
-                    allSame = false;
-                    break;
-                }
-            }
-            if (!allSame) return false;
-            if (sizes[1] == 1) {
+            if (!readDigitGroups(afterDot, count, secondSize, lastSize, isUniform, isMiddleOfTwo)) {
                 return false;
             }
-
-            return true;
+            if (count == 1) return true; // No underscores
+            return isUniform && secondSize != 1;
         }
 
-        bool isStringContentValid(const std::string& stringToCheck, int stringType) {
-            size_t i = 0;
-            while (i < stringToCheck.size()) {
-                uint32_t codepoint = 0;
-                unsigned char c = stringToCheck[i];
-
-                size_t bytes = 0;
-                if ((c & 0x80) == 0) {
-                    // 1-byte ASCII
-                    codepoint = c;
-                    bytes = 1;
-                }
-                else if ((c & 0xE0) == 0xC0) {
-                    // 2-byte
-                    if (i + 1 >= stringToCheck.size()) return false;
-                    unsigned char c1 = stringToCheck[i + 1];
-                    if ((c1 & 0xC0) != 0x80) return false;
-
-                    codepoint = ((c & 0x1F) << 6) | (c1 & 0x3F);
-                    if (codepoint < 0x80) return false;  // Overlong
-                    bytes = 2;
-                }
-                else if ((c & 0xF0) == 0xE0) {
-                    // 3-byte
-                    if (i + 2 >= stringToCheck.size()) return false;
-                    unsigned char c1 = stringToCheck[i + 1];
-                    unsigned char c2 = stringToCheck[i + 2];
-                    if ((c1 & 0xC0) != 0x80 || (c2 & 0xC0) != 0x80) return false;
-
-                    codepoint = ((c & 0x0F) << 12) |
-                        ((c1 & 0x3F) << 6) |
-                        (c2 & 0x3F);
-                    if (codepoint < 0x800) return false;        // Overlong
-                    if (codepoint >= 0xD800 && codepoint <= 0xDFFF) return false;  // Surrogates
-                    bytes = 3;
-                }
-                else if ((c & 0xF8) == 0xF0) {
-                    // 4-byte
-                    if (i + 3 >= stringToCheck.size()) return false;
-                    unsigned char c1 = stringToCheck[i + 1];
-                    unsigned char c2 = stringToCheck[i + 2];
-                    unsigned char c3 = stringToCheck[i + 3];
-                    if ((c1 & 0xC0) != 0x80 ||
-                        (c2 & 0xC0) != 0x80 ||
-                        (c3 & 0xC0) != 0x80) return false;
-
-                    codepoint = ((c & 0x07) << 18) |
-                        ((c1 & 0x3F) << 12) |
-                        ((c2 & 0x3F) << 6) |
-                        (c3 & 0x3F);
-                    if (codepoint < 0x10000 || codepoint > 0x10FFFF) return false;  // Overlong or out of range
-                    bytes = 4;
-                }
-                else {
-                    // Invalid leading byte
-                    return false;
-                }
+        bool isStringContentValid(std::string_view stringToCheck, int stringType) {
+            return IsUtf8ContentValid(stringToCheck, stringType == Type::String::MultiLineBasic || stringType == Type::String::MultiLineRaw);
+        }
 
-                if ((stringType == 0 || stringType == 2) &&
-                    (codepoint >= 0x0000 && codepoint <= 0x0008 ||
-                        codepoint >= 0x000A && codepoint <= 0x001F ||
-                        codepoint == 0x007F)) {
-                    return false;
-                }
+        bool isAllWhitespace(std::string_view text) {
+            return text.find_first_not_of(" \t\n\v\f\r") == std::string_view::npos;
+        }
 
-                if (stringType == 1 || stringType == 3) {
-                    if (codepoint >= 0x0000 && codepoint <= 0x0008 ||
-                        codepoint == 0x000B || codepoint == 0x000C ||
-                        codepoint >= 0x000E && codepoint <= 0x001F ||
-                        codepoint == 0x007F) {
-                        return false;
-                    }
-                    else if (codepoint == 0x000D &&
-                        (i + 1 >= stringToCheck.size() || stringToCheck[i] != 0x000A)) {
-                        return false;
-                    }
+        bool hasBareCarriageReturn(std::string_view text) {
+            for (size_t i = 0; i < text.size(); ++i) {
+                if (text[i] == '\r' && (i + 1 == text.size() || text[i + 1] != '\n')) {
+                    return true;
                 }
-
-                i += bytes;
             }
-
-            return true;
+            return false;
         }
 
-        bool customGetline(std::istream& in, std::string& line) {
-            line.clear();
-            char ch;
-
-            while (in.get(ch)) {
-                if (ch == '\n') {
-                    // Check if we have a CRLF sequence
-                    if (!line.empty() && line.back() == '\r') {
-                        line.pop_back();  // Remove the '\r' before '\n'
-                    }
-                    return true;  // End of line
-                }
-                else {
-                    line += ch;
-                }
+        // Reads the line starting at lineStart and moves lineStart past
+        // its line break. A '\r' directly before the '\n' is not part of
+        // the line.
+        bool getLine(size_t& lineStart, std::string_view& line) {
+            if (lineStart >= inputCode.size()) {
+                return false;
             }
-
-            // Return true if we got any characters, even if we hit EOF without newline
-            return !line.empty();
+            size_t lineEnd = inputCode.find('\n', lineStart);
+            if (lineEnd == std::string_view::npos) {
+                line = inputCode.substr(lineStart);
+                lineStart = inputCode.size();
+                return true;
+            }
+            line = inputCode.substr(lineStart, lineEnd - lineStart);
+            if (!line.empty() && line.back() == '\r') {
+                line.remove_suffix(1);
+            }
+            lineStart = lineEnd + 1;
+            return true;
         }
 
     public:
-        Lexer(std::istream& inputCode, bool multilineToken = true) :
+        Lexer(std::string_view inputCode, bool multilineToken = true) :
             inputCode(inputCode), multilineToken(multilineToken) {
         }
 
         Token::TokenList<> Lex() {
-            Token::TokenList<> tokenList;
-            std::string codeToProcess;
-            FilePosition::Position currentPosition = { 0, 0 };
-            std::string curLine;
+            Token::TokenList<> tokenList(inputCode);
+            auto lineIndex = tokenList.GetLineIndex();
+            std::string_view curLine;
+            size_t nextLineStart = 0;
+            // Lines joined for an unclosed string or quoted identifier are
+            // contiguous in the input, so the code to process is always a
+            // single range of it.
+            size_t codeStart = 0;
+            size_t firstLineLength = 0;
             bool isContinued = false;
-            while (customGetline(inputCode, curLine)) {
-                if (std::regex_match(curLine, std::regex(R"(\s*)"))) {
-                    if (std::regex_search(curLine, std::regex(R"(\r(?!\n))"))) {
-                        FilePosition::Region errorRegion = { currentPosition.line, { 0, false }, currentPosition.line, { curLine.size(), false } };
-                        errors.push_back({ "Line ending is not valid.", errorRegion });
+            while (getLine(nextLineStart, curLine)) {
+                size_t curLineStart = curLine.data() - inputCode.data();
+                if (isAllWhitespace(curLine)) {
+                    if (hasBareCarriageReturn(curLine)) {
+                        FilePosition::Span errorSpan = { static_cast<uint32_t>(curLineStart), static_cast<uint32_t>(curLineStart + curLine.size()) };
+                        errors.push_back({ "Line ending is not valid.", lineIndex->GetRegion(errorSpan) });
                     }
-                    ++currentPosition.line;
-                    currentPosition.column = 0;
-                    if (inputCode.peek() != -1 || std::regex_match(codeToProcess, std::regex(R"(\s+)"))) {
+                    if (!isContinued) {
                         continue;
                     }
                 }
-                if (isContinued) {
-                    codeToProcess += curLine;
+                if (!isContinued) {
+                    codeStart = curLineStart;
+                    firstLineLength = curLine.size();
                 }
-                else {
-                    codeToProcess = curLine;
-                }
-                if (HasIncompleteStringOrId(codeToProcess)) {
+                std::string_view codeToProcess = inputCode.substr(codeStart, curLineStart + curLine.size() - codeStart);
+                if (HasIncompleteStringOrId(std::string(codeToProcess))) {
                     isContinued = true;
-                    codeToProcess += "\n";
-                    if (inputCode.peek() != -1) {
+                    if (nextLineStart < inputCode.size()) {
                         continue;
                     }
                     else {
-                        FilePosition::Region errorRegion = { currentPosition.line, { 0, false }, currentPosition.line, { codeToProcess.find('\n'), false } };
-                        errors.push_back({ "String literal or quoted identifier is not closed.", errorRegion });
+                        FilePosition::Span errorSpan = { static_cast<uint32_t>(codeStart), static_cast<uint32_t>(codeStart + firstLineLength) };
+                        errors.push_back({ "String literal or quoted identifier is not closed.", lineIndex->GetRegion(errorSpan) });
                     }
                 }
                 isContinued = false;
-                while (codeToProcess.size()) {
+                size_t cursor = 0;
+                auto getSpan = [&](size_t startIndex, size_t length) {
+                    return FilePosition::Span{ static_cast<uint32_t>(codeStart + startIndex), static_cast<uint32_t>(codeStart + startIndex + length) };
+                };
+                while (cursor < codeToProcess.size()) {
+                    std::string_view remainingCode = codeToProcess.substr(cursor);
                     // Comment
                     {
-                        auto [tokenStartIndex, tokenContent] = CheckComment(codeToProcess);
+                        auto [tokenStartIndex, tokenContent] = CheckComment(remainingCode);
                         if (!tokenContent.empty()) {
-                            auto tokenStart = getEndPosition(codeToProcess.substr(0, tokenStartIndex), currentPosition);
-                            auto tokenEnd = getEndPosition(tokenContent, tokenStart);
-                            FilePosition::Region tokenRegion = { tokenStart, tokenEnd };
-                            //tokenList.AddTokenToList(tokenContent, "comment", nullptr, tokenRegion);
-                            currentPosition = tokenEnd;
-                            codeToProcess.erase(0, tokenStartIndex + tokenContent.size());
+                            FilePosition::Span tokenSpan = getSpan(cursor + tokenStartIndex, tokenContent.size());
+                            //tokenList.AddTokenToList(tokenContent, Token::TokenKind::Comment, nullptr, tokenSpan);
+                            cursor += tokenStartIndex + tokenContent.size();
                             if (tokenContent.find("//") >= tokenContent.size() ? false : !isStringContentValid(tokenContent.substr(tokenContent.find('#') + 1), 0)) {
-                                errors.push_back({ "Comment contains invalid content.", tokenRegion });
+                                errors.push_back({ "Comment contains invalid content.", lineIndex->GetRegion(tokenSpan) });
                             }
                             continue;
                         }
                     }
                     // String Literal
                     {
-                        auto [tokenType, tokenStartIndex, tokenContent] = CheckStringLiteral(codeToProcess);
+                        auto [tokenType, tokenStartIndex, tokenContent] = CheckStringLiteral(remainingCode);
                         if (!tokenContent.empty()) {
-                            auto tokenStart = getEndPosition(codeToProcess.substr(0, tokenStartIndex), currentPosition);
-                            auto tokenEnd = getEndPosition(tokenContent, tokenStart);
-                            FilePosition::Region tokenRegion = { tokenStart, tokenEnd };
-                            tokenList.AddTokenToList(tokenContent, "string", tokenType, tokenRegion);
-                            currentPosition = tokenEnd;
-                            codeToProcess.erase(0, tokenStartIndex + tokenContent.size());
+                            FilePosition::Span tokenSpan = getSpan(cursor + tokenStartIndex, tokenContent.size());
+                            tokenList.AddTokenToList(remainingCode.substr(tokenStartIndex, tokenContent.size()), Token::TokenKind::String, tokenType);
+                            cursor += tokenStartIndex + tokenContent.size();
                             if (!isStringContentValid(tokenContent, ((Type::String*)tokenType)->getType())) {
-                                errors.push_back({ "String literal contains invalid content.", tokenRegion });
+                                errors.push_back({ "String literal contains invalid content.", lineIndex->GetRegion(tokenSpan) });
                             }
                             continue;
                         }
                     }
                     // Date Time Literal
                     {
-                        auto [tokenType, tokenStartIndex, tokenContent] = CheckDateTimeLiteral(codeToProcess);
+                        auto [tokenType, tokenStartIndex, tokenContent] = CheckDateTimeLiteral(remainingCode);
                         if (!tokenContent.empty()) {
-                            auto tokenStart = getEndPosition(codeToProcess.substr(0, tokenStartIndex), currentPosition);
-                            auto tokenEnd = getEndPosition(tokenContent, tokenStart);
-                            FilePosition::Region tokenRegion = { tokenStart, tokenEnd };
-                            tokenList.AddTokenToList(tokenContent, "datetime", tokenType, tokenRegion);
-                            currentPosition = tokenEnd;
-                            codeToProcess.erase(0, tokenStartIndex + tokenContent.size());
+                            tokenList.AddTokenToList(remainingCode.substr(tokenStartIndex, tokenContent.size()), Token::TokenKind::Datetime, tokenType);
+                            cursor += tokenStartIndex + tokenContent.size();
                             continue;
                         }
                     }
                     // Numeric Literal
                     {
-                        auto [tokenType, tokenStartIndex, tokenContent] = CheckNumericLiteral(codeToProcess);
+                        auto [tokenType, tokenStartIndex, tokenContent] = CheckNumericLiteral(remainingCode);
                         if (!tokenContent.empty()) {
-                            auto tokenStart = getEndPosition(codeToProcess.substr(0, tokenStartIndex), currentPosition);
-                            auto tokenEnd = getEndPosition(tokenContent, tokenStart);
-                            FilePosition::Region tokenRegion = { tokenStart, tokenEnd };
-                            tokenList.AddTokenToList(tokenContent, "number", tokenType, tokenRegion);
-                            currentPosition = tokenEnd;
-                            codeToProcess.erase(0, tokenStartIndex + tokenContent.size());
+                            FilePosition::Span tokenSpan = getSpan(cursor + tokenStartIndex, tokenContent.size());
+                            tokenList.AddTokenToList(remainingCode.substr(tokenStartIndex, tokenContent.size()), Token::TokenKind::Number, tokenType);
+                            cursor += tokenStartIndex + tokenContent.size();
                             if (tokenContent.size() > 3 && (tokenContent[0] == '+' || tokenContent[0] == '-') && tokenContent[1] == '0' && (tokenContent[2] == 'b' || tokenContent[2] == 'o' || tokenContent[2] == 'x')) {
-                                errors.push_back({ "Number literal in hexadecimal, octal or binary cannot have a positive or negative sign.", tokenRegion });
+                                errors.push_back({ "Number literal in hexadecimal, octal or binary cannot have a positive or negative sign.", lineIndex->GetRegion(tokenSpan) });
                             }
                             if (!isNumberReasonablyGrouped(tokenContent)) {
-                                warnings.push_back({ "Number literal is not grouped reasonably.", tokenRegion });
+                                warnings.push_back({ "Number literal is not grouped reasonably.", lineIndex->GetRegion(tokenSpan) });
                             }
                             continue;
                         }
                     }
                     // Boolean Literal
                     {
-                        auto [tokenType, tokenStartIndex, tokenContent] = CheckBooleanLiteral(codeToProcess);
+                        auto [tokenType, tokenStartIndex, tokenContent] = CheckBooleanLiteral(remainingCode);
                         if (!tokenContent.empty()) {
-                            auto tokenStart = getEndPosition(codeToProcess.substr(0, tokenStartIndex), currentPosition);
-                            auto tokenEnd = getEndPosition(tokenContent, tokenStart);
-                            FilePosition::Region tokenRegion = { tokenStart, tokenEnd };
-                            tokenList.AddTokenToList(tokenContent, "boolean", new Type::Boolean(), tokenRegion);
-                            currentPosition = tokenEnd;
-                            codeToProcess.erase(0, tokenStartIndex + tokenContent.size());
+                            tokenList.AddTokenToList(remainingCode.substr(tokenStartIndex, tokenContent.size()), Token::TokenKind::Boolean, Type::Boolean::instance());
+                            cursor += tokenStartIndex + tokenContent.size();
                             continue;
                         }
                     }
                     // Keyword
                     {
-                        auto [tokenStartIndex, tokenContent] = CheckKeyword(codeToProcess);
+                        auto [tokenStartIndex, tokenContent] = CheckKeyword(remainingCode);
                         if (!tokenContent.empty()) {
-                            auto tokenStart = getEndPosition(codeToProcess.substr(0, tokenStartIndex), currentPosition);
-                            auto tokenEnd = getEndPosition(tokenContent, tokenStart);
-                            FilePosition::Region tokenRegion = { tokenStart, tokenEnd };
-                            tokenList.AddTokenToList(tokenContent, "keyword", nullptr, tokenRegion);
-                            currentPosition = tokenEnd;
-                            codeToProcess.erase(0, tokenStartIndex + tokenContent.size());
+                            tokenList.AddTokenToList(remainingCode.substr(tokenStartIndex, tokenContent.size()), Token::TokenKind::Keyword, nullptr);
+                            cursor += tokenStartIndex + tokenContent.size();
                             continue;
                         }
                     }
                     // Type
                     {
-                        auto [tokenStartIndex, tokenContent] = CheckType(codeToProcess);
+                        auto [tokenStartIndex, tokenContent] = CheckType(remainingCode);
                         if (!tokenContent.empty()) {
-                            auto tokenStart = getEndPosition(codeToProcess.substr(0, tokenStartIndex), currentPosition);
-                            auto tokenEnd = getEndPosition(tokenContent, tokenStart);
-                            FilePosition::Region tokenRegion = { tokenStart, tokenEnd };
-                            tokenList.AddTokenToList(tokenContent, "type", nullptr, tokenRegion);
-                            currentPosition = tokenEnd;
-                            codeToProcess.erase(0, tokenStartIndex + tokenContent.size());
+                            tokenList.AddTokenToList(remainingCode.substr(tokenStartIndex, tokenContent.size()), Token::TokenKind::Type, nullptr);
+                            cursor += tokenStartIndex + tokenContent.size();
                             continue;
                         }
                     }
                     // Operator
                     {
-                        auto [tokenStartIndex, tokenContent] = CheckOperator(codeToProcess);
+                        auto [tokenStartIndex, tokenContent] = CheckOperator(remainingCode);
                         if (!tokenContent.empty()) {
-                            auto tokenStart = getEndPosition(codeToProcess.substr(0, tokenStartIndex), currentPosition);
-                            auto tokenEnd = getEndPosition(tokenContent, tokenStart);
-                            FilePosition::Region tokenRegion = { tokenStart, tokenEnd };
-                            tokenList.AddTokenToList(tokenContent, "operator", nullptr, tokenRegion);
-                            currentPosition = tokenEnd;
-                            codeToProcess.erase(0, tokenStartIndex + tokenContent.size());
+                            tokenList.AddTokenToList(remainingCode.substr(tokenStartIndex, tokenContent.size()), Token::TokenKind::Operator, nullptr);
+                            cursor += tokenStartIndex + tokenContent.size();
                             continue;
                         }
                     }
                     // Identifier
                     {
-                        auto [tokenStartIndex, tokenContent] = CheckIdentifier(codeToProcess);
+                        auto [tokenStartIndex, tokenContent] = CheckIdentifier(remainingCode);
                         if (!tokenContent.empty()) {
-                            auto tokenStart = getEndPosition(codeToProcess.substr(0, tokenStartIndex), currentPosition);
-                            auto tokenEnd = getEndPosition(tokenContent, tokenStart);
-                            FilePosition::Region tokenRegion = { tokenStart, tokenEnd };
+                            FilePosition::Span tokenSpan = getSpan(cursor + tokenStartIndex, tokenContent.size());
                             if (tokenContent.size() && (tokenContent[0] == '`' || tokenContent[0] == 'R' && tokenContent.size() >= 5 && tokenContent[1] == '`')) {
-                                tokenList.AddTokenToList(extractQuotedIdentifierContent(tokenContent), "identifier", nullptr, tokenRegion);
+                                tokenList.AddTokenToList(extractQuotedIdentifierContent(tokenContent), Token::TokenKind::Identifier, nullptr, tokenSpan);
                             }
                             else {
-                                tokenList.AddTokenToList(tokenContent, "identifier", nullptr, tokenRegion);
+                                tokenList.AddTokenToList(remainingCode.substr(tokenStartIndex, tokenContent.size()), Token::TokenKind::Identifier, nullptr);
                             }
-                            currentPosition = tokenEnd;
-                            codeToProcess.erase(0, tokenStartIndex + tokenContent.size());
+                            cursor += tokenStartIndex + tokenContent.size();
                             continue;
                         }
                     }
                     // Punctuator
                     {
-                        auto [tokenStartIndex, tokenContent] = CheckPunctuator(codeToProcess);
+                        auto [tokenStartIndex, tokenContent] = CheckPunctuator(remainingCode);
                         if (!tokenContent.empty()) {
-                            auto tokenStart = getEndPosition(codeToProcess.substr(0, tokenStartIndex), currentPosition);
-                            auto tokenEnd = getEndPosition(tokenContent, tokenStart);
-                            FilePosition::Region tokenRegion = { tokenStart, tokenEnd };
-                            tokenList.AddTokenToList(tokenContent, "punctuator", nullptr, tokenRegion);
-                            currentPosition = tokenEnd;
-                            codeToProcess.erase(0, tokenStartIndex + tokenContent.size());
+                            tokenList.AddTokenToList(remainingCode.substr(tokenStartIndex, tokenContent.size()), Token::TokenKind::Punctuator, nullptr);
+                            cursor += tokenStartIndex + tokenContent.size();
                             continue;
                         }
                     }
 
-                    if (std::regex_match(codeToProcess, std::regex(R"(\s*)"))) {
-                        auto tokenEnd = getEndPosition(codeToProcess, currentPosition);
-                        currentPosition = tokenEnd;
-                        codeToProcess.clear();
+                    if (isAllWhitespace(remainingCode)) {
+                        cursor = codeToProcess.size();
                         continue;
                     }
 
                     // Unknown Content
                     if (!tokenList.IsTokenBuffered()) {
-                        tokenList.SetTokenInfo("unknown");
-                    }
-                    tokenList.AppendBufferedToken(codeToProcess[0]);
-                    if (codeToProcess[0] == '\n') {
-                        ++currentPosition.line;
-                        currentPosition.column = 0;
-                    }
-                    else {
-                        ++currentPosition.column;
+                        tokenList.SetTokenInfo(Token::TokenKind::Unknown);
                     }
-                    codeToProcess.erase(0, 1);
+                    tokenList.AppendBufferedToken(remainingCode.substr(0, 1));
+                    ++cursor;
                 }
                 tokenList.FlushBuffer();
-                ++currentPosition.line;
-                currentPosition.column = 0;
             }
             for (const auto& token : tokenList) {
                 auto [tokenContent, tokenType, tokenProp, tokenRegion] = token;
-                if (tokenType == "unknown") {
-                    errors.push_back({ "Unknown token: " + tokenContent + ".", tokenRegion });
+                if (tokenType == Token::TokenKind::Unknown) {
+                    errors.push_back({ "Unknown token: " + std::string(tokenContent) + ".", tokenRegion });
                 }
             }
             return tokenList;
@@ -459,7 +321,14 @@ namespace CSLLexer {
     };
 }
 
-std::tuple<Token::TokenList<>, std::vector<std::tuple<std::string, FilePosition::Region>>, std::vector<std::tuple<std::string, FilePosition::Region>>> CslLexerMain(std::istream& inputCode, bool multilineToken = true) {
+std::tuple<Token::TokenList<>, std::vector<std::tuple<std::string, FilePosition::Region>>, std::vector<std::tuple<std::string, FilePosition::Region>>> CslLexerMain(std::string_view inputCode, bool multilineToken = true) {
     CSLLexer::Lexer lexer(inputCode, multilineToken);
     return { lexer.Lex(), lexer.GetErrors(), lexer.GetWarnings() };
 }
+
+std::tuple<Token::TokenList<>, std::vector<std::tuple<std::string, FilePosition::Region>>, std::vector<std::tuple<std::string, FilePosition::Region>>> CslLexerMain(std::istream& inputCode, bool multilineToken = true) {
+    auto inputBuffer = std::make_shared<const std::string>(std::istreambuf_iterator<char>(inputCode), std::istreambuf_iterator<char>());
+    auto result = CslLexerMain(std::string_view(*inputBuffer), multilineToken);
+    std::get<0>(result).AdoptSource(std::move(inputBuffer));
+    return result;
+}
@@ -1,417 +1,291 @@
 ﻿#include <iostream>
+#include <iterator>
 #include <string>
-#include <list>
+#include <memory>
 #include <tuple>
-#include <regex>
+#include <string_view>
 #include "../shared/TomlCheckFunctions.h"
+#include "../shared/TomlStructuralIndex.h"
 #include "../shared/Token.h"
 #include "../shared/FilePosition.h"
+#include "../shared/Utf8Validation.h"
 
 using namespace TOML;
 
 namespace TOMLLexer {
     class Lexer {
     protected:
-        std::istream& inputCode;
+        std::string_view inputCode;
         bool multilineToken;
         std::vector<std::tuple<std::string, FilePosition::Region>> errors;
         std::vector<std::tuple<std::string, FilePosition::Region>> warnings;
 
-        FilePosition::Position getEndPosition(const std::string& text, const FilePosition::Position& start) {
-            auto line = start.line;
-            auto col = start.column;
-
-            for (char ch : text) {
-                if (ch == '\n') {
-                    ++line;
-                    col = 0;
+        // Reads the groups of digits text is split into by underscores.
+        // Fails on an empty group before an underscore, like in "1__000".
+        // Otherwise gives the number of groups, the size of the second and
+        // of the last, whether the groups after the first are all of the
+        // same size and whether the ones between the first and the last are
+        // all of two digits.
+        bool readDigitGroups(std::string_view text, size_t& count, size_t& secondSize, size_t& lastSize, bool& isUniform, bool& isMiddleOfTwo) {
+            count = 0;
+            secondSize = 0;
+            lastSize = 0;
+            isUniform = true;
+            isMiddleOfTwo = true;
+            size_t start = 0;
+            while (true) {
+                size_t end = text.find('_', start);
+                size_t size = (end == std::string_view::npos ? text.size() : end) - start;
+                if (end != std::string_view::npos && !size) {
+                    return false;
+                }
+                if (count >= 2 && lastSize != 2) {
+                    isMiddleOfTwo = false;
                 }
-                else {
-                    ++col;
+                if (count == 1) {
+                    secondSize = size;
                 }
+                else if (count > 1 && size != secondSize) {
+                    isUniform = false;
+                }
+                lastSize = size;
+                ++count;
+                if (end == std::string_view::npos) {
+                    return true;
+                }
+                start = end + 1;
             }
-
-            return { line, col };
         }
 
-        bool isNumberReasonablyGrouped(const std::string& str) {
+        // The groups after the first must all be of one size other than a
+        // single digit, except that the integer part may also be grouped
+        // the Indian way, in twos with a last group of three.
+        bool isNumberReasonablyGrouped(std::string_view str) {
             size_t dotPos = str.find('.');
-            std::string beforeDot = str.substr(0, dotPos);
+            std::string_view beforeDot = str.substr(0, dotPos);
             if (beforeDot.size() && (beforeDot[0] == '+' || beforeDot[0] == '-')) {
-                beforeDot.erase(0, 1);
+                beforeDot.remove_prefix(1);
             }
             if (beforeDot.size() > 2 && beforeDot[0] == '0' && (beforeDot[1] == 'b' || beforeDot[1] == 'o' || beforeDot[1] == 'x')) {
-                beforeDot.erase(0, 2);
+                beforeDot.remove_prefix(2);
             }
-            std::string afterDot = dotPos > str.size() ? "" : str.substr(dotPos + 1);
-
-            std::vector<std::string> parts;
-            std::vector<size_t> sizes;
+            std::string_view afterDot = dotPos > str.size() ? std::string_view() : str.substr(dotPos + 1);
 
-            // Split by underscores
-            size_t start = 0, end;
-            while ((end = beforeDot.find('_', start)) != std::string::npos) {
-                const auto part = beforeDot.substr(start, end - start);
-                if (part.empty()) return false; // invalid like "1__000"
-                parts.push_back(part);
-                sizes.push_back(part.size());
-                start = end + 1;
+            size_t count, secondSize, lastSize;
+            bool isUniform, isMiddleOfTwo;
+            if (!readDigitGroups(beforeDot, count, secondSize, lastSize, isUniform, isMiddleOfTwo)) {
+                return false;
             }
-            parts.push_back(beforeDot.substr(start));
-            sizes.push_back(parts.back().size());
-
-            if (parts.size() != 1) { // Has underscores
-                bool allSame = true;
-
-                for (size_t i = 1; i < sizes.size(); ++i) {
-                    if (sizes[i] != sizes[1]) {
-                        allSame = false;
-                        break;
-                    }
-                }
-                if (allSame) {
-                    if (sizes[1] == 1) {
-                        return false;
-                    }
-                }
-                else {
-                    allSame = true;
-                    for (size_t i = 1; i < sizes.size() - 1; ++i) {
-                        if (sizes[i] != 2) {
-                            allSame = false;
-                            break;
-                        }
-                    }
-                    if (!allSame || sizes[sizes.size() - 1] != 3) {
-                        return false;
-                    }
+            if (count != 1) { // Has underscores
+                if (isUniform ? secondSize == 1 : !isMiddleOfTwo || lastSize != 3) {
+                    return false;
                 }
             }
 
-            parts.clear();
-            sizes.clear();
-            start = 0;
-            while ((end = afterDot.find('_', start)) != std::string::npos) {
-                const auto part = afterDot.substr(start, end - start);
-                if (part.empty()) return false; // invalid like "1__000"
-                parts.push_back(part);
-                sizes.push_back(part.size());
-                start = end + 1;
-            }
-            parts.push_back(afterDot.substr(start));
-            sizes.push_back(parts.back().size());
-
-            if (parts.size() == 1) return true; // No underscores
-
-            bool allSame = true;
-
-            for (size_t i = 1; i < sizes.size(); ++i) {
-                if (sizes[i] != sizes[1]) {
-                    allSame = false;
-                    break;
-                }
-            }
-            if (!allSame) return false;
-            if (sizes[1] == 1) {
+            if (!readDigitGroups(afterDot, count, secondSize, lastSize, isUniform, isMiddleOfTwo)) {
                 return false;
             }
-
-            return true;
+            if (count == 1) return true; // No underscores
+            return isUniform && secondSize != 1;
         }
 
-        bool isStringContentValid(const std::string& stringToCheck, int stringType) {
-            size_t i = 0;
-            while (i < stringToCheck.size()) {
-                uint32_t codepoint = 0;
-                unsigned char c = stringToCheck[i];
-
-                size_t bytes = 0;
-                if ((c & 0x80) == 0) {
-                    // 1-byte ASCII
-                    codepoint = c;
-                    bytes = 1;
-                }
-                else if ((c & 0xE0) == 0xC0) {
-                    // 2-byte
-                    if (i + 1 >= stringToCheck.size()) return false;
-                    unsigned char c1 = stringToCheck[i + 1];
-                    if ((c1 & 0xC0) != 0x80) return false;
-
-                    codepoint = ((c & 0x1F) << 6) | (c1 & 0x3F);
-                    if (codepoint < 0x80) return false;  // Overlong
-                    bytes = 2;
-                }
-                else if ((c & 0xF0) == 0xE0) {
-                    // 3-byte
-                    if (i + 2 >= stringToCheck.size()) return false;
-                    unsigned char c1 = stringToCheck[i + 1];
-                    unsigned char c2 = stringToCheck[i + 2];
-                    if ((c1 & 0xC0) != 0x80 || (c2 & 0xC0) != 0x80) return false;
-
-                    codepoint = ((c & 0x0F) << 12) |
-                        ((c1 & 0x3F) << 6) |
-                        (c2 & 0x3F);
-                    if (codepoint < 0x800) return false;        // Overlong
-                    if (codepoint >= 0xD800 && codepoint <= 0xDFFF) return false;  // Surrogates
-                    bytes = 3;
-                }
-                else if ((c & 0xF8) == 0xF0) {
-                    // 4-byte
-                    if (i + 3 >= stringToCheck.size()) return false;
-                    unsigned char c1 = stringToCheck[i + 1];
-                    unsigned char c2 = stringToCheck[i + 2];
-                    unsigned char c3 = stringToCheck[i + 3];
-                    if ((c1 & 0xC0) != 0x80 ||
-                        (c2 & 0xC0) != 0x80 ||
-                        (c3 & 0xC0) != 0x80) return false;
-
-                    codepoint = ((c & 0x07) << 18) |
-                        ((c1 & 0x3F) << 12) |
-                        ((c2 & 0x3F) << 6) |
-                        (c3 & 0x3F);
-                    if (codepoint < 0x10000 || codepoint > 0x10FFFF) return false;  // Overlong or out of range
-                    bytes = 4;
-                }
-                else {
-                    // Invalid leading byte
-                    return false;
-                }
-
-                if ((stringType == 0 || stringType == 2) &&
-                    (codepoint >= 0x0000 && codepoint <= 0x0008 ||
-                        codepoint >= 0x000A && codepoint <= 0x001F ||
-                        codepoint == 0x007F)) {
-                    return false;
-                }
-
-                if (stringType == 1 || stringType == 3) {
-                    if (codepoint >= 0x0000 && codepoint <= 0x0008 ||
-                        codepoint == 0x000B || codepoint == 0x000C ||
-                        codepoint >= 0x000E && codepoint <= 0x001F ||
-                        codepoint == 0x007F) {
-                        return false;
-                    }
-                    else if (codepoint == 0x000D &&
-                        (i + 1 >= stringToCheck.size() || stringToCheck[i] != 0x000A)) {
-                        return false;
-                    }
-                }
-
-                i += bytes;
-            }
-
-            return true;
+        bool isStringContentValid(std::string_view stringToCheck, int stringType) {
+            return IsUtf8ContentValid(stringToCheck, stringType == Type::String::MultiLineBasic || stringType == Type::String::MultiLineRaw);
         }
 
-        bool customGetline(std::istream& in, std::string& line) {
-            line.clear();
-            char ch;
+        bool isAllWhitespace(std::string_view text) {
+            return SkipWhitespace(text, 0) == text.size();
+        }
 
-            while (in.get(ch)) {
-                if (ch == '\n') {
-                    // Check if we have a CRLF sequence
-                    if (!line.empty() && line.back() == '\r') {
-                        line.pop_back();  // Remove the '\r' before '\n'
-                    }
-                    return true;  // End of line
-                }
-                else {
-                    line += ch;
+        bool hasBareCarriageReturn(std::string_view text) {
+            for (size_t i = 0; i < text.size(); ++i) {
+                if (text[i] == '\r' && (i + 1 == text.size() || text[i + 1] != '\n')) {
+                    return true;
                 }
             }
-
-            // Return true if we got any characters, even if we hit EOF without newline
-            return !line.empty();
+            return false;
         }
 
     public:
-        Lexer(std::istream& inputCode, bool multilineToken = true) :
+        Lexer(std::string_view inputCode, bool multilineToken = true) :
             inputCode(inputCode), multilineToken(multilineToken) {
         }
 
         Token::TokenList<> Lex() {
-            Token::TokenList<> tokenList;
-            std::string codeToProcess;
-            FilePosition::Position currentPosition = { 0, 0 };
-            std::string curLine;
-            bool isContinued = false;
-            while (customGetline(inputCode, curLine)) {
-                if (std::regex_match(curLine, std::regex(R"(\s*)"))) {
-                    if (std::regex_search(curLine, std::regex(R"(\r(?!\n))"))) {
-                        FilePosition::Region errorRegion = { currentPosition.line, { 0, false }, currentPosition.line, { curLine.size(), false } };
-                        errors.push_back({ "Line ending is not valid.", errorRegion });
-                    }
-                    ++currentPosition.line;
-                    currentPosition.column = 0;
-                    if (inputCode.peek() != -1 || std::regex_match(codeToProcess, std::regex(R"(\s+)"))) {
-                        continue;
-                    }
+            Token::TokenList<> tokenList(inputCode);
+            auto lineIndex = tokenList.GetLineIndex();
+            // Lines end at the line breaks in the structural index, which
+            // leaves out those inside multi-line strings. A line that opens
+            // a multi-line string therefore runs up to the line closing it
+            // and is lexed as one range of the input.
+            auto structuralIndex = BuildStructuralIndex(inputCode);
+            // Most lines hold a key, an operator and a value
+            tokenList.reserve(structuralIndex.lineBreaks.size() * 3);
+            size_t lineBreakCursor = 0;
+            auto nextLineBreak = [&]() -> size_t {
+                return lineBreakCursor < structuralIndex.lineBreaks.size() ? structuralIndex.lineBreaks[lineBreakCursor++] : std::string_view::npos;
+            };
+            size_t lineStart = 0;
+            while (lineStart < inputCode.size()) {
+                size_t lineBreak = nextLineBreak();
+                size_t lineEnd = lineBreak == std::string_view::npos ? inputCode.size() : lineBreak;
+                bool isStringUnclosed = lineBreak == std::string_view::npos && structuralIndex.unclosedStringStart != std::string_view::npos;
+                if (isStringUnclosed && inputCode[lineEnd - 1] == '\n') {
+                    --lineEnd;
                 }
-                if (isContinued) {
-                    codeToProcess += curLine;
+                if (lineEnd > lineStart && inputCode[lineEnd - 1] == '\r') {
+                    --lineEnd;
                 }
-                else {
-                    codeToProcess = curLine;
+                std::string_view code = inputCode.substr(lineStart, lineEnd - lineStart);
+                uint32_t codeOffset = static_cast<uint32_t>(lineStart);
+                lineStart = lineBreak == std::string_view::npos ? inputCode.size() : lineBreak + 1;
+                auto getRegion = [&](size_t startIndex, size_t length) {
+                    return lineIndex->GetRegion({ codeOffset + static_cast<uint32_t>(startIndex), codeOffset + static_cast<uint32_t>(startIndex + length) });
+                };
+                if (isAllWhitespace(code)) {
+                    if (hasBareCarriageReturn(code)) {
+                        errors.push_back({ "Line ending is not valid.", getRegion(0, code.size()) });
+                    }
+                    continue;
                 }
-                if (HasIncompleteString(codeToProcess)) {
-                    isContinued = true;
-                    codeToProcess += "\n";
-                    if (inputCode.peek() != -1) {
-                        continue;
+                if (isStringUnclosed) {
+                    size_t firstLineLength = code.find('\n');
+                    if (firstLineLength == std::string_view::npos) {
+                        firstLineLength = code.size();
                     }
-                    else {
-                        FilePosition::Region errorRegion = { currentPosition.line, { 0, false }, currentPosition.line, { codeToProcess.find('\n'), false } };
-                        errors.push_back({ "String literal is not closed.", errorRegion });
+                    else if (firstLineLength && code[firstLineLength - 1] == '\r') {
+                        --firstLineLength;
                     }
+                    errors.push_back({ "String literal is not closed.", getRegion(0, firstLineLength) });
                 }
-                isContinued = false;
-                while (codeToProcess.size()) {
-                    // Comment
-                    {
-                        auto [tokenStartIndex, tokenContent] = CheckComment(codeToProcess);
-                        if (!tokenContent.empty()) {
-                            auto tokenStart = getEndPosition(codeToProcess.substr(0, tokenStartIndex), currentPosition);
-                            auto tokenEnd = getEndPosition(tokenContent, tokenStart);
-                            FilePosition::Region tokenRegion = { tokenStart, tokenEnd };
-                            tokenList.AddTokenToList(tokenContent, "comment", nullptr, tokenRegion);
-                            currentPosition = tokenEnd;
-                            codeToProcess.erase(0, tokenStartIndex + tokenContent.size());
-                            if (tokenContent.find('#') >= tokenContent.size() ? false : !isStringContentValid(tokenContent.substr(tokenContent.find('#') + 1), 0)) {
-                                errors.push_back({ "Comment contains invalid content.", tokenRegion });
-                            }
-                            continue;
-                        }
+                size_t cursor = 0;
+                // Regions are only worked out for the tokens that get a
+                // diagnostic
+                auto addToken = [&](size_t tokenStartIndex, size_t tokenLength, Token::TokenKind tokenKind, Type::Type* tokenType) {
+                    tokenList.AddTokenToList(code.substr(tokenStartIndex, tokenLength), tokenKind, tokenType);
+                    cursor = tokenStartIndex + tokenLength;
+                };
+                auto lexComment = [&](size_t tokenStartIndex) {
+                    size_t tokenLength = MatchComment(code, tokenStartIndex);
+                    if (!tokenLength) {
+                        return false;
                     }
-                    // String Literal
-                    {
-                        auto [tokenType, tokenStartIndex, tokenContent] = CheckStringLiteral(codeToProcess);
-                        if (!tokenContent.empty()) {
-                            auto tokenStart = getEndPosition(codeToProcess.substr(0, tokenStartIndex), currentPosition);
-                            auto tokenEnd = getEndPosition(tokenContent, tokenStart);
-                            FilePosition::Region tokenRegion = { tokenStart, tokenEnd };
-                            tokenList.AddTokenToList(tokenContent, "string", tokenType, tokenRegion);
-                            currentPosition = tokenEnd;
-                            codeToProcess.erase(0, tokenStartIndex + tokenContent.size());
-                            if (!isStringContentValid(tokenContent, ((Type::String*)tokenType)->getType())) {
-                                errors.push_back({ "String literal contains invalid content.", tokenRegion });
-                            }
-                            continue;
-                        }
+                    addToken(tokenStartIndex, tokenLength, Token::TokenKind::Comment, nullptr);
+                    if (!isStringContentValid(code.substr(tokenStartIndex + 1, tokenLength - 1), 0)) {
+                        errors.push_back({ "Comment contains invalid content.", getRegion(tokenStartIndex, tokenLength) });
                     }
-                    // Date Time Literal
-                    {
-                        auto [tokenType, tokenStartIndex, tokenContent] = CheckDateTimeLiteral(codeToProcess);
-                        if (!tokenContent.empty()) {
-                            auto tokenStart = getEndPosition(codeToProcess.substr(0, tokenStartIndex), currentPosition);
-                            auto tokenEnd = getEndPosition(tokenContent, tokenStart);
-                            FilePosition::Region tokenRegion = { tokenStart, tokenEnd };
-                            tokenList.AddTokenToList(tokenContent, "datetime", tokenType, tokenRegion);
-                            currentPosition = tokenEnd;
-                            codeToProcess.erase(0, tokenStartIndex + tokenContent.size());
-                            continue;
-                        }
+                    return true;
+                };
+                auto lexString = [&](size_t tokenStartIndex) {
+                    auto [tokenType, tokenLength] = MatchStringLiteral(code, tokenStartIndex);
+                    if (!tokenType) {
+                        return false;
                     }
-                    // Numeric Literal
-                    {
-                        auto [tokenType, tokenStartIndex, tokenContent] = CheckNumericLiteral(codeToProcess);
-                        if (!tokenContent.empty()) {
-                            auto tokenStart = getEndPosition(codeToProcess.substr(0, tokenStartIndex), currentPosition);
-                            auto tokenEnd = getEndPosition(tokenContent, tokenStart);
-                            FilePosition::Region tokenRegion = { tokenStart, tokenEnd };
-                            tokenList.AddTokenToList(tokenContent, "number", tokenType, tokenRegion);
-                            currentPosition = tokenEnd;
-                            codeToProcess.erase(0, tokenStartIndex + tokenContent.size());
-                            if (tokenContent.size() > 3 && (tokenContent[0] == '+' || tokenContent[0] == '-') && tokenContent[1] == '0' && (tokenContent[2] == 'b' || tokenContent[2] == 'o' || tokenContent[2] == 'x')) {
-                                errors.push_back({ "Number literal in hexadecimal, octal or binary cannot have a positive or negative sign.", tokenRegion });
-                            }
-                            if (!isNumberReasonablyGrouped(tokenContent)) {
-                                warnings.push_back({ "Number literal is not grouped reasonably.", tokenRegion });
-                            }
-                            continue;
-                        }
+                    addToken(tokenStartIndex, tokenLength, Token::TokenKind::String, tokenType);
+                    if (!isStringContentValid(code.substr(tokenStartIndex, tokenLength), ((Type::String*)tokenType)->getType())) {
+                        errors.push_back({ "String literal contains invalid content.", getRegion(tokenStartIndex, tokenLength) });
                     }
-                    // Boolean Literal
-                    {
-                        auto [tokenType, tokenStartIndex, tokenContent] = CheckBooleanLiteral(codeToProcess);
-                        if (!tokenContent.empty()) {
-                            auto tokenStart = getEndPosition(codeToProcess.substr(0, tokenStartIndex), currentPosition);
-                            auto tokenEnd = getEndPosition(tokenContent, tokenStart);
-                            FilePosition::Region tokenRegion = { tokenStart, tokenEnd };
-                            tokenList.AddTokenToList(tokenContent, "boolean", new Type::Boolean(), tokenRegion);
-                            currentPosition = tokenEnd;
-                            codeToProcess.erase(0, tokenStartIndex + tokenContent.size());
-                            continue;
-                        }
+                    return true;
+                };
+                auto lexDateTime = [&](size_t tokenStartIndex) {
+                    auto [tokenType, tokenLength] = MatchDateTimeLiteral(code, tokenStartIndex);
+                    if (!tokenType) {
+                        return false;
                     }
-                    // Identifier
-                    {
-                        auto [tokenStartIndex, tokenContent] = CheckIdentifier(codeToProcess);
-                        if (!tokenContent.empty()) {
-                            auto tokenStart = getEndPosition(codeToProcess.substr(0, tokenStartIndex), currentPosition);
-                            auto tokenEnd = getEndPosition(tokenContent, tokenStart);
-                            FilePosition::Region tokenRegion = { tokenStart, tokenEnd };
-                            tokenList.AddTokenToList(tokenContent, "identifier", nullptr, tokenRegion);
-                            currentPosition = tokenEnd;
-                            codeToProcess.erase(0, tokenStartIndex + tokenContent.size());
-                            continue;
-                        }
+                    addToken(tokenStartIndex, tokenLength, Token::TokenKind::Datetime, tokenType);
+                    return true;
+                };
+                auto lexNumber = [&](size_t tokenStartIndex) {
+                    auto [tokenType, tokenLength] = MatchNumericLiteral(code, tokenStartIndex);
+                    if (!tokenType) {
+                        return false;
                     }
-                    // Punctuator
-                    {
-                        auto [tokenStartIndex, tokenContent] = CheckPunctuator(codeToProcess);
-                        if (!tokenContent.empty()) {
-                            auto tokenStart = getEndPosition(codeToProcess.substr(0, tokenStartIndex), currentPosition);
-                            auto tokenEnd = getEndPosition(tokenContent, tokenStart);
-                            FilePosition::Region tokenRegion = { tokenStart, tokenEnd };
-                            tokenList.AddTokenToList(tokenContent, "punctuator", nullptr, tokenRegion);
-                            currentPosition = tokenEnd;
-                            codeToProcess.erase(0, tokenStartIndex + tokenContent.size());
-                            continue;
-                        }
+                    addToken(tokenStartIndex, tokenLength, Token::TokenKind::Number, tokenType);
+                    std::string_view tokenContent = code.substr(tokenStartIndex, tokenLength);
+                    if (tokenContent.size() > 3 && (tokenContent[0] == '+' || tokenContent[0] == '-') && tokenContent[1] == '0' && (tokenContent[2] == 'b' || tokenContent[2] == 'o' || tokenContent[2] == 'x')) {
+                        errors.push_back({ "Number literal in hexadecimal, octal or binary cannot have a positive or negative sign.", getRegion(tokenStartIndex, tokenLength) });
                     }
-                    // Operator
-                    {
-                        auto [tokenStartIndex, tokenContent] = CheckOperator(codeToProcess);
-                        if (!tokenContent.empty()) {
-                            auto tokenStart = getEndPosition(codeToProcess.substr(0, tokenStartIndex), currentPosition);
-                            auto tokenEnd = getEndPosition(tokenContent, tokenStart);
-                            FilePosition::Region tokenRegion = { tokenStart, tokenEnd };
-                            tokenList.AddTokenToList(tokenContent, "operator", nullptr, tokenRegion);
-                            currentPosition = tokenEnd;
-                            codeToProcess.erase(0, tokenStartIndex + tokenContent.size());
-                            continue;
-                        }
+                    if (!isNumberReasonablyGrouped(tokenContent)) {
+                        warnings.push_back({ "Number literal is not grouped reasonably.", getRegion(tokenStartIndex, tokenLength) });
+                    }
+                    return true;
+                };
+                auto lexBoolean = [&](size_t tokenStartIndex) {
+                    size_t tokenLength = MatchBooleanLiteral(code, tokenStartIndex);
+                    if (!tokenLength) {
+                        return false;
+                    }
+                    addToken(tokenStartIndex, tokenLength, Token::TokenKind::Boolean, Type::Boolean::instance());
+                    return true;
+                };
+                auto lexIdentifier = [&](size_t tokenStartIndex) {
+                    size_t tokenLength = MatchIdentifier(code, tokenStartIndex);
+                    if (!tokenLength) {
+                        return false;
+                    }
+                    addToken(tokenStartIndex, tokenLength, Token::TokenKind::Identifier, nullptr);
+                    return true;
+                };
+                while (cursor < code.size()) {
+                    size_t tokenStartIndex = SkipWhitespace(code, cursor);
+                    if (tokenStartIndex == code.size()) {
+                        cursor = code.size();
+                        continue;
                     }
 
-                    if (std::regex_match(codeToProcess, std::regex(R"(\s*)"))) {
-                        auto tokenEnd = getEndPosition(codeToProcess, currentPosition);
-                        currentPosition = tokenEnd;
-                        codeToProcess.clear();
+                    // The first byte decides which kinds of token can start
+                    // here; they are tried in the same order of precedence
+                    // as always: comment, string, date time, number, boolean,
+                    // identifier, punctuator and operator.
+                    bool isTokenMatched = false;
+                    switch (GetCharClass(code[tokenStartIndex])) {
+                    case CharClass::CommentStart:
+                        isTokenMatched = lexComment(tokenStartIndex);
+                        break;
+                    case CharClass::QuoteStart:
+                        isTokenMatched = lexString(tokenStartIndex);
+                        break;
+                    case CharClass::Digit:
+                        isTokenMatched = lexDateTime(tokenStartIndex) || lexNumber(tokenStartIndex) || lexIdentifier(tokenStartIndex);
+                        break;
+                    case CharClass::Sign:
+                    case CharClass::SpecialNumberStart:
+                        isTokenMatched = lexNumber(tokenStartIndex) || lexIdentifier(tokenStartIndex);
+                        break;
+                    case CharClass::BooleanStart:
+                        isTokenMatched = lexBoolean(tokenStartIndex) || lexIdentifier(tokenStartIndex);
+                        break;
+                    case CharClass::KeyChar:
+                        isTokenMatched = lexIdentifier(tokenStartIndex);
+                        break;
+                    case CharClass::Punctuator:
+                        addToken(tokenStartIndex, MatchPunctuator(code, tokenStartIndex), Token::TokenKind::Punctuator, nullptr);
+                        isTokenMatched = true;
+                        break;
+                    case CharClass::Operator:
+                        addToken(tokenStartIndex, MatchOperator(code, tokenStartIndex), Token::TokenKind::Operator, nullptr);
+                        isTokenMatched = true;
+                        break;
+                    default:
+                        break;
+                    }
+                    if (isTokenMatched) {
                         continue;
                     }
 
                     // Unknown Content
                     if (!tokenList.IsTokenBuffered()) {
-                        tokenList.SetTokenInfo("unknown");
-                    }
-                    tokenList.AppendBufferedToken(codeToProcess[0]);
-                    if (codeToProcess[0] == '\n') {
-                        ++currentPosition.line;
-                        currentPosition.column = 0;
+                        tokenList.SetTokenInfo(Token::TokenKind::Unknown);
                     }
-                    else {
-                        ++currentPosition.column;
-                    }
-                    codeToProcess.erase(0, 1);
+                    tokenList.AppendBufferedToken(code.substr(cursor, 1));
+                    ++cursor;
                 }
                 tokenList.FlushBuffer();
-                ++currentPosition.line;
-                currentPosition.column = 0;
             }
             for (const auto& token : tokenList) {
                 auto [tokenContent, tokenType, tokenProp, tokenRegion] = token;
-                if (tokenType == "unknown") {
-                    errors.push_back({ "Unknown token: " + tokenContent + ".", tokenRegion });
+                if (tokenType == Token::TokenKind::Unknown) {
+                    errors.push_back({ "Unknown token: " + std::string(tokenContent) + ".", tokenRegion });
                 }
             }
             return tokenList;
@@ -427,7 +301,14 @@ namespace TOMLLexer {
     };
 }
 
-std::tuple<Token::TokenList<>, std::vector<std::tuple<std::string, FilePosition::Region>>, std::vector<std::tuple<std::string, FilePosition::Region>>> TomlLexerMain(std::istream& inputCode, bool multilineToken = true) {
+std::tuple<Token::TokenList<>, std::vector<std::tuple<std::string, FilePosition::Region>>, std::vector<std::tuple<std::string, FilePosition::Region>>> TomlLexerMain(std::string_view inputCode, bool multilineToken = true) {
     TOMLLexer::Lexer lexer(inputCode, multilineToken);
     return { lexer.Lex(), lexer.GetErrors(), lexer.GetWarnings() };
 }
+
+std::tuple<Token::TokenList<>, std::vector<std::tuple<std::string, FilePosition::Region>>, std::vector<std::tuple<std::string, FilePosition::Region>>> TomlLexerMain(std::istream& inputCode, bool multilineToken = true) {
+    auto inputBuffer = std::make_shared<const std::string>(std::istreambuf_iterator<char>(inputCode), std::istreambuf_iterator<char>());
+    auto result = TomlLexerMain(std::string_view(*inputBuffer), multilineToken);
+    std::get<0>(result).AdoptSource(std::move(inputBuffer));
+    return result;
+}
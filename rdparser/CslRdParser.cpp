@@ -5,9 +5,8 @@
 #include <unordered_set>
 #include <stdexcept>
 #include "../shared/Type.h"
-#include "../shared/TypeUtils.h"
 #include "../shared/Token.h"
-#include "../shared/CSLRepresentation.h"
+#include "../shared/CslRepresentation.h"
 #include "../shared/CslOperators.h"
 
 namespace CSLParser {
@@ -28,7 +27,7 @@ namespace CSLParser {
         void expect(std::string token, const std::string& msg) {
             auto [content, tokenType, prop, region] = *position;
             if (content != token) {
-                errors.push_back({ msg + ". Found: " + content, region });
+                errors.push_back({ msg + ". Found: " + std::string(content), region });
             }
         }
 
@@ -39,10 +38,10 @@ namespace CSLParser {
             }
         }
 
-        void expectType(std::string type, const std::string& msg) {
+        void expectType(Token::TokenKind type, const std::string& msg) {
             auto [content, tokenType, prop, region] = *position;
             if (tokenType != type) {
-                errors.push_back({ msg + ". Found: " + content, region });
+                errors.push_back({ msg + ". Found: " + std::string(content), region });
             }
         }
 
@@ -75,8 +74,8 @@ namespace CSLParser {
         // Parse a single config schema
         std::shared_ptr<ConfigSchema> parseConfigSchema() {
             advance(); // Consume 'config'
-            expectType("identifier", "Expected schema name after 'config'");
-            std::string name = std::get<0>(*position);
+            expectType(Token::TokenKind::Identifier, "Expected schema name after 'config'");
+            std::string name(std::get<0>(*position));
             advance();
             return std::make_shared<ConfigSchema>(name, parseTableType(), std::get<3>(*position));
         }
@@ -114,7 +113,7 @@ namespace CSLParser {
 
         // Parse a key definition (name: type;)
         TableType::KeyDefinition parseKeyDefinition() {
-            auto name = std::get<0>(*position);
+            std::string name(std::get<0>(*position));
             bool isOptional = false;
             advance();
 
@@ -210,10 +209,10 @@ namespace CSLParser {
             auto typeStart = std::get<3>(*position).start;
 
             do {
-                if (std::get<1>(*position) == "number" ||
-                    std::get<1>(*position) == "boolean" ||
-                    std::get<1>(*position) == "string" ||
-                    std::get<1>(*position) == "datetime") {
+                if (std::get<1>(*position) == Token::TokenKind::Number ||
+                    std::get<1>(*position) == Token::TokenKind::Boolean ||
+                    std::get<1>(*position) == Token::TokenKind::String ||
+                    std::get<1>(*position) == Token::TokenKind::Datetime) {
                     members.push_back(parseLiteralType());
                 }
                 else if (std::get<0>(*position) == "string") {
@@ -278,7 +277,7 @@ namespace CSLParser {
                     advance();
                 }
                 else {
-                    errors.push_back({ "Unexpected token in type: " + std::get<0>(*position), std::get<3>(*position) });
+                    errors.push_back({ "Unexpected token in type: " + std::string(std::get<0>(*position)), std::get<3>(*position) });
                 }
 
                 // Check for union operator
@@ -298,37 +297,37 @@ namespace CSLParser {
 
         std::shared_ptr<CSLType> parseLiteralType() {
             std::shared_ptr<CSLType> type;
-            if (std::get<1>(*position) == "number") {
+            if (std::get<1>(*position) == Token::TokenKind::Number) {
                 type = std::make_shared<PrimitiveType>(
-                    PrimitiveType::Primitive::Number, std::vector<std::pair<std::string, Type::Type*>>{ { std::get<0>(*position), std::get<2>(*position) } }, std::vector<std::shared_ptr<Annotation>>{}, std::get<3>(*position)
+                    PrimitiveType::Primitive::Number, std::vector<std::pair<std::string, Type::Type*>>{ { std::string(std::get<0>(*position)), std::get<2>(*position) } }, std::vector<std::shared_ptr<Annotation>>{}, std::get<3>(*position)
                 );
                 advance();
             }
-            else if (std::get<1>(*position) == "boolean") {
+            else if (std::get<1>(*position) == Token::TokenKind::Boolean) {
                 type = std::make_shared<PrimitiveType>(
-                    PrimitiveType::Primitive::Boolean, std::vector<std::pair<std::string, Type::Type*>>{ { std::get<0>(*position), std::get<2>(*position) } }, std::vector<std::shared_ptr<Annotation>>{}, std::get<3>(*position)
+                    PrimitiveType::Primitive::Boolean, std::vector<std::pair<std::string, Type::Type*>>{ { std::string(std::get<0>(*position)), std::get<2>(*position) } }, std::vector<std::shared_ptr<Annotation>>{}, std::get<3>(*position)
                 );
                 advance();
             }
-            else if (std::get<1>(*position) == "string") {
+            else if (std::get<1>(*position) == Token::TokenKind::String) {
                 type = std::make_shared<PrimitiveType>(
-                    PrimitiveType::Primitive::String, std::vector<std::pair<std::string, Type::Type*>>{ { std::get<0>(*position), std::get<2>(*position) } }, std::vector<std::shared_ptr<Annotation>>{}, std::get<3>(*position)
+                    PrimitiveType::Primitive::String, std::vector<std::pair<std::string, Type::Type*>>{ { std::string(std::get<0>(*position)), std::get<2>(*position) } }, std::vector<std::shared_ptr<Annotation>>{}, std::get<3>(*position)
                 );
                 advance();
             }
-            else if (std::get<1>(*position) == "datetime") {
+            else if (std::get<1>(*position) == Token::TokenKind::Datetime) {
                 type = std::make_shared<PrimitiveType>(
-                    PrimitiveType::Primitive::Datetime, std::vector<std::pair<std::string, Type::Type*>>{ { std::get<0>(*position), std::get<2>(*position) } }, std::vector<std::shared_ptr<Annotation>>{}, std::get<3>(*position)
+                    PrimitiveType::Primitive::Datetime, std::vector<std::pair<std::string, Type::Type*>>{ { std::string(std::get<0>(*position)), std::get<2>(*position) } }, std::vector<std::shared_ptr<Annotation>>{}, std::get<3>(*position)
                 );
                 advance();
             }
             else {
-                errors.push_back({ "Unexpected literal type: " + std::get<0>(*position), std::get<3>(*position) });
+                errors.push_back({ "Unexpected literal type: " + std::string(std::get<0>(*position)), std::get<3>(*position) });
             }
             return type;
         }
 
-        bool isGlobalAnnotation(const std::string& token) {
+        bool isGlobalAnnotation(std::string_view token) {
             return
                 token == "deprecated";
         }
@@ -414,7 +413,7 @@ namespace CSLParser {
             auto lhs = parseUnary();
 
             while (true) {
-                auto opToken = std::get<0>(*position);
+                std::string opToken(std::get<0>(*position));
                 CSLOperator::OperatorKey binKey{ opToken, 1 };
                 auto opIt = CSLOperator::operators.find(binKey);
                 if (opIt == CSLOperator::operators.end()) break;
@@ -445,7 +444,7 @@ namespace CSLParser {
 
         std::shared_ptr<Expr> parseUnary() {
             auto expressionStart = std::get<3>(*position).start;
-            CSLOperator::OperatorKey key{ std::get<0>(*position), 0 };
+            CSLOperator::OperatorKey key{ std::string(std::get<0>(*position)), 0 };
             auto it = CSLOperator::operators.find(key);
 
             if (it != CSLOperator::operators.end() && it->second.numOperand == 1) {
@@ -459,29 +458,29 @@ namespace CSLParser {
 
         std::shared_ptr<Expr> parsePrimary() {
             std::shared_ptr<Expr> expr;
-            if (std::get<1>(*position) == "string") {
-                expr = std::make_shared<LiteralExpr>(std::get<2>(*position), std::get<0>(*position), std::get<3>(*position));
+            if (std::get<1>(*position) == Token::TokenKind::String) {
+                expr = std::make_shared<LiteralExpr>(std::get<2>(*position), std::string(std::get<0>(*position)), std::get<3>(*position));
                 advance();
             }
-            else if (std::get<1>(*position) == "number") {
-                expr = std::make_shared<LiteralExpr>(std::get<2>(*position), std::get<0>(*position), std::get<3>(*position));
+            else if (std::get<1>(*position) == Token::TokenKind::Number) {
+                expr = std::make_shared<LiteralExpr>(std::get<2>(*position), std::string(std::get<0>(*position)), std::get<3>(*position));
                 advance();
             }
-            else if (std::get<1>(*position) == "boolean") {
-                expr = std::make_shared<LiteralExpr>(std::get<2>(*position), std::get<0>(*position), std::get<3>(*position));
+            else if (std::get<1>(*position) == Token::TokenKind::Boolean) {
+                expr = std::make_shared<LiteralExpr>(std::get<2>(*position), std::string(std::get<0>(*position)), std::get<3>(*position));
                 advance();
             }
-            else if (std::get<1>(*position) == "datetime") {
-                expr = std::make_shared<LiteralExpr>(std::get<2>(*position), std::get<0>(*position), std::get<3>(*position));
+            else if (std::get<1>(*position) == Token::TokenKind::Datetime) {
+                expr = std::make_shared<LiteralExpr>(std::get<2>(*position), std::string(std::get<0>(*position)), std::get<3>(*position));
                 advance();
             }
-            else if (std::get<1>(*position) == "identifier") {
-                expr = std::make_shared<IdentifierExpr>(std::get<0>(*position), std::get<3>(*position));
+            else if (std::get<1>(*position) == Token::TokenKind::Identifier) {
+                expr = std::make_shared<IdentifierExpr>(std::string(std::get<0>(*position)), std::get<3>(*position));
                 advance();
             }
-            else if (std::get<1>(*position) == "keyword") {
+            else if (std::get<1>(*position) == Token::TokenKind::Keyword) {
                 auto functionCallStart = std::get<3>(*position).start;
-                std::string name = std::get<0>(*position);
+                std::string name(std::get<0>(*position));
                 advance();
                 advance(); // Consume '('
                 std::vector<std::shared_ptr<Expr>> args;
@@ -515,7 +514,7 @@ namespace CSLParser {
                 advance(); // Consume ')'
             }
             else {
-                errors.push_back({ "Unexpected primary token: " + std::get<0>(*position), std::get<3>(*position) });
+                errors.push_back({ "Unexpected primary token: " + std::string(std::get<0>(*position)), std::get<3>(*position) });
             }
             return expr;
         }
@@ -523,7 +522,7 @@ namespace CSLParser {
         std::shared_ptr<Annotation> parseAnnotation(bool isParsingGlobalAnnotation) {
             auto annotationStart = std::get<3>(*position).start;
             advance(); // Consume '@'
-            std::string name = std::get<0>(*position);
+            std::string name(std::get<0>(*position));
             if (isParsingGlobalAnnotation) {
                 if (!isGlobalAnnotation(name)) {
                     errors.push_back({ "Found local annotation " + name + " when parsing global annotations", std::get<3>(*position) });
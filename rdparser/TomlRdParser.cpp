@@ -4,6 +4,7 @@
 #include <stack>
 #include <unordered_set>
 #include <stdexcept>
+#include <memory>
 #include "../shared/Type.h"
 #include "../shared/Token.h"
 #include "../shared/TomlCheckFunctions.h"
@@ -17,7 +18,9 @@ namespace TOMLParser {
     protected:
         Token::TokenList<>& input;
         Token::TokenList<>::iterator position;
-        std::unordered_map<size_t, DocTree::Key*> tokenDocTreeMapping;
+        // Key of each token by token ID, null for tokens that are not keys
+        std::vector<DocTree::Key*> tokenDocTreeMapping;
+        std::unique_ptr<DocTree::Document> document;
         DocTree::Table* docTree;
         DocTree::Table* lastDefinedTable;
         std::unordered_set<DocTree::Table*> headerDefinedTables;
@@ -30,12 +33,19 @@ namespace TOMLParser {
             Key,
         };
 
+        void MapTokenToKey(Token::TokenList<>::iterator tokenPosition, DocTree::Key* key) {
+            if (tokenDocTreeMapping.size() < input.size()) {
+                tokenDocTreeMapping.resize(input.size(), nullptr);
+            }
+            tokenDocTreeMapping[tokenPosition.GetIndex()] = key;
+        }
+
         bool IsIdentifierToken(Token::TokenList<>::iterator& position, bool genErrorIfNot = false) {
             bool isIdentifier = false;
-            if (std::get<1>(*position) == "identifier") {
+            if (std::get<1>(*position) == Token::TokenKind::Identifier) {
                 isIdentifier = true;
             }
-            else if (std::get<1>(*position) == "string") {
+            else if (std::get<1>(*position) == Token::TokenKind::String) {
                 auto stringType = ((Type::String*)std::get<2>(*position))->getType();
                 if (stringType == Type::String::MultiLineBasic || stringType == Type::String::MultiLineRaw) {
                     errors.push_back({ "Multi-line string cannot be used as a key.", std::get<3>(*position) });
@@ -44,54 +54,39 @@ namespace TOMLParser {
                 if (contentInString.empty()) {
                     warnings.push_back({ "Empty string key is not recommended.", std::get<3>(*position) });
                 }
-                auto [content, type, prop, region] = *position;
-                type = "identifier";
-                *position = std::make_tuple(content, type, prop, region);
+                input.SetTokenKind(position, Token::TokenKind::Identifier);
                 isIdentifier = true;
             }
-            else if (std::get<1>(*position) == "boolean") {
-                auto [content, type, prop, region] = *position;
-                type = "identifier";
-                *position = std::make_tuple(content, type, prop, region);
+            else if (std::get<1>(*position) == Token::TokenKind::Boolean) {
+                input.SetTokenKind(position, Token::TokenKind::Identifier);
                 isIdentifier = true;
             }
-            else if (std::get<1>(*position) == "number" && (dynamic_cast<Type::SpecialNumber*>(std::get<2>(*position)) || isdigit(std::get<0>(*position)[0]))) {
+            else if (std::get<1>(*position) == Token::TokenKind::Number && (Type::typeCast<Type::SpecialNumber>(std::get<2>(*position)) || isdigit(std::get<0>(*position)[0]))) {
                 auto dotPos = std::get<0>(*position).find('.');
                 if (dotPos != std::string::npos) {
                     auto [idStartIndex1, idContent1] = CheckIdentifier(std::get<0>(*position).substr(0, dotPos));
                     auto [idStartIndex2, idContent2] = CheckIdentifier(std::get<0>(*position).substr(dotPos + 1));
                     if (idContent1.size() && idContent2.size()) {
                         auto [content, type, prop, region] = *position;
-                        type = "identifier";
-                        auto tokenBeforeDotRegion = region;
-                        tokenBeforeDotRegion.end.column = tokenBeforeDotRegion.start.column + dotPos;
-                        auto tokenBeforeDot = std::make_tuple(content.substr(0, dotPos), type, Type::CopyType(prop), tokenBeforeDotRegion);
-                        auto tokenAfterDotRegion = region;
-                        tokenAfterDotRegion.start.column = tokenBeforeDotRegion.end.column + 1;
-                        auto tokenAfterDot = std::make_tuple(content.substr(dotPos + 1), type, Type::CopyType(prop), tokenAfterDotRegion);
-                        auto dotOperatorTokenRegion = region;
-                        dotOperatorTokenRegion.start.column = tokenBeforeDotRegion.end.column;
-                        dotOperatorTokenRegion.end.column = tokenAfterDotRegion.start.column;
-                        auto dotOperatorToken = std::make_tuple(".", "operator", nullptr, dotOperatorTokenRegion);
+                        // The pieces are ranges of the same source as the
+                        // number they are split from, and so are their spans
                         position = input.erase(position);
-                        position = input.insert(position, tokenAfterDot);
-                        position = input.insert(position, dotOperatorToken);
-                        position = input.insert(position, tokenBeforeDot);
+                        position = input.insert(position, content.substr(dotPos + 1), Token::TokenKind::Identifier, prop);
+                        position = input.insert(position, content.substr(dotPos, 1), Token::TokenKind::Operator);
+                        position = input.insert(position, content.substr(0, dotPos), Token::TokenKind::Identifier, prop);
                         isIdentifier = true;
                     }
                 }
                 else {
                     auto [idStartIndex, idContent] = CheckIdentifier(std::get<0>(*position));
                     if (idStartIndex == 0 && idContent.size()) {
-                        auto [content, type, prop, region] = *position;
-                        type = "identifier";
-                        *position = std::make_tuple(content, type, prop, region);
+                        input.SetTokenKind(position, Token::TokenKind::Identifier);
                         isIdentifier = true;
                     }
                 }
             }
             if (genErrorIfNot && !isIdentifier) {
-                errors.push_back({ "Expect key. Got " + std::get<0>(*position) + ".", std::get<3>(*position) });
+                errors.push_back({ "Expect key. Got " + std::string(std::get<0>(*position)) + ".", std::get<3>(*position) });
             }
             return isIdentifier;
         }
@@ -117,17 +112,20 @@ namespace TOMLParser {
                 }
             }
             if (position == input.end()) {
-                errors.push_back({ "Expect key " + (position != input.begin() ? "after " + std::get<0>(*std::prev(position)) : "at the end of the file") + ".", position != input.begin() ? std::get<3>(*std::prev(position)) : FilePosition::Region{ 0, 0, 0, 0 } });
+                errors.push_back({ "Expect key " + (position != input.begin() ? "after " + std::string(std::get<0>(*std::prev(position))) : "at the end of the file") + ".", position != input.begin() ? std::get<3>(*std::prev(position)) : FilePosition::Region{ 0, 0, 0, 0 } });
             }
             else if (IsIdentifierToken(position)) {
                 DocTree::Table* curTable = type == ParsedKeyType::Key ? lastDefinedTable : docTree;
                 do {
                     if (!curTable->getIsMutable()) {
-                        errors.push_back({ "Key " + std::get<0>(*position) + " is not mutable.", std::get<3>(*position) });
+                        errors.push_back({ "Key " + std::string(std::get<0>(*position)) + " is not mutable.", std::get<3>(*position) });
                     }
-                    auto curIdentifier = std::get<0>(*position);
+                    std::string_view curIdentifier = std::get<0>(*position);
                     if (curIdentifier.size() && (curIdentifier[0] == '\"' || curIdentifier[0] == '\'')) {
-                        curIdentifier = extractStringLiteralContent(curIdentifier, ((Type::String*)std::get<2>(*position))->getType());
+                        curIdentifier = document->intern(extractStringLiteralContent(std::string(curIdentifier), ((Type::String*)std::get<2>(*position))->getType()));
+                    }
+                    else {
+                        curIdentifier = document->intern(curIdentifier);
                     }
                     if (std::next(position) != input.end() && std::get<0>(*std::next(position)) == ".") {
                         auto keyIter = curTable->getElems().find(curIdentifier);
@@ -135,20 +133,21 @@ namespace TOMLParser {
                             if (type == ParsedKeyType::Key && headerDefinedTables.find(curTable) != headerDefinedTables.end() && lastDefinedTable != curTable) {
                                 errors.push_back({ "Parent table is already defined.", std::get<3>(*position) });
                             }
-                            auto newKey = new DocTree::Key(curIdentifier, new DocTree::Table({}, true, std::get<3>(*position), type == ParsedKeyType::Key), curTable);
+                            auto newKey = document->make<DocTree::Key>(curIdentifier, document->make<DocTree::Table>(DocTree::Table::KeyTable(), true, std::get<3>(*position), type == ParsedKeyType::Key), curTable);
                             curTable->addElem(newKey);
-                            curTable = (DocTree::Table*)std::get<1>(newKey->get());
-                            tokenDocTreeMapping[std::distance(input.begin(), position)] = newKey;
+                            curTable = (DocTree::Table*)newKey->getValue();
+                            MapTokenToKey(position, newKey);
                         }
                         else {
-                            auto curKeyValue = std::get<1>(keyIter->second->get());
-                            if (auto tableValue = dynamic_cast<DocTree::Table*>(curKeyValue)) {
+                            auto curKeyValue = keyIter->second->getValue();
+                            if (auto tableValue = DocTree::nodeCast<DocTree::Table>(curKeyValue)) {
                                 curTable = tableValue;
                             }
-                            else if (auto arrayValue = dynamic_cast<DocTree::Array*>(curKeyValue)) {
-                                auto arrElemVec = std::get<0>(arrayValue->get());
+                            else if (auto arrayValue = DocTree::nodeCast<DocTree::Array>(curKeyValue)) {
+                                arrayValue->unpack();
+                                const auto& arrElemVec = arrayValue->getElems();
                                 if (arrElemVec.empty()) {
-                                    errors.push_back({ "Array " + curIdentifier + " is empty.", std::get<3>(*position) });
+                                    errors.push_back({ "Array " + std::string(curIdentifier) + " is empty.", std::get<3>(*position) });
                                 }
                                 else {
                                     if (type == ParsedKeyType::Key) {
@@ -158,9 +157,9 @@ namespace TOMLParser {
                                 }
                             }
                             else {
-                                errors.push_back({ "Key " + curIdentifier + " is defined as a bare key.", std::get<3>(*position) });
+                                errors.push_back({ "Key " + std::string(curIdentifier) + " is defined as a bare key.", std::get<3>(*position) });
                             }
-                            tokenDocTreeMapping[std::distance(input.begin(), position)] = keyIter->second;
+                            MapTokenToKey(position, keyIter->second);
                         }
                     }
                     else {
@@ -169,58 +168,57 @@ namespace TOMLParser {
                             if (type == ParsedKeyType::Key && headerDefinedTables.find(curTable) != headerDefinedTables.end() && lastDefinedTable != curTable) {
                                 errors.push_back({ "Parent table is already defined.", std::get<3>(*position) });
                             }
-                            auto newKey = new DocTree::Key(curIdentifier, nullptr, curTable);
+                            auto newKey = document->make<DocTree::Key>(curIdentifier, nullptr, curTable);
                             curTable->addElem(newKey);
                             if (type == ParsedKeyType::Array) {
-                                lastDefinedTable = new DocTree::Table({}, true, std::get<3>(*position), true);
-                                newKey->set<1>((DocTree::DocTreeNode*)new DocTree::Array({ lastDefinedTable }, true, std::get<3>(*position)));
+                                lastDefinedTable = document->make<DocTree::Table>(DocTree::Table::KeyTable(), true, std::get<3>(*position), true);
+                                newKey->setValue(document->make<DocTree::Array>(DocTree::Array::ValueArray{ lastDefinedTable }, true, std::get<3>(*position)));
                             }
                             else if (type == ParsedKeyType::Table) {
-                                lastDefinedTable = new DocTree::Table({}, true, std::get<3>(*position), true);
-                                newKey->set<1>((DocTree::DocTreeNode*)lastDefinedTable);
+                                lastDefinedTable = document->make<DocTree::Table>(DocTree::Table::KeyTable(), true, std::get<3>(*position), true);
+                                newKey->setValue(lastDefinedTable);
                                 headerDefinedTables.insert(lastDefinedTable);
                             }
                             targetKey = newKey;
-                            tokenDocTreeMapping[std::distance(input.begin(), position)] = newKey;
+                            MapTokenToKey(position, newKey);
                         }
                         else {
                             if (type == ParsedKeyType::Array) {
-                                auto arrValue = std::get<1>(keyIter->second->get());
-                                if (auto array = dynamic_cast<DocTree::Array*>(arrValue)) {
+                                auto arrValue = keyIter->second->getValue();
+                                if (auto array = DocTree::nodeCast<DocTree::Array>(arrValue)) {
                                     if (array->getIsMutable()) {
-                                        auto& arrElemVec = array->getElems();
-                                        lastDefinedTable = new DocTree::Table({}, true, std::get<3>(*position), true);
-                                        arrElemVec.push_back(lastDefinedTable);
+                                        lastDefinedTable = document->make<DocTree::Table>(DocTree::Table::KeyTable(), true, std::get<3>(*position), true);
+                                        array->addElem(lastDefinedTable);
                                         targetKey = array;
                                     }
                                     else {
-                                        errors.push_back({ "Static array " + curIdentifier + " cannot be modified.", std::get<3>(*position) });
+                                        errors.push_back({ "Static array " + std::string(curIdentifier) + " cannot be modified.", std::get<3>(*position) });
                                     }
                                 }
                                 else {
-                                    errors.push_back({ "Key " + curIdentifier + " is not an array.", std::get<3>(*position) });
+                                    errors.push_back({ "Key " + std::string(curIdentifier) + " is not an array.", std::get<3>(*position) });
                                 }
                             }
                             else if (type == ParsedKeyType::Table) {
-                                auto tableValue = std::get<1>(keyIter->second->get());
-                                if (auto table = dynamic_cast<DocTree::Table*>(tableValue)) {
+                                auto tableValue = keyIter->second->getValue();
+                                if (auto table = DocTree::nodeCast<DocTree::Table>(tableValue)) {
                                     if (table->getIsExplicitlyDefined()) {
-                                        errors.push_back({ "Table " + curIdentifier + " is already defined.", std::get<3>(*position) });
+                                        errors.push_back({ "Table " + std::string(curIdentifier) + " is already defined.", std::get<3>(*position) });
                                     }
                                     else {
-                                        table->set<3>(true);
-                                        table->set<2>(std::get<3>(*position));
+                                        table->setIsExplicitlyDefined(true);
+                                        table->setDefPos(std::get<3>(*position));
                                         targetKey = lastDefinedTable = table;
                                     }
                                 }
                                 else {
-                                    errors.push_back({ "Key " + curIdentifier + " is not a table.", std::get<3>(*position) });
+                                    errors.push_back({ "Key " + std::string(curIdentifier) + " is not a table.", std::get<3>(*position) });
                                 }
                             }
                             else {
-                                errors.push_back({ "Key " + curIdentifier + " is already defined.", std::get<3>(*position) });
+                                errors.push_back({ "Key " + std::string(curIdentifier) + " is already defined.", std::get<3>(*position) });
                             }
-                            tokenDocTreeMapping[std::distance(input.begin(), position)] = keyIter->second;
+                            MapTokenToKey(position, keyIter->second);
                         }
                     }
                     ++position;
@@ -247,7 +245,7 @@ namespace TOMLParser {
                     if (!defComplete) {
                         if (type == ParsedKeyType::Table) {
                             if (position == input.end()) {
-                                errors.push_back({ "Expect ]" + (position != input.begin() ? " after " + std::get<0>(*std::prev(position)) : "at the end of the file") + ".", position != input.begin() ? std::get<3>(*std::prev(position)) : FilePosition::Region{ 0, 0, 0, 0 } });
+                                errors.push_back({ "Expect ]" + (position != input.begin() ? " after " + std::string(std::get<0>(*std::prev(position))) : "at the end of the file") + ".", position != input.begin() ? std::get<3>(*std::prev(position)) : FilePosition::Region{ 0, 0, 0, 0 } });
                             }
                             else {
                                 errors.push_back({ "Expect ].", std::get<3>(*position) });
@@ -255,7 +253,7 @@ namespace TOMLParser {
                         }
                         else {
                             if (position == input.end()) {
-                                errors.push_back({ "Expect ]]" + (position != input.begin() ? " after " + std::get<0>(*std::prev(position)) : "at the end of the file") + ".", position != input.begin() ? std::get<3>(*std::prev(position)) : FilePosition::Region{ 0, 0, 0, 0 } });
+                                errors.push_back({ "Expect ]]" + (position != input.begin() ? " after " + std::string(std::get<0>(*std::prev(position))) : "at the end of the file") + ".", position != input.begin() ? std::get<3>(*std::prev(position)) : FilePosition::Region{ 0, 0, 0, 0 } });
                             }
                             else {
                                 errors.push_back({ "Expect ]].", std::get<3>(*position) });
@@ -265,7 +263,7 @@ namespace TOMLParser {
                 }
             }
             else {
-                errors.push_back({ "Expect key. Got " + std::get<0>(*position) + ".", std::get<3>(*position) });
+                errors.push_back({ "Expect key. Got " + std::string(std::get<0>(*position)) + ".", std::get<3>(*position) });
             }
             return { type, targetKey };
         }
@@ -282,7 +280,7 @@ namespace TOMLParser {
                 return;
             }
             if (std::get<0>(*position) != "=") {
-                errors.push_back({ "Expect =. Got " + std::get<0>(*position) + ".", std::get<3>(*position) });
+                errors.push_back({ "Expect =. Got " + std::string(std::get<0>(*position)) + ".", std::get<3>(*position) });
             }
             else {
                 ++position;
@@ -292,10 +290,10 @@ namespace TOMLParser {
                 return;
             }
             if (std::get<0>(*position) != "[" && std::get<0>(*position) != "{") {
-                errors.push_back({ "Expect [ or {. Got " + std::get<0>(*position) + ".", std::get<3>(*position) });
+                errors.push_back({ "Expect [ or {. Got " + std::string(std::get<0>(*position)) + ".", std::get<3>(*position) });
             }
-            std::stack<FilePosition::Region> squareParenStack;
-            std::stack<FilePosition::Region> curlParenStack;
+            std::stack<FilePosition::Region, std::vector<FilePosition::Region>> squareParenStack;
+            std::stack<FilePosition::Region, std::vector<FilePosition::Region>> curlParenStack;
             do {
                 if (std::get<0>(*position) == "[") {
                     squareParenStack.push(std::get<3>(*position));
@@ -331,23 +329,29 @@ namespace TOMLParser {
             }
         }
 
-        DocTree::DocTreeNode* ParseValue() {
+        // Parse a value. Scalars of an array are added to the array, which
+        // is returned for them, so that no node is made for the elements
+        // the array keeps packed.
+        DocTree::DocTreeNode* ParseValue(DocTree::Array* array = nullptr) {
             if (position == input.end()) {
                 errors.push_back({ "Expect a value for the assignment.", std::get<3>(*std::prev(position)) });
                 return nullptr;
             }
             DocTree::DocTreeNode* parsedValue = nullptr;
-            std::stack<FilePosition::Region> squareParenStack;
-            std::stack<FilePosition::Region> curlParenStack;
+            std::stack<FilePosition::Region, std::vector<FilePosition::Region>> squareParenStack;
+            std::stack<FilePosition::Region, std::vector<FilePosition::Region>> curlParenStack;
             do {
                 if (std::get<0>(*position) == "[") {
                     squareParenStack.push(std::get<3>(*position));
                     ++position;
-                    parsedValue = new DocTree::Array({}, false, {});
+                    auto parsedArray = document->make<DocTree::Array>(DocTree::Array::ValueArray(), false, FilePosition::Region{});
+                    parsedValue = parsedArray;
                     while (position != input.end() && std::get<0>(*position) != "]") {
-                        auto arrElem = ParseValue();
+                        auto arrElem = ParseValue(parsedArray);
                         if (arrElem) {
-                            ((DocTree::Array*)parsedValue)->getElems().push_back(arrElem);
+                            if (arrElem != parsedArray) {
+                                parsedArray->addElem(arrElem);
+                            }
                             if (position == input.end()) {
                                 errors.push_back({ "Expect either a , or a ].", std::get<3>(*std::prev(position)) });
                             }
@@ -358,7 +362,7 @@ namespace TOMLParser {
                                 errors.push_back({ "Expect either a , or a ].", std::get<3>(*std::prev(position)) });
                             }
                         }
-                        else if (std::get<1>(*std::prev(position)) != "comment") {
+                        else if (std::get<1>(*std::prev(position)) != Token::TokenKind::Comment) {
                             errors.push_back({ "Expect an array element.", std::get<3>(*std::prev(position)) });
                         }
                     }
@@ -368,7 +372,7 @@ namespace TOMLParser {
                     auto tableDefStart = std::get<3>(*position).start;
                     bool allowMultiLine = false;
                     ++position;
-                    parsedValue = new DocTree::Table({}, true, {}, false);
+                    parsedValue = document->make<DocTree::Table>(DocTree::Table::KeyTable(), true, FilePosition::Region{}, false);
                     while (position != input.end() && std::get<0>(*position) != "}") {
                         auto curLastDefinedTable = lastDefinedTable;
                         lastDefinedTable = (DocTree::Table*)parsedValue;
@@ -378,12 +382,12 @@ namespace TOMLParser {
                             errors.push_back({ "Expect a key-value pair.", std::get<3>(*std::prev(position)) });
                         }
                         else {
-                            auto [keyId, keyValue, keyParentTable] = parsedKey->get();
-                            if (dynamic_cast<DocTree::Array*>(keyValue) || dynamic_cast<DocTree::Table*>(keyValue)) {
+                            auto keyValue = parsedKey->getValue();
+                            if (DocTree::nodeCast<DocTree::Array>(keyValue) || DocTree::nodeCast<DocTree::Table>(keyValue)) {
                                 allowMultiLine = true;
                             }
-                            else if (auto value = dynamic_cast<DocTree::Value*>(keyValue)) {
-                                auto stringValue = dynamic_cast<Type::String*>(std::get<0>(value->get()));
+                            else if (auto value = DocTree::nodeCast<DocTree::Value>(keyValue)) {
+                                auto stringValue = Type::typeCast<Type::String>(value->getType());
                                 if (stringValue && (stringValue->getType() == Type::String::MultiLineBasic || stringValue->getType() == Type::String::MultiLineRaw)) {
                                     allowMultiLine = true;
                                 }
@@ -400,7 +404,7 @@ namespace TOMLParser {
                         }
                     }
                     ((DocTree::Table*)parsedValue)->seal();
-                    ((DocTree::Table*)parsedValue)->set<3>(true);
+                    ((DocTree::Table*)parsedValue)->setIsExplicitlyDefined(true);
                     if (position != input.end() && std::get<0>(*position) == "}") {
                         auto tableDefEnd = std::get<3>(*position).end;
                         if (std::get<0>(*std::prev(position)) == ",") {
@@ -424,25 +428,24 @@ namespace TOMLParser {
                         ++position;
                     }
                 }
-                else if (std::get<1>(*position) == "comment") {
+                else if (std::get<1>(*position) == Token::TokenKind::Comment) {
                     ++position;
                 }
                 else {
                     auto valueType = std::get<2>(*position);
-                    if (!dynamic_cast<Type::String*>(valueType) &&
-                        !dynamic_cast<Type::Integer*>(valueType) &&
-                        !dynamic_cast<Type::Float*>(valueType) &&
-                        !dynamic_cast<Type::SpecialNumber*>(valueType) &&
-                        !dynamic_cast<Type::Boolean*>(valueType) &&
-                        !dynamic_cast<Type::DateTime*>(valueType)) {
-                        errors.push_back({ "Type of " + std::get<0>(*position) + " is not string, integer, floating-point, NaN, infinity, boolean or date-time.", std::get<3>(*position) });
+                    if (!valueType || valueType->getKind() == Type::Type::Kind::Invalid) {
+                        errors.push_back({ "Type of " + std::string(std::get<0>(*position)) + " is not string, integer, floating-point, NaN, infinity, boolean or date-time.", std::get<3>(*position) });
+                    }
+                    else if (array) {
+                        array->addValue(valueType, std::get<0>(*position));
+                        parsedValue = array;
                     }
                     else {
-                        parsedValue = new DocTree::Value(valueType, std::get<0>(*position), {});
+                        parsedValue = document->make<DocTree::Value>(valueType, std::get<0>(*position), FilePosition::Region{});
                     }
                     ++position;
                 }
-            } while (position != input.end() && (std::get<1>(*position) == "comment" || !(squareParenStack.empty() && curlParenStack.empty())));
+            } while (position != input.end() && (std::get<1>(*position) == Token::TokenKind::Comment || !(squareParenStack.empty() && curlParenStack.empty())));
             while (!squareParenStack.empty()) {
                 errors.push_back({ "Unbalanced [.", squareParenStack.top() });
                 squareParenStack.pop();
@@ -455,7 +458,7 @@ namespace TOMLParser {
         }
 
         DocTree::Key* ParseStatement(bool requireStartFromNewLine, bool assignmentOnly) {
-            while (position != input.end() && std::get<1>(*position) == "comment") {
+            while (position != input.end() && std::get<1>(*position) == Token::TokenKind::Comment) {
                 ++position;
             }
             if (requireStartFromNewLine && position != input.end() && position != input.begin() && std::get<3>(*position).start.line == std::get<3>(*std::prev(position)).end.line) {
@@ -473,7 +476,7 @@ namespace TOMLParser {
                     else {
                         auto keyDefPos = std::get<3>(*std::prev(position));
                         if (std::get<0>(*position) != "=") {
-                            errors.push_back({ "Expect =. Got " + std::get<0>(*position) + ".", std::get<3>(*position) });
+                            errors.push_back({ "Expect =. Got " + std::string(std::get<0>(*position)) + ".", std::get<3>(*position) });
                         }
                         else if (std::next(position) == input.end()) {
                             errors.push_back({ "Expect an assignment.", position == input.begin() ? FilePosition::Region{ 0, 0, 0, 0 } : std::get<3>(*std::prev(position)) });
@@ -486,15 +489,15 @@ namespace TOMLParser {
                         }
                         auto value = ParseValue();
                         if (value) {
-                            ((DocTree::Key*)targetKey)->set<1>(value);
-                            if (auto arrayValue = dynamic_cast<DocTree::Array*>(value)) {
-                                arrayValue->set<2>(keyDefPos);
+                            ((DocTree::Key*)targetKey)->setValue(value);
+                            if (auto arrayValue = DocTree::nodeCast<DocTree::Array>(value)) {
+                                arrayValue->setDefPos(keyDefPos);
                             }
-                            else if (auto tableValue = dynamic_cast<DocTree::Table*>(value)) {
-                                tableValue->set<2>(keyDefPos);
+                            else if (auto tableValue = DocTree::nodeCast<DocTree::Table>(value)) {
+                                tableValue->setDefPos(keyDefPos);
                             }
-                            else if (auto valueValue = dynamic_cast<DocTree::Value*>(value)) {
-                                valueValue->set<2>(keyDefPos);
+                            else if (auto valueValue = DocTree::nodeCast<DocTree::Value>(value)) {
+                                valueValue->setDefPos(keyDefPos);
                             }
                         }
                         else {
@@ -514,25 +517,27 @@ namespace TOMLParser {
                     SkipToNextDefine();
                 }
             }
-            return dynamic_cast<DocTree::Key*>(targetKey);
+            return DocTree::nodeCast<DocTree::Key>(targetKey);
         }
 
     public:
         RecursiveDescentParser(Token::TokenList<>& input) :
             input(input),
             position(input.begin()),
-            docTree(new DocTree::Table({}, true, {}, false)),
+            document(std::make_unique<DocTree::Document>()),
+            docTree(document->getRoot()),
             lastDefinedTable(docTree) {
         }
 
-        DocTree::Table* ParseDocument() {
+        std::unique_ptr<DocTree::Document> ParseDocument() {
             while (position != input.end()) {
                 ParseStatement(true, false);
             }
-            return docTree;
+            return std::move(document);
         }
 
-        std::unordered_map<size_t, DocTree::Key*> GetTokenDocTreeMapping() {
+        std::vector<DocTree::Key*> GetTokenDocTreeMapping() {
+            tokenDocTreeMapping.resize(input.size(), nullptr);
             return tokenDocTreeMapping;
         }
 
@@ -546,7 +551,7 @@ namespace TOMLParser {
     };
 }
 
-std::tuple<DocTree::Table*, std::vector<std::tuple<std::string, FilePosition::Region>>, std::vector<std::tuple<std::string, FilePosition::Region>>, std::unordered_map<size_t, DocTree::Key*>> TomlRdparserMain(Token::TokenList<>& tokenList) {
+std::tuple<std::unique_ptr<DocTree::Document>, std::vector<std::tuple<std::string, FilePosition::Region>>, std::vector<std::tuple<std::string, FilePosition::Region>>, std::vector<DocTree::Key*>> TomlRdparserMain(Token::TokenList<>& tokenList) {
     TOMLParser::RecursiveDescentParser rdparser(tokenList);
     return { rdparser.ParseDocument(), rdparser.GetErrors(), rdparser.GetWarnings(), rdparser.GetTokenDocTreeMapping() };
 }
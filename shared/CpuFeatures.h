@@ -0,0 +1,58 @@
+#pragma once
+
+#ifndef CPU_FEATURES_H
+#define CPU_FEATURES_H
+
+#if (defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)) && !defined(__EMSCRIPTEN__)
+#define SIMD_X86
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#include <immintrin.h>
+#endif
+
+// Kernels built for an instruction set the build does not target by
+// default are marked with SIMD_TARGET and only called after checking
+// GetCpuFeatures. MSVC allows the intrinsics without any marking.
+#if defined(SIMD_X86) && (defined(__GNUC__) || defined(__clang__))
+#define SIMD_TARGET(isa) __attribute__((target(isa)))
+#else
+#define SIMD_TARGET(isa)
+#endif
+
+struct CpuFeatures {
+    bool hasSse41 = false;
+    bool hasAvx2 = false;
+};
+
+#ifndef DEF_GLOBAL
+extern const CpuFeatures& GetCpuFeatures();
+#else
+const CpuFeatures& GetCpuFeatures() {
+    static const CpuFeatures cpuFeatures = [] {
+        CpuFeatures features;
+#ifdef SIMD_X86
+#ifdef _MSC_VER
+        int cpuInfo[4];
+        __cpuid(cpuInfo, 0);
+        int maxLeaf = cpuInfo[0];
+        __cpuid(cpuInfo, 1);
+        features.hasSse41 = cpuInfo[2] & (1 << 19);
+        // AVX2 also needs the OS to save the YMM registers
+        if (maxLeaf >= 7 && (cpuInfo[2] & (1 << 27)) && (cpuInfo[2] & (1 << 28)) && (_xgetbv(0) & 6) == 6) {
+            __cpuidex(cpuInfo, 7, 0);
+            features.hasAvx2 = cpuInfo[1] & (1 << 5);
+        }
+#else
+        __builtin_cpu_init();
+        features.hasSse41 = __builtin_cpu_supports("sse4.1");
+        features.hasAvx2 = __builtin_cpu_supports("avx2");
+#endif
+#endif
+        return features;
+    }();
+    return cpuFeatures;
+}
+#endif
+
+#endif
@@ -5,22 +5,29 @@
 
 #include <tuple>
 #include <string>
+#include <string_view>
 #include <regex>
+#include <cctype>
 #include "Type.h"
-#include "TypeUtils.h"
 #include "CslOperators.h"
+#include "DateTimeConversion.h"
 
 namespace CSL {
+    // The Check* functions only accept a match at the very start of their
+    // input, so the searches are anchored there and never scan the rest
+    // of the buffer.
+    using StringViewMatch = std::match_results<std::string_view::const_iterator>;
+
 #ifndef DEF_GLOBAL
-    extern std::tuple<size_t, std::string> CheckIdentifier(std::string strToCheck);
+    extern std::tuple<size_t, std::string> CheckIdentifier(std::string_view strToCheck);
 #else
-    std::tuple<size_t, std::string> CheckIdentifier(std::string strToCheck) {
+    std::tuple<size_t, std::string> CheckIdentifier(std::string_view strToCheck) {
         size_t identifierStartIndex;
         std::string identifierContent;
         std::regex bareIdentifierRegex(R"(^(\s*)([a-zA-Z_][a-zA-Z0-9_]*))");
         std::regex quotedIdentifierRegex(R"(^(\s*)((`([^`\\]|\\.)*`)|(R`([^()\\]{0,16})\(((.|\n)*?)\)\6`)))");
-        std::smatch match;
-        if (std::regex_search(strToCheck, match, bareIdentifierRegex) && !match.prefix().length()) {
+        StringViewMatch match;
+        if (std::regex_search(strToCheck.begin(), strToCheck.end(), match, bareIdentifierRegex, std::regex_constants::match_continuous) && !match.prefix().length()) {
             identifierStartIndex = match[1].length();
             identifierContent = match[0].str().substr(identifierStartIndex);
             if (identifierContent == "true" || identifierContent == "false") {
@@ -28,7 +35,7 @@ namespace CSL {
                 identifierContent = "";
             }
         }
-        else if (std::regex_search(strToCheck, match, quotedIdentifierRegex) && !match.prefix().length()) {
+        else if (std::regex_search(strToCheck.begin(), strToCheck.end(), match, quotedIdentifierRegex, std::regex_constants::match_continuous) && !match.prefix().length()) {
             identifierStartIndex = match[1].length();
             identifierContent = match[0].str().substr(identifierStartIndex);
         }
@@ -37,38 +44,38 @@ namespace CSL {
 #endif
 
 #ifndef DEF_GLOBAL
-    extern std::tuple<Type::Type*, size_t, std::string> CheckNumericLiteral(std::string strToCheck);
+    extern std::tuple<Type::Type*, size_t, std::string> CheckNumericLiteral(std::string_view strToCheck);
 #else
-    std::tuple<Type::Type*, size_t, std::string> CheckNumericLiteral(std::string strToCheck) {
+    std::tuple<Type::Type*, size_t, std::string> CheckNumericLiteral(std::string_view strToCheck) {
         Type::Type* literalType = nullptr;
         size_t literalStartIndex;
         std::string literalContent;
         std::regex integerLiteralRegex(R"(^(\s*)(0(?![xob])|[1-9]+(_?\d+)*|0x[\da-fA-F]+(_?[\da-fA-F]+)*|0o[0-7]+(_?[0-7]+)*|0b[01]+(_?[01]+)*))");
         std::regex floatLiteralRegex(R"(^(\s*)((0(?![xob])|[1-9]+(_?\d+)*)(\.((\d+_)*\d+))?(e[-+]?\d+(_?\d+)*)?))");
         std::regex specialNumLiteralRegex(R"(^(\s*)((nan|inf)(?![-\w])))");
-        std::smatch match;
-        if (std::regex_search(strToCheck, match, specialNumLiteralRegex) && !match.prefix().length()) {
+        StringViewMatch match;
+        if (std::regex_search(strToCheck.begin(), strToCheck.end(), match, specialNumLiteralRegex, std::regex_constants::match_continuous) && !match.prefix().length()) {
             auto matchedStr = match[3].str();
-            literalType = new Type::SpecialNumber(matchedStr == "nan" ? Type::SpecialNumber::NaN : Type::SpecialNumber::Infinity);
+            literalType = Type::SpecialNumber::instance(matchedStr == "nan" ? Type::SpecialNumber::NaN : Type::SpecialNumber::Infinity);
         }
         else {
             bool matched = false;
-            std::smatch integerMatch;
-            std::smatch floatMatch;
-            if (std::regex_search(strToCheck, integerMatch, integerLiteralRegex) && !integerMatch.prefix().length()) {
+            StringViewMatch integerMatch;
+            StringViewMatch floatMatch;
+            if (std::regex_search(strToCheck.begin(), strToCheck.end(), integerMatch, integerLiteralRegex, std::regex_constants::match_continuous) && !integerMatch.prefix().length()) {
                 matched = true;
             }
-            if (std::regex_search(strToCheck, floatMatch, floatLiteralRegex) && !floatMatch.prefix().length()) {
+            if (std::regex_search(strToCheck.begin(), strToCheck.end(), floatMatch, floatLiteralRegex, std::regex_constants::match_continuous) && !floatMatch.prefix().length()) {
                 matched = true;
             }
             if (matched) {
                 if (integerMatch[0].length() >= floatMatch[0].length()) {
                     match = integerMatch;
-                    literalType = new Type::Integer();
+                    literalType = Type::Integer::instance();
                 }
                 else {
                     match = floatMatch;
-                    literalType = new Type::Float();
+                    literalType = Type::Float::instance();
                 }
             }
         }
@@ -79,7 +86,6 @@ namespace CSL {
             if (literalContent.length() < identifierContent.length()) {
                 literalStartIndex = 0;
                 literalContent = "";
-                Type::DeleteType(literalType);
                 literalType = nullptr;
             }
         }
@@ -88,16 +94,16 @@ namespace CSL {
 #endif
 
 #ifndef DEF_GLOBAL
-    extern std::tuple<Type::Type*, size_t, std::string> CheckBooleanLiteral(std::string strToCheck);
+    extern std::tuple<Type::Type*, size_t, std::string> CheckBooleanLiteral(std::string_view strToCheck);
 #else
-    std::tuple<Type::Type*, size_t, std::string> CheckBooleanLiteral(std::string strToCheck) {
+    std::tuple<Type::Type*, size_t, std::string> CheckBooleanLiteral(std::string_view strToCheck) {
         Type::Type* literalType = nullptr;
         size_t literalStartIndex;
         std::string literalContent;
         std::regex boolLiteralRegex(R"(^(\s*)((true|false)(?![-\w])))");
-        std::smatch match;
-        if (std::regex_search(strToCheck, match, boolLiteralRegex) && !match.prefix().length()) {
-            literalType = new Type::Boolean();
+        StringViewMatch match;
+        if (std::regex_search(strToCheck.begin(), strToCheck.end(), match, boolLiteralRegex, std::regex_constants::match_continuous) && !match.prefix().length()) {
+            literalType = Type::Boolean::instance();
             literalStartIndex = match[1].length();
             literalContent = match[0].str().substr(literalStartIndex);
         }
@@ -106,14 +112,14 @@ namespace CSL {
 #endif
 
 #ifndef DEF_GLOBAL
-    extern std::tuple<size_t, std::string> CheckKeyword(std::string strToCheck);
+    extern std::tuple<size_t, std::string> CheckKeyword(std::string_view strToCheck);
 #else
-    std::tuple<size_t, std::string> CheckKeyword(std::string strToCheck) {
+    std::tuple<size_t, std::string> CheckKeyword(std::string_view strToCheck) {
         size_t keywordStartIndex;
         std::string keywordContent;
         std::regex keywordRegex(R"(^(\s*)((config|constraints|requires|conflicts|with|validate|exists|count_keys|all_keys|wildcard_keys|subset|\*)(?![-\w])))");
-        std::smatch match;
-        if (std::regex_search(strToCheck, match, keywordRegex) && !match.prefix().length()) {
+        StringViewMatch match;
+        if (std::regex_search(strToCheck.begin(), strToCheck.end(), match, keywordRegex, std::regex_constants::match_continuous) && !match.prefix().length()) {
             keywordStartIndex = match[1].length();
             keywordContent = match[0].str().substr(keywordStartIndex);
         }
@@ -122,14 +128,14 @@ namespace CSL {
 #endif
 
 #ifndef DEF_GLOBAL
-    extern std::tuple<size_t, std::string> CheckType(std::string strToCheck);
+    extern std::tuple<size_t, std::string> CheckType(std::string_view strToCheck);
 #else
-    std::tuple<size_t, std::string> CheckType(std::string strToCheck) {
+    std::tuple<size_t, std::string> CheckType(std::string_view strToCheck) {
         size_t keywordStartIndex;
         std::string keywordContent;
         std::regex keywordRegex(R"(^(\s*)((any\{\}|any\[\]|string|number|boolean|datetime|duration)(?![-\w])))");
-        std::smatch match;
-        if (std::regex_search(strToCheck, match, keywordRegex) && !match.prefix().length()) {
+        StringViewMatch match;
+        if (std::regex_search(strToCheck.begin(), strToCheck.end(), match, keywordRegex, std::regex_constants::match_continuous) && !match.prefix().length()) {
             keywordStartIndex = match[1].length();
             keywordContent = match[0].str().substr(keywordStartIndex);
         }
@@ -138,7 +144,7 @@ namespace CSL {
 #endif
 
 #ifndef DEF_GLOBAL
-    extern std::tuple<size_t, std::string> CheckOperator(std::string strToCheck);
+    extern std::tuple<size_t, std::string> CheckOperator(std::string_view strToCheck);
 #else
     std::string escapeRegex(const std::string& str) {
         static const std::string specialChars = ".^$|()[]{}*+?\\";
@@ -152,7 +158,7 @@ namespace CSL {
         return escaped;
     }
 
-    std::tuple<size_t, std::string> CheckOperator(std::string strToCheck) {
+    std::tuple<size_t, std::string> CheckOperator(std::string_view strToCheck) {
         std::vector<std::string> operatorStrList;
         for (const auto& pair : CSLOperator::operators) {
             operatorStrList.push_back(pair.first.operatorText);
@@ -171,8 +177,8 @@ namespace CSL {
         size_t operatorStartIndex;
         std::string operatorContent;
         std::regex operatorRegex(regexPattern);
-        std::smatch match;
-        if (std::regex_search(strToCheck, match, operatorRegex) && !match.prefix().length()) {
+        StringViewMatch match;
+        if (std::regex_search(strToCheck.begin(), strToCheck.end(), match, operatorRegex, std::regex_constants::match_continuous) && !match.prefix().length()) {
             operatorStartIndex = match[1].length();
             operatorContent = match[0].str().substr(operatorStartIndex);
         }
@@ -181,85 +187,32 @@ namespace CSL {
 #endif
 
 #ifndef DEF_GLOBAL
-    extern std::tuple<Type::Type*, size_t, std::string> CheckDateTimeLiteral(std::string strToCheck);
+    extern std::tuple<Type::Type*, size_t, std::string> CheckDateTimeLiteral(std::string_view strToCheck);
 #else
-    bool isLeapYear(int year) {
-        return (year % 4 == 0 && year % 100 != 0) || (year % 400 == 0);
-    }
-
-    bool isValidDatePart(const std::string& part, int min, int max) {
-        if (part.empty() || part.size() > 2 || !std::all_of(part.begin(), part.end(), ::isdigit)) {
-            return false;
-        }
-        int value = std::stoi(part);
-        return value >= min && value <= max;
-    }
-
-    bool isValidDate(const std::string& dateStr) {
-        if (dateStr.length() != 10 || dateStr[4] != '-' || dateStr[7] != '-') {
-            return false;
-        }
-
-        std::string yearStr = dateStr.substr(0, 4);
-        std::string monthStr = dateStr.substr(5, 2);
-        std::string dayStr = dateStr.substr(8, 2);
-
-        // Check if all characters are digits
-        if (!std::all_of(yearStr.begin(), yearStr.end(), ::isdigit)) return false;
-
-        int year = std::stoi(yearStr);
-        int month = std::stoi(monthStr);
-        int day = std::stoi(dayStr);
-
-        if (year < 1 || month < 1 || month > 12) return false;
-
-        // Days in each month
-        int daysInMonth[] = { 31, isLeapYear(year) ? 29 : 28, 31, 30, 31, 30,
-                              31, 31, 30, 31, 30, 31 };
-
-        if (day < 1 || day > daysInMonth[month - 1]) return false;
-
-        return true;
-    }
-
-    std::tuple<Type::Type*, size_t, std::string> CheckDateTimeLiteral(std::string strToCheck) {
-        Type::Type* literalType = nullptr;
-        size_t literalStartIndex;
-        std::string literalContent;
-        std::regex offsetDateTimeRegex(R"(^(\s*)((\d{4}-\d{2}-\d{2})[Tt ]([01]\d|2[0-3]):[0-5]\d:[0-5]\d(\.\d+)?([Zz]|[+-]([01]\d|2[0-3]):[0-5]\d)))");
-        std::regex localDateTimeRegex(R"(^(\s*)((\d{4}-\d{2}-\d{2})[Tt ]([01]\d|2[0-3]):[0-5]\d:[0-5]\d(\.\d+)?))");
-        std::regex localDateRegex(R"(^(\s*)(\d{4}-\d{2}-\d{2}))");
-        std::regex localTimeRegex(R"(^(\s*)(([01]\d|2[0-3]):[0-5]\d:[0-5]\d(\.\d+)?))");
-        std::smatch match;
-        if (std::regex_search(strToCheck, match, offsetDateTimeRegex) && !match.prefix().length() && isValidDate(match[3].str())) {
-            literalType = new Type::DateTime(Type::DateTime::OffsetDateTime);
-        }
-        else if (std::regex_search(strToCheck, match, localDateTimeRegex) && !match.prefix().length() && isValidDate(match[3].str())) {
-            literalType = new Type::DateTime(Type::DateTime::LocalDateTime);
+    std::tuple<Type::Type*, size_t, std::string> CheckDateTimeLiteral(std::string_view strToCheck) {
+        // \s*
+        size_t literalStartIndex = 0;
+        while (literalStartIndex < strToCheck.size() && std::isspace(static_cast<unsigned char>(strToCheck[literalStartIndex]))) {
+            ++literalStartIndex;
         }
-        else if (std::regex_search(strToCheck, match, localDateRegex) && !match.prefix().length() && isValidDate(match[2].str())) {
-            literalType = new Type::DateTime(Type::DateTime::LocalDate);
+        DateTimeValue dateTime;
+        size_t literalLength = DecodeDateTimeLiteral(strToCheck, literalStartIndex, dateTime);
+        if (!literalLength) {
+            return { nullptr, 0, "" };
         }
-        else if (std::regex_search(strToCheck, match, localTimeRegex) && !match.prefix().length()) {
-            literalType = new Type::DateTime(Type::DateTime::LocalTime);
-        }
-        if (literalType) {
-            literalStartIndex = match[1].length();
-            literalContent = match[0].str().substr(literalStartIndex);
-        }
-        return { literalType, literalStartIndex, literalContent };
+        return { Type::DateTime::instance(dateTime.getKind()), literalStartIndex, std::string(strToCheck.substr(literalStartIndex, literalLength)) };
     }
 #endif
 
 #ifndef DEF_GLOBAL
-    extern std::tuple<size_t, std::string> CheckPunctuator(std::string strToCheck);
+    extern std::tuple<size_t, std::string> CheckPunctuator(std::string_view strToCheck);
 #else
-    std::tuple<size_t, std::string> CheckPunctuator(std::string strToCheck) {
+    std::tuple<size_t, std::string> CheckPunctuator(std::string_view strToCheck) {
         size_t punctuatorStartIndex;
         std::string punctuatorContent;
         std::regex punctuatorRegex(R"(^(\s*)(\{|\}|\[|\]|,|:|;|@|=>))");
-        std::smatch match;
-        if (std::regex_search(strToCheck, match, punctuatorRegex) && !match.prefix().length()) {
+        StringViewMatch match;
+        if (std::regex_search(strToCheck.begin(), strToCheck.end(), match, punctuatorRegex, std::regex_constants::match_continuous) && !match.prefix().length()) {
             punctuatorStartIndex = match[1].length();
             punctuatorContent = match[0].str().substr(punctuatorStartIndex);
         }
@@ -268,14 +221,14 @@ namespace CSL {
 #endif
 
 #ifndef DEF_GLOBAL
-    extern std::tuple<size_t, std::string> CheckComment(std::string strToCheck);
+    extern std::tuple<size_t, std::string> CheckComment(std::string_view strToCheck);
 #else
-    std::tuple<size_t, std::string> CheckComment(std::string strToCheck) {
+    std::tuple<size_t, std::string> CheckComment(std::string_view strToCheck) {
         size_t commentStartIndex;
         std::string commentContent;
-        std::regex commentRegex(R"(^(\s*)(//[^\n]*))");
-        std::smatch match;
-        if (std::regex_search(strToCheck, match, commentRegex) && !match.prefix().length()) {
+        std::regex commentRegex(R"(^(\s*)(//(?:[^\r\n]|\r(?!\n))*))");
+        StringViewMatch match;
+        if (std::regex_search(strToCheck.begin(), strToCheck.end(), match, commentRegex, std::regex_constants::match_continuous) && !match.prefix().length()) {
             commentStartIndex = match[1].length();
             commentContent = match[0].str().substr(commentStartIndex);
         }
@@ -284,18 +237,18 @@ namespace CSL {
 #endif
 
 #ifndef DEF_GLOBAL
-    extern std::tuple<Type::Type*, size_t, std::string> CheckStringLiteral(std::string strToCheck);
+    extern std::tuple<Type::Type*, size_t, std::string> CheckStringLiteral(std::string_view strToCheck);
 #else
-    std::tuple<Type::Type*, size_t, std::string> CheckStringLiteral(std::string strToCheck) {
+    std::tuple<Type::Type*, size_t, std::string> CheckStringLiteral(std::string_view strToCheck) {
         Type::Type* literalType = nullptr;
         size_t literalStartIndex;
         std::string literalContent;
         std::regex stringLiteralRegex(R"(^(\s*)((\"([^\"\\]|\\.)*\")|(R\"([^()\\]{0,16})\(((.|\n)*?)\)\6\")))");
-        std::smatch match;
-        if (std::regex_search(strToCheck, match, stringLiteralRegex) && !match.prefix().length()) {
+        StringViewMatch match;
+        if (std::regex_search(strToCheck.begin(), strToCheck.end(), match, stringLiteralRegex, std::regex_constants::match_continuous) && !match.prefix().length()) {
             literalStartIndex = match[1].length();
             literalContent = match[0].str().substr(literalStartIndex);
-            literalType = new Type::String(literalContent[0] == 'R' ? (literalContent.find('\n') == std::string::npos ? Type::String::Raw : Type::String::MultiLineRaw) : (literalContent.find('\n') == std::string::npos ? Type::String::Basic : Type::String::MultiLineBasic));
+            literalType = Type::String::instance(literalContent[0] == 'R' ? (literalContent.find('\n') == std::string::npos ? Type::String::Raw : Type::String::MultiLineRaw) : (literalContent.find('\n') == std::string::npos ? Type::String::Basic : Type::String::MultiLineBasic));
         }
         return { literalType, literalStartIndex, literalContent };
     }
@@ -305,7 +258,7 @@ namespace CSL {
     extern bool HasIncompleteStringOrId(std::string input);
 #else
     bool HasIncompleteStringOrId(std::string input) {
-        std::regex commentRegex(R"(//[^\n]*)");
+        std::regex commentRegex(R"(//(?:[^\r\n]|\r(?!\n))*)");
         std::regex stringLiteralRegex(R"((\"([^\"\\]|\\.)*\")|(R\"([^()\\]{0,16})\(((.|\n)*?)\)\4\"))");
         std::regex quotedIdentifierRegex(R"((`([^`\\]|\\.)*`)|(R`([^()\\]{0,16})\(((.|\n)*?)\)\4`))");
         std::regex startRegex(R"("|R"|`|R`)");
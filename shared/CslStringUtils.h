@@ -4,170 +4,118 @@
 #define CSL_STRING_UTILS_H
 
 #include <string>
+#include <string_view>
 #include <cstdint>
 #include <stdexcept>
 #include <regex>
 #include <limits>
+#include "EscapeScanning.h"
 
 #ifndef DEF_GLOBAL
 extern std::string extractStringLiteralContent(const std::string& stringLiteral);
 extern std::string extractQuotedIdentifierContent(const std::string& quotedIdentifier);
 #else
-std::string unicodeCodePointToUTF8(uint32_t codePoint) {
-    std::string utf8;
-    if (codePoint <= 0x7F) {
-        // 1-byte UTF-8
-        utf8 += static_cast<char>(codePoint);
-    }
-    else if (codePoint <= 0x7FF) {
-        // 2-byte UTF-8
-        utf8 += static_cast<char>(0xC0 | (codePoint >> 6));
-        utf8 += static_cast<char>(0x80 | (codePoint & 0x3F));
-    }
-    else if (codePoint <= 0xFFFF) {
-        // 3-byte UTF-8
-        utf8 += static_cast<char>(0xE0 | (codePoint >> 12));
-        utf8 += static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F));
-        utf8 += static_cast<char>(0x80 | (codePoint & 0x3F));
-    }
-    else if (codePoint <= 0x10FFFF) {
-        // 4-byte UTF-8
-        utf8 += static_cast<char>(0xF0 | (codePoint >> 18));
-        utf8 += static_cast<char>(0x80 | ((codePoint >> 12) & 0x3F));
-        utf8 += static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F));
-        utf8 += static_cast<char>(0x80 | (codePoint & 0x3F));
-    }
-    else {
-        // Invalid code point (replace with Unicode replacement character)
-        utf8 += "\xEF\xBF\xBD";
-    }
-    return utf8;
-}
-
-std::string processEscapeSequences(const std::string& input) {
-    std::string result;
-    for (size_t i = 0; i < input.size(); ++i) {
-        if (input[i] == '\\') {
-            if (i + 1 >= input.size()) {
-                result += '\\';
-                continue;
-            }
-            char next = input[i + 1];
-            switch (next) {
-            // Standard escape sequences
-            case 'a': result += '\a'; i++; break;
-            case 'b': result += '\b'; i++; break;
-            case 'f': result += '\f'; i++; break;
-            case 'n': result += '\n'; i++; break;
-            case 'r': result += '\r'; i++; break;
-            case 't': result += '\t'; i++; break;
-            case 'v': result += '\v'; i++; break;
-            case '\\': result += '\\'; i++; break;
-            case '\?': result += '\?'; i++; break;
-            case '\'': result += '\''; i++; break;
-            case '\"': result += '\"'; i++; break;
-            case '`': result += '`'; i++; break;
-
-            // Octal escape (up to 3 digits)
-            case '0': case '1': case '2': case '3': case '4':
-            case '5': case '6': case '7': {
-                int val = 0;
-                int digits = 0;
-                for (int j = 0; j < 3 && (i + 1 + j) < input.size(); ++j) {
-                    char c = input[i + 1 + j];
-                    if (c < '0' || c > '7') break;
-                    val = val * 8 + (c - '0');
-                    digits++;
-                }
-                result += static_cast<char>(val);
-                i += digits;
-                break;
+// Decode the escapes of a string or quoted identifier in one pass into
+// output sized for the escaped text, which decoding never exceeds. Runs
+// without escapes are copied as they are. Escapes that are not valid
+// decode to the character after the backslash.
+std::string processEscapeSequences(std::string_view input) {
+    std::string result(input.size(), '\0');
+    const char* in = input.data();
+    size_t size = input.size();
+    size_t i = 0;
+    char* out = result.data();
+    char* end = out;
+    auto readHexDigits = [in, size](size_t start, size_t count, uint32_t& value) {
+        value = 0;
+        for (size_t j = start; j < start + count; ++j) {
+            int digit = j < size ? hexDigitValue(in[j]) : -1;
+            if (digit < 0) {
+                return false;
             }
-
-            // Hexadecimal escape (variable length)
-            case 'x': {
-                size_t j = i + 2;
-                int val = 0;
-                int digits = 0;
-                while (j < input.size() && std::isxdigit(input[j])) {
-                    char c = input[j];
-                    val = val * 16 + (c >= '0' && c <= '9' ? c - '0' :
-                        (c >= 'a' && c <= 'f' ? 10 + c - 'a' :
-                            10 + c - 'A'));
-                    digits++;
-                    j++;
-                }
-                if (digits == 0) {
-                    result += 'x';
-                    i++;
-                }
-                else {
-                    result += static_cast<char>(val);
-                    i = j - 1;
-                }
-                break;
-            }
-
-            // Unicode escape sequences
-            case 'u': {
-                const int hexDigits = 4;
-                if (i + 1 + hexDigits >= input.size()) {
-                    result += 'u';
-                    i++;
-                    break;
-                }
-                std::string hexStr = input.substr(i + 2, hexDigits);
-                bool valid = (hexStr.size() == hexDigits);
-                for (char c : hexStr) {
-                    if (!std::isxdigit(c)) valid = false;
-                }
-                if (!valid) {
-                    result += 'u';
-                    i++;
-                }
-                else {
-                    uint32_t codePoint = std::stoul(hexStr, nullptr, 16);
-                    result += unicodeCodePointToUTF8(codePoint);
-                    i += 1 + hexDigits; // Skip \u and 4 digits
-                }
-                break;
+            value = value << 4 | static_cast<uint32_t>(digit);
+        }
+        return true;
+    };
+    while (true) {
+        size_t run = CopyUntilEscape(in + i, size - i, end, false);
+        i += run;
+        end += run;
+        if (i == size) {
+            break;
+        }
+        if (i + 1 >= size) {
+            *end++ = '\\';
+            ++i;
+            continue;
+        }
+        char next = in[i + 1];
+        size_t escapeLength = 2;
+        switch (next) {
+        // Standard escape sequences
+        case 'a': *end++ = '\a'; break;
+        case 'b': *end++ = '\b'; break;
+        case 'f': *end++ = '\f'; break;
+        case 'n': *end++ = '\n'; break;
+        case 'r': *end++ = '\r'; break;
+        case 't': *end++ = '\t'; break;
+        case 'v': *end++ = '\v'; break;
+        case '\\': *end++ = '\\'; break;
+        case '\?': *end++ = '\?'; break;
+        case '\'': *end++ = '\''; break;
+        case '\"': *end++ = '\"'; break;
+        case '`': *end++ = '`'; break;
+
+        // Octal escape (up to 3 digits)
+        case '0': case '1': case '2': case '3': case '4':
+        case '5': case '6': case '7': {
+            int val = 0;
+            size_t digits = 0;
+            while (digits < 3 && i + 1 + digits < size && in[i + 1 + digits] >= '0' && in[i + 1 + digits] <= '7') {
+                val = val * 8 + (in[i + 1 + digits] - '0');
+                ++digits;
             }
+            *end++ = static_cast<char>(val);
+            escapeLength = 1 + digits;
+            break;
+        }
 
-            case 'U': {
-                const int hexDigits = 8;
-                if (i + 1 + hexDigits >= input.size()) {
-                    result += 'U';
-                    i++;
-                    break;
-                }
-                std::string hexStr = input.substr(i + 2, hexDigits);
-                bool valid = (hexStr.size() == hexDigits);
-                for (char c : hexStr) {
-                    if (!std::isxdigit(c)) valid = false;
-                }
-                if (!valid) {
-                    result += 'U';
-                    i++;
-                }
-                else {
-                    uint32_t codePoint = std::stoul(hexStr, nullptr, 16);
-                    result += unicodeCodePointToUTF8(codePoint);
-                    i += 1 + hexDigits; // Skip \U and 8 digits
-                }
-                break;
+        // Hexadecimal escape (variable length)
+        case 'x': {
+            size_t j = i + 2;
+            uint32_t val = 0;
+            while (j < size && hexDigitValue(in[j]) >= 0) {
+                val = val * 16 + static_cast<uint32_t>(hexDigitValue(in[j]));
+                ++j;
             }
+            *end++ = j == i + 2 ? 'x' : static_cast<char>(val);
+            escapeLength = j == i + 2 ? 2 : j - i;
+            break;
+        }
 
-            // Invalid escape: remove backslash
-            default:
-                result += next;
-                i++;
+        // Unicode escape sequences; code points out of range become
+        // U+FFFD
+        case 'u':
+        case 'U': {
+            size_t hexDigits = next == 'u' ? 4 : 8;
+            uint32_t codePoint;
+            if (i + 1 + hexDigits >= size || !readHexDigits(i + 2, hexDigits, codePoint)) {
+                *end++ = next;
                 break;
             }
+            end += WriteUtf8(end, codePoint <= 0x10FFFF ? codePoint : 0xFFFD);
+            escapeLength = 2 + hexDigits;
+            break;
         }
-        else {
-            result += input[i];
+
+        // Invalid escape: remove backslash
+        default:
+            *end++ = next;
+            break;
         }
+        i += escapeLength;
     }
+    result.resize(end - out);
     return result;
 }
 
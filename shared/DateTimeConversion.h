@@ -0,0 +1,250 @@
+#pragma once
+
+#ifndef DATE_TIME_CONVERSION_H
+#define DATE_TIME_CONVERSION_H
+
+#include <string>
+#include <string_view>
+#include <cstdint>
+#include "Type.h"
+
+// A date-time literal decoded to a fixed layout. Offset date-times count
+// seconds since 1970-01-01T00:00:00Z and keep the offset they were written
+// with; local date-times and local dates count seconds since
+// 1970-01-01T00:00:00 of their own clock, and local times count seconds
+// since midnight. Seconds are kept apart from nanoseconds since a count of
+// nanoseconds in 64 bits does not reach the years 1 to 9999. Digits of
+// fractions past nanoseconds are dropped.
+struct DateTimeValue {
+    int64_t seconds;
+    uint32_t nanoseconds;
+    int16_t offsetMinutes;
+    // A Type::DateTime::DateTimeType
+    uint8_t kind;
+
+    Type::DateTime::DateTimeType getKind() const {
+        return static_cast<Type::DateTime::DateTimeType>(kind);
+    }
+
+    // Date-times are equal when they are of one kind and at one instant,
+    // whatever offsets they were written with.
+    bool operator==(const DateTimeValue& other) const {
+        return kind == other.kind && seconds == other.seconds && nanoseconds == other.nanoseconds;
+    }
+
+    bool operator!=(const DateTimeValue& other) const {
+        return !(*this == other);
+    }
+
+    // Orders date-times of one kind only.
+    bool operator<(const DateTimeValue& other) const {
+        return seconds < other.seconds || (seconds == other.seconds && nanoseconds < other.nanoseconds);
+    }
+};
+
+// DecodeDateTimeLiteral reads the longest date-time literal at pos in one
+// pass, checking the grammar, the ranges of the fields and the days of the
+// month as it goes. It returns the length of the literal, or 0 if there is
+// none at pos. FormatDateTime writes a decoded date-time as RFC 3339 text:
+// with a T between date and time, a Z for a zero offset and the fraction
+// without trailing zeros.
+#ifndef DEF_GLOBAL
+extern size_t DecodeDateTimeLiteral(std::string_view str, size_t pos, DateTimeValue& dateTime);
+extern std::string FormatDateTime(const DateTimeValue& dateTime);
+#else
+// The digit at str[index], or a number above 9 if it is not a digit
+static unsigned digitValueAt(std::string_view str, size_t index) {
+    return static_cast<unsigned>(static_cast<unsigned char>(str[index])) - '0';
+}
+
+// Days since 1970-01-01 of a date of the proleptic Gregorian calendar
+static int64_t daysFromCivil(int64_t year, unsigned month, unsigned day) {
+    year -= month <= 2;
+    int64_t era = (year >= 0 ? year : year - 399) / 400;
+    unsigned yearOfEra = static_cast<unsigned>(year - era * 400);
+    unsigned dayOfYear = (153 * (month > 2 ? month - 3 : month + 9) + 2) / 5 + day - 1;
+    unsigned dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear;
+    return era * 146097 + static_cast<int64_t>(dayOfEra) - 719468;
+}
+
+static void civilFromDays(int64_t days, int64_t& year, unsigned& month, unsigned& day) {
+    days += 719468;
+    int64_t era = (days >= 0 ? days : days - 146096) / 146097;
+    unsigned dayOfEra = static_cast<unsigned>(days - era * 146097);
+    unsigned yearOfEra = (dayOfEra - dayOfEra / 1460 + dayOfEra / 36524 - dayOfEra / 146096) / 365;
+    unsigned dayOfYear = dayOfEra - (365 * yearOfEra + yearOfEra / 4 - yearOfEra / 100);
+    unsigned monthIndex = (5 * dayOfYear + 2) / 153;
+    day = dayOfYear - (153 * monthIndex + 2) / 5 + 1;
+    month = monthIndex < 10 ? monthIndex + 3 : monthIndex - 9;
+    year = static_cast<int64_t>(yearOfEra) + era * 400 + (month <= 2);
+}
+
+// \d{4}-\d{2}-\d{2}, a valid date from year 1 on
+static bool decodeDate(std::string_view str, size_t pos, int64_t& days) {
+    if (pos + 10 > str.size()) {
+        return false;
+    }
+    unsigned y0 = digitValueAt(str, pos), y1 = digitValueAt(str, pos + 1), y2 = digitValueAt(str, pos + 2), y3 = digitValueAt(str, pos + 3);
+    unsigned m0 = digitValueAt(str, pos + 5), m1 = digitValueAt(str, pos + 6);
+    unsigned d0 = digitValueAt(str, pos + 8), d1 = digitValueAt(str, pos + 9);
+    bool isShape = (y0 <= 9) & (y1 <= 9) & (y2 <= 9) & (y3 <= 9) & (m0 <= 9) & (m1 <= 9) & (d0 <= 9) & (d1 <= 9) & (str[pos + 4] == '-') & (str[pos + 7] == '-');
+    if (!isShape) {
+        return false;
+    }
+    unsigned year = y0 * 1000 + y1 * 100 + y2 * 10 + y3;
+    unsigned month = m0 * 10 + m1;
+    unsigned day = d0 * 10 + d1;
+    if (year < 1 || month < 1 || month > 12) {
+        return false;
+    }
+    static constexpr unsigned char daysInMonth[] = { 31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31 };
+    bool isLeapYear = (year % 4 == 0 && year % 100 != 0) || year % 400 == 0;
+    unsigned monthDays = daysInMonth[month - 1] + (month == 2 && isLeapYear ? 1u : 0u);
+    if (day < 1 || day > monthDays) {
+        return false;
+    }
+    days = daysFromCivil(year, month, day);
+    return true;
+}
+
+// ([01]\d|2[0-3]):[0-5]\d:[0-5]\d(\.\d+)?
+static size_t decodeTime(std::string_view str, size_t pos, int64_t& seconds, uint32_t& nanoseconds) {
+    if (pos + 8 > str.size()) {
+        return 0;
+    }
+    unsigned h0 = digitValueAt(str, pos), h1 = digitValueAt(str, pos + 1);
+    unsigned m0 = digitValueAt(str, pos + 3), m1 = digitValueAt(str, pos + 4);
+    unsigned s0 = digitValueAt(str, pos + 6), s1 = digitValueAt(str, pos + 7);
+    bool isShape = (h0 <= 9) & (h1 <= 9) & (m0 <= 5) & (m1 <= 9) & (s0 <= 5) & (s1 <= 9) & (str[pos + 2] == ':') & (str[pos + 5] == ':');
+    unsigned hour = h0 * 10 + h1;
+    if (!isShape || hour > 23) {
+        return 0;
+    }
+    seconds = hour * 3600 + (m0 * 10 + m1) * 60 + s0 * 10 + s1;
+    nanoseconds = 0;
+    size_t end = pos + 8;
+    if (end + 1 < str.size() && str[end] == '.' && digitValueAt(str, end + 1) <= 9) {
+        uint32_t scale = 100000000;
+        unsigned digit;
+        for (++end; end < str.size() && (digit = digitValueAt(str, end)) <= 9; ++end) {
+            nanoseconds += digit * scale;
+            scale /= 10;
+        }
+    }
+    return end - pos;
+}
+
+// [Zz]|[+-]([01]\d|2[0-3]):[0-5]\d
+static size_t decodeTimeOffset(std::string_view str, size_t pos, int16_t& offsetMinutes) {
+    if (pos >= str.size()) {
+        return 0;
+    }
+    char sign = str[pos];
+    if (sign == 'Z' || sign == 'z') {
+        offsetMinutes = 0;
+        return 1;
+    }
+    if ((sign != '+' && sign != '-') || pos + 6 > str.size()) {
+        return 0;
+    }
+    unsigned h0 = digitValueAt(str, pos + 1), h1 = digitValueAt(str, pos + 2);
+    unsigned m0 = digitValueAt(str, pos + 4), m1 = digitValueAt(str, pos + 5);
+    bool isShape = (h0 <= 9) & (h1 <= 9) & (m0 <= 5) & (m1 <= 9) & (str[pos + 3] == ':');
+    unsigned hour = h0 * 10 + h1;
+    if (!isShape || hour > 23) {
+        return 0;
+    }
+    int minutes = static_cast<int>(hour * 60 + m0 * 10 + m1);
+    offsetMinutes = static_cast<int16_t>(sign == '-' ? -minutes : minutes);
+    return 6;
+}
+
+size_t DecodeDateTimeLiteral(std::string_view str, size_t pos, DateTimeValue& dateTime) {
+    int64_t days;
+    int64_t timeSeconds;
+    dateTime.offsetMinutes = 0;
+    if (decodeDate(str, pos, days)) {
+        char separator = pos + 10 < str.size() ? str[pos + 10] : '\0';
+        size_t timeLength = separator == 'T' || separator == 't' || separator == ' ' ? decodeTime(str, pos + 11, timeSeconds, dateTime.nanoseconds) : 0;
+        if (!timeLength) {
+            dateTime.seconds = days * 86400;
+            dateTime.nanoseconds = 0;
+            dateTime.kind = Type::DateTime::LocalDate;
+            return 10;
+        }
+        dateTime.seconds = days * 86400 + timeSeconds;
+        size_t offsetLength = decodeTimeOffset(str, pos + 11 + timeLength, dateTime.offsetMinutes);
+        if (!offsetLength) {
+            dateTime.kind = Type::DateTime::LocalDateTime;
+            return 11 + timeLength;
+        }
+        dateTime.seconds -= dateTime.offsetMinutes * 60;
+        dateTime.kind = Type::DateTime::OffsetDateTime;
+        return 11 + timeLength + offsetLength;
+    }
+    size_t timeLength = decodeTime(str, pos, timeSeconds, dateTime.nanoseconds);
+    if (!timeLength) {
+        return 0;
+    }
+    dateTime.seconds = timeSeconds;
+    dateTime.kind = Type::DateTime::LocalTime;
+    return timeLength;
+}
+
+std::string FormatDateTime(const DateTimeValue& dateTime) {
+    char buffer[40];
+    char* out = buffer;
+    auto putTwoDigits = [&out](unsigned number) {
+        *out++ = static_cast<char>('0' + number / 10);
+        *out++ = static_cast<char>('0' + number % 10);
+    };
+    // Offset date-times are written on the clock of their offset
+    int64_t localSeconds = dateTime.seconds + dateTime.offsetMinutes * 60;
+    int64_t days = (localSeconds >= 0 ? localSeconds : localSeconds - 86399) / 86400;
+    unsigned secondOfDay = static_cast<unsigned>(localSeconds - days * 86400);
+    auto kind = dateTime.getKind();
+    if (kind != Type::DateTime::LocalTime) {
+        int64_t year;
+        unsigned month, day;
+        civilFromDays(days, year, month, day);
+        putTwoDigits(static_cast<unsigned>(year / 100));
+        putTwoDigits(static_cast<unsigned>(year % 100));
+        *out++ = '-';
+        putTwoDigits(month);
+        *out++ = '-';
+        putTwoDigits(day);
+        if (kind == Type::DateTime::LocalDate) {
+            return std::string(buffer, out);
+        }
+        *out++ = 'T';
+    }
+    putTwoDigits(secondOfDay / 3600);
+    *out++ = ':';
+    putTwoDigits(secondOfDay / 60 % 60);
+    *out++ = ':';
+    putTwoDigits(secondOfDay % 60);
+    if (dateTime.nanoseconds) {
+        *out++ = '.';
+        uint32_t fraction = dateTime.nanoseconds;
+        for (uint32_t scale = 100000000; fraction; scale /= 10) {
+            *out++ = static_cast<char>('0' + fraction / scale);
+            fraction %= scale;
+        }
+    }
+    if (kind == Type::DateTime::OffsetDateTime) {
+        if (!dateTime.offsetMinutes) {
+            *out++ = 'Z';
+        }
+        else {
+            unsigned offset = dateTime.offsetMinutes < 0 ? -dateTime.offsetMinutes : dateTime.offsetMinutes;
+            *out++ = dateTime.offsetMinutes < 0 ? '-' : '+';
+            putTwoDigits(offset / 60);
+            *out++ = ':';
+            putTwoDigits(offset % 60);
+        }
+    }
+    return std::string(buffer, out);
+}
+#endif
+
+#endif
@@ -0,0 +1,622 @@
+#pragma once
+
+#ifndef DOC_SNAPSHOT_H
+#define DOC_SNAPSHOT_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
+#include <optional>
+#include <stdexcept>
+#include <cstdint>
+#include <cstring>
+#include <ostream>
+#include <json.hpp>
+#include "DocumentTree.h"
+#include "DateTimeConversion.h"
+#include "TomlStringUtils.h"
+#include "FilePosition.h"
+#include "MappedFile.hpp"
+
+// Compiled snapshots of a document tree, which are mapped into memory and
+// queried in place instead of lexing and parsing the source again.
+//
+// A snapshot is one block of 8-byte aligned records that refer to each
+// other by offsets from its start, so it can be mapped at any address.
+// It starts with a Header, whose root slot is the root table. Every
+// value is a ValueSlot:
+// - strings refer to their bytes;
+// - integers, floats, booleans and date-times hold their decoded
+//   payload;
+// - literals that do not decode hold their source text as Literal;
+// - arrays refer to a record of one slot per element;
+// - tables refer to a record of one MemberSlot per key, sorted by the
+//   bytes of the key for binary search, followed by the sorted positions
+//   of the keys in source order.
+// With source regions, each array and table record is followed by one
+// Region per element or member, in the order of its slots; values that
+// have no region, such as the elements of packed arrays, have NoRegion,
+// with every field UINT32_MAX. Fields are
+// written in the byte order of the host, which the header records.
+//
+// The header also keeps the size and a hash of the source it was
+// compiled from, so a snapshot that is stale for a source can be told.
+namespace DocSnapshot {
+    inline constexpr char Magic[8] = { 'T', 'O', 'M', 'L', 'S', 'N', 'A', 'P' };
+    inline constexpr uint32_t Version = 1;
+    inline constexpr uint32_t ByteOrderMark = 0x01020304;
+    inline constexpr uint32_t HasRegions = 1;
+
+    enum class ValueKind : uint8_t {
+        Null,
+        String,
+        Integer,
+        Float,
+        Boolean,
+        DateTime,
+        Array,
+        Table,
+        Literal
+    };
+
+    // Integers and floats hold their value in payload, and booleans 0 or
+    // 1. Date-times hold seconds in payload, nanoseconds in size and
+    // their Type::DateTime::DateTimeType in subtype. Strings and literals
+    // hold the offset of their bytes in payload and their length in size,
+    // and literals their Type::Type::Kind in subtype. Arrays and tables
+    // hold the offset of their record in payload and their number of
+    // elements or members in size, and tables 1 in subtype if they were
+    // defined by a header.
+    struct ValueSlot {
+        ValueKind kind;
+        uint8_t subtype;
+        int16_t offsetMinutes;
+        uint32_t size;
+        uint64_t payload;
+    };
+
+    struct MemberSlot {
+        uint64_t keyOffset;
+        uint32_t keySize;
+        uint32_t reserved;
+        ValueSlot value;
+    };
+
+    struct Region {
+        uint32_t startLine;
+        uint32_t startColumn;
+        uint32_t endLine;
+        uint32_t endColumn;
+    };
+
+    inline constexpr Region NoRegion = { UINT32_MAX, UINT32_MAX, UINT32_MAX, UINT32_MAX };
+
+    struct Header {
+        char magic[8];
+        uint32_t version;
+        uint32_t byteOrderMark;
+        uint32_t flags;
+        uint32_t reserved;
+        uint64_t sourceHash;
+        uint64_t sourceSize;
+        uint64_t snapshotSize;
+        ValueSlot root;
+    };
+
+    static_assert(sizeof(ValueSlot) == 16 && sizeof(MemberSlot) == 32 && sizeof(Region) == 16 && sizeof(Header) == 64);
+
+    inline constexpr size_t alignRecord(size_t size) {
+        return (size + 7) & ~size_t(7);
+    }
+
+    // A value in a mapped snapshot. Accessors of another kind of value
+    // return nothing; offsets are checked against the snapshot, which
+    // throws std::runtime_error when one is out of it.
+    class Node {
+    public:
+        Node(std::string_view snapshot, const ValueSlot* slot, const Region* region, bool hasRegions)
+            : snapshot(snapshot), slot(slot), region(region), hasRegions(hasRegions) {}
+
+        ValueKind getKind() const {
+            return slot->kind;
+        }
+
+        std::optional<std::string_view> getString() const {
+            return slot->kind == ValueKind::String ? std::optional<std::string_view>(bytes(slot->payload, slot->size)) : std::nullopt;
+        }
+
+        std::optional<int64_t> getInteger() const {
+            return slot->kind == ValueKind::Integer ? std::optional<int64_t>(static_cast<int64_t>(slot->payload)) : std::nullopt;
+        }
+
+        std::optional<double> getFloat() const {
+            double number;
+            std::memcpy(&number, &slot->payload, sizeof(number));
+            return slot->kind == ValueKind::Float ? std::optional<double>(number) : std::nullopt;
+        }
+
+        std::optional<bool> getBoolean() const {
+            return slot->kind == ValueKind::Boolean ? std::optional<bool>(slot->payload != 0) : std::nullopt;
+        }
+
+        std::optional<DateTimeValue> getDateTime() const {
+            if (slot->kind != ValueKind::DateTime) {
+                return std::nullopt;
+            }
+            return DateTimeValue{ static_cast<int64_t>(slot->payload), slot->size, slot->offsetMinutes, slot->subtype };
+        }
+
+        // The source text of a literal that did not decode, with the
+        // Type::Type::Kind it was parsed as
+        std::optional<std::string_view> getLiteral() const {
+            return slot->kind == ValueKind::Literal ? std::optional<std::string_view>(bytes(slot->payload, slot->size)) : std::nullopt;
+        }
+
+        Type::Type::Kind getLiteralKind() const {
+            return static_cast<Type::Type::Kind>(slot->subtype);
+        }
+
+        bool getIsExplicitlyDefined() const {
+            return slot->kind == ValueKind::Table && slot->subtype;
+        }
+
+        // The number of elements of an array or members of a table
+        size_t size() const {
+            return slot->kind == ValueKind::Array || slot->kind == ValueKind::Table ? slot->size : 0;
+        }
+
+        // An element of an array
+        Node operator[](size_t index) const {
+            if (slot->kind != ValueKind::Array || index >= slot->size) {
+                throw std::out_of_range("snapshot array index out of range");
+            }
+            auto slots = records<ValueSlot>(slot->payload, slot->size);
+            return Node(snapshot, slots + index, regionAt(slot->payload + sizeof(ValueSlot) * slot->size, index), hasRegions);
+        }
+
+        // A member of a table by key, found by binary search
+        std::optional<Node> find(std::string_view key) const {
+            if (slot->kind != ValueKind::Table) {
+                return std::nullopt;
+            }
+            auto members = records<MemberSlot>(slot->payload, slot->size);
+            auto member = std::lower_bound(members, members + slot->size, key, [this](const MemberSlot& member, std::string_view key) {
+                return bytes(member.keyOffset, member.keySize) < key;
+            });
+            if (member == members + slot->size || bytes(member->keyOffset, member->keySize) != key) {
+                return std::nullopt;
+            }
+            return memberAt(static_cast<size_t>(member - members));
+        }
+
+        // The key and value of the member of a table at a position in
+        // source order
+        std::pair<std::string_view, Node> getMember(size_t index) const {
+            if (slot->kind != ValueKind::Table || index >= slot->size) {
+                throw std::out_of_range("snapshot table index out of range");
+            }
+            auto sourceOrder = records<uint32_t>(slot->payload + sizeof(MemberSlot) * slot->size, slot->size);
+            size_t sortedIndex = sourceOrder[index];
+            if (sortedIndex >= slot->size) {
+                throw std::runtime_error("corrupt snapshot");
+            }
+            const MemberSlot& member = records<MemberSlot>(slot->payload, slot->size)[sortedIndex];
+            return { bytes(member.keyOffset, member.keySize), memberAt(sortedIndex) };
+        }
+
+        // The source region of the value, if the snapshot keeps them.
+        // Elements of packed arrays have none.
+        std::optional<FilePosition::Region> getRegion() const {
+            if (!region || std::memcmp(region, &NoRegion, sizeof(Region)) == 0) {
+                return std::nullopt;
+            }
+            return FilePosition::Region{
+                { IntLike(static_cast<long long>(region->startLine)), IntLike(static_cast<long long>(region->startColumn)) },
+                { IntLike(static_cast<long long>(region->endLine)), IntLike(static_cast<long long>(region->endColumn)) }
+            };
+        }
+
+    protected:
+        std::string_view bytes(uint64_t offset, uint64_t size) const {
+            if (offset > snapshot.size() || size > snapshot.size() - offset) {
+                throw std::runtime_error("corrupt snapshot");
+            }
+            return snapshot.substr(static_cast<size_t>(offset), static_cast<size_t>(size));
+        }
+
+        template <typename Record>
+        const Record* records(uint64_t offset, uint64_t count) const {
+            if (offset % alignof(Record) || count > snapshot.size() / sizeof(Record)) {
+                throw std::runtime_error("corrupt snapshot");
+            }
+            return reinterpret_cast<const Record*>(bytes(offset, count * sizeof(Record)).data());
+        }
+
+        // Regions follow the slots of a record, and in tables the source
+        // order as well
+        const Region* regionAt(uint64_t regionsOffset, size_t index) const {
+            return hasRegions ? records<Region>(regionsOffset, slot->size) + index : nullptr;
+        }
+
+        Node memberAt(size_t sortedIndex) const {
+            auto members = records<MemberSlot>(slot->payload, slot->size);
+            uint64_t regionsOffset = slot->payload + sizeof(MemberSlot) * slot->size + alignRecord(sizeof(uint32_t) * slot->size);
+            return Node(snapshot, &members[sortedIndex].value, regionAt(regionsOffset, sortedIndex), hasRegions);
+        }
+
+        std::string_view snapshot;
+        const ValueSlot* slot;
+        const Region* region;
+        bool hasRegions;
+    };
+
+    // A snapshot mapped from a file. Files that are not snapshots of this
+    // version and byte order throw std::runtime_error.
+    class Snapshot {
+    public:
+        explicit Snapshot(const std::string& path) : file(path) {
+            auto data = file.view();
+            if (data.size() < sizeof(Header)) {
+                throw std::runtime_error(path + " is not a compiled snapshot");
+            }
+            header = reinterpret_cast<const Header*>(data.data());
+            if (std::memcmp(header->magic, Magic, sizeof(Magic)) || header->byteOrderMark != ByteOrderMark) {
+                throw std::runtime_error(path + " is not a compiled snapshot");
+            }
+            if (header->version != Version) {
+                throw std::runtime_error(path + " is a compiled snapshot of another version");
+            }
+            if (header->snapshotSize != data.size()) {
+                throw std::runtime_error(path + " is a truncated compiled snapshot");
+            }
+        }
+
+        Node getRoot() const {
+            return Node(file.view(), &header->root, nullptr, header->flags & HasRegions);
+        }
+
+        bool getHasRegions() const {
+            return header->flags & HasRegions;
+        }
+
+        uint64_t getSourceHash() const {
+            return header->sourceHash;
+        }
+
+        // Whether the snapshot was compiled from this source
+        bool isCurrentFor(std::string_view source) const;
+
+    protected:
+        MappedFile file;
+        const Header* header;
+    };
+
+#ifndef DEF_GLOBAL
+    // A 64-bit hash of a source, to tell stale snapshots. It is not meant
+    // to resist collisions made on purpose.
+    extern uint64_t hashSource(std::string_view source);
+    // Compile the tree of source to a snapshot, with the source regions of
+    // values if withRegions.
+    extern void writeSnapshot(const DocTree::Table* root, std::string_view source, bool withRegions, std::ostream& output);
+    // The JSON of a value in a snapshot, as toml --parse writes it:
+    // integers as decimal strings, date-times as RFC 3339 text and other
+    // literals that did not decode as their source text.
+    extern nlohmann::json toJson(const Node& node);
+    // Split a path of keys written as a TOML dotted key, with bare, basic
+    // and literal keys, into its keys. Malformed paths throw
+    // std::invalid_argument.
+    extern std::vector<std::string> parseKeyPath(std::string_view path);
+#else
+    uint64_t hashSource(std::string_view source) {
+        constexpr uint64_t multiplier = 0x9E3779B97F4A7C15ULL;
+        auto mix = [](uint64_t hash) {
+            hash ^= hash >> 33;
+            hash *= 0xFF51AFD7ED558CCDULL;
+            hash ^= hash >> 33;
+            hash *= 0xC4CEB9FE1A85EC53ULL;
+            return hash ^ (hash >> 33);
+        };
+        // Four independent lanes of eight bytes keep the multiplies in
+        // flight
+        uint64_t lanes[4] = { source.size(), multiplier, ~source.size(), ~multiplier };
+        size_t pos = 0;
+        for (; pos + 32 <= source.size(); pos += 32) {
+            for (size_t lane = 0; lane < 4; ++lane) {
+                uint64_t word;
+                std::memcpy(&word, source.data() + pos + lane * 8, sizeof(word));
+                lanes[lane] = (lanes[lane] ^ word) * multiplier;
+                lanes[lane] ^= lanes[lane] >> 29;
+            }
+        }
+        uint64_t hash = mix(lanes[0]) ^ mix(lanes[1] + 1) ^ mix(lanes[2] + 2) ^ mix(lanes[3] + 3);
+        for (; pos < source.size(); ++pos) {
+            hash = (hash ^ static_cast<unsigned char>(source[pos])) * multiplier;
+        }
+        return mix(hash);
+    }
+
+    class SnapshotBuilder {
+    public:
+        SnapshotBuilder(bool withRegions) : withRegions(withRegions) {
+            snapshot.resize(sizeof(Header));
+        }
+
+        std::string build(const DocTree::Table* root, std::string_view source) {
+            Header header{};
+            std::memcpy(header.magic, Magic, sizeof(Magic));
+            header.version = Version;
+            header.byteOrderMark = ByteOrderMark;
+            header.flags = withRegions ? HasRegions : 0;
+            header.sourceHash = hashSource(source);
+            header.sourceSize = source.size();
+            header.root = addNode(root);
+            header.snapshotSize = snapshot.size();
+            put(0, header);
+            return std::move(snapshot);
+        }
+
+    protected:
+        size_t allocate(size_t size) {
+            size_t offset = snapshot.size();
+            snapshot.resize(offset + alignRecord(size));
+            return offset;
+        }
+
+        template <typename Record>
+        void put(size_t offset, const Record& record) {
+            std::memcpy(snapshot.data() + offset, &record, sizeof(Record));
+        }
+
+        ValueSlot addBytes(ValueKind kind, std::string_view bytes) {
+            if (bytes.size() > UINT32_MAX) {
+                throw std::runtime_error("strings of 4 GiB or more do not fit in a snapshot");
+            }
+            size_t offset = allocate(bytes.size());
+            std::memcpy(snapshot.data() + offset, bytes.data(), bytes.size());
+            return ValueSlot{ kind, 0, 0, static_cast<uint32_t>(bytes.size()), offset };
+        }
+
+        // Keys are written once for all tables that have them
+        ValueSlot addKey(std::string_view key) {
+            auto [keyBytes, isNew] = keyBytesByKey.try_emplace(key);
+            if (isNew) {
+                keyBytes->second = addBytes(ValueKind::String, key);
+            }
+            return keyBytes->second;
+        }
+
+        static Region toRegion(const FilePosition::Region& region) {
+            return Region{
+                static_cast<uint32_t>(region.start.line.getValue()), static_cast<uint32_t>(region.start.column.getValue()),
+                static_cast<uint32_t>(region.end.line.getValue()), static_cast<uint32_t>(region.end.column.getValue())
+            };
+        }
+
+        static Region regionOf(const DocTree::DocTreeNode* node) {
+            if (!node) {
+                return NoRegion;
+            }
+            return visit(DocTree::Overloaded{
+                [](const DocTree::Value* value) { return toRegion(value->getDefPos()); },
+                [](const DocTree::Array* array) { return toRegion(array->getDefPos()); },
+                [](const DocTree::Table* table) { return toRegion(table->getDefPos()); },
+                [](const DocTree::Key*) { return NoRegion; }
+            }, node);
+        }
+
+        template <typename ValueType>
+        ValueSlot addValue(const ValueType& value) {
+            auto type = value.getType();
+            auto kind = type ? type->getKind() : Type::Type::Kind::Invalid;
+            switch (kind) {
+            case Type::Type::Kind::String:
+                return addBytes(ValueKind::String, value.getString());
+            case Type::Type::Kind::Integer:
+                if (auto integer = value.getInteger()) {
+                    return ValueSlot{ ValueKind::Integer, 0, 0, 0, static_cast<uint64_t>(*integer) };
+                }
+                break;
+            case Type::Type::Kind::Float:
+            case Type::Type::Kind::SpecialNumber:
+                if (auto number = value.getFloat()) {
+                    ValueSlot slot{ ValueKind::Float, 0, 0, 0, 0 };
+                    std::memcpy(&slot.payload, &*number, sizeof(double));
+                    return slot;
+                }
+                break;
+            case Type::Type::Kind::Boolean:
+                return ValueSlot{ ValueKind::Boolean, 0, 0, 0, value.getBoolean().value_or(false) };
+            case Type::Type::Kind::DateTime:
+                if (auto dateTime = value.getDateTime()) {
+                    return ValueSlot{ ValueKind::DateTime, dateTime->kind, dateTime->offsetMinutes, dateTime->nanoseconds, static_cast<uint64_t>(dateTime->seconds) };
+                }
+                break;
+            default:
+                break;
+            }
+            ValueSlot slot = addBytes(ValueKind::Literal, value.getValue());
+            slot.subtype = static_cast<uint8_t>(kind);
+            return slot;
+        }
+
+        ValueSlot addNode(const DocTree::DocTreeNode* node) {
+            if (!node) {
+                return ValueSlot{ ValueKind::Null, 0, 0, 0, 0 };
+            }
+            return visit(DocTree::Overloaded{
+                [&](const DocTree::Value* value) {
+                    return addValue(*value);
+                },
+                [&](const DocTree::Array* array) {
+                    return addArray(array);
+                },
+                [&](const DocTree::Table* table) {
+                    return addTable(table);
+                },
+                [&](const DocTree::Key* key) {
+                    return addNode(key->getValue());
+                }
+            }, node);
+        }
+
+        ValueSlot addArray(const DocTree::Array* array) {
+            size_t size = array->size();
+            if (size > UINT32_MAX) {
+                throw std::runtime_error("arrays of 2^32 elements or more do not fit in a snapshot");
+            }
+            size_t slotsOffset = allocate(sizeof(ValueSlot) * size);
+            size_t regionsOffset = withRegions ? allocate(sizeof(Region) * size) : 0;
+            for (size_t index = 0; index < size; ++index) {
+                // Elements are added before their slot is put, as adding
+                // them moves the snapshot
+                const DocTree::DocTreeNode* elem = array->getIsPacked() ? nullptr : array->getElems()[index];
+                ValueSlot slot = array->getIsPacked() ? addValue(array->getPackedValue(index)) : addNode(elem);
+                put(slotsOffset + sizeof(ValueSlot) * index, slot);
+                if (withRegions) {
+                    put(regionsOffset + sizeof(Region) * index, regionOf(elem));
+                }
+            }
+            return ValueSlot{ ValueKind::Array, 0, 0, static_cast<uint32_t>(size), slotsOffset };
+        }
+
+        ValueSlot addTable(const DocTree::Table* table) {
+            std::vector<const DocTree::Key*> keys;
+            keys.reserve(table->getElems().size());
+            for (const auto& [id, key] : table->getElems()) {
+                if (key) keys.push_back(key);
+            }
+            size_t size = keys.size();
+            std::vector<uint32_t> sourceOrder(size);
+            std::vector<uint32_t> sortedOrder(size);
+            for (size_t index = 0; index < size; ++index) {
+                sortedOrder[index] = static_cast<uint32_t>(index);
+            }
+            std::sort(sortedOrder.begin(), sortedOrder.end(), [&keys](uint32_t left, uint32_t right) {
+                return keys[left]->getId() < keys[right]->getId();
+            });
+            for (size_t sortedIndex = 0; sortedIndex < size; ++sortedIndex) {
+                sourceOrder[sortedOrder[sortedIndex]] = static_cast<uint32_t>(sortedIndex);
+            }
+
+            size_t membersOffset = allocate(sizeof(MemberSlot) * size);
+            size_t sourceOrderOffset = allocate(sizeof(uint32_t) * size);
+            size_t regionsOffset = withRegions ? allocate(sizeof(Region) * size) : 0;
+            if (size) {
+                std::memcpy(snapshot.data() + sourceOrderOffset, sourceOrder.data(), sizeof(uint32_t) * size);
+            }
+            for (size_t sortedIndex = 0; sortedIndex < size; ++sortedIndex) {
+                const DocTree::Key* key = keys[sortedOrder[sortedIndex]];
+                ValueSlot keyBytes = addKey(key->getId());
+                MemberSlot member{ keyBytes.payload, keyBytes.size, 0, addNode(key->getValue()) };
+                put(membersOffset + sizeof(MemberSlot) * sortedIndex, member);
+                if (withRegions) {
+                    put(regionsOffset + sizeof(Region) * sortedIndex, regionOf(key->getValue()));
+                }
+            }
+            return ValueSlot{ ValueKind::Table, static_cast<uint8_t>(table->getIsExplicitlyDefined()), 0, static_cast<uint32_t>(size), membersOffset };
+        }
+
+        std::string snapshot;
+        std::unordered_map<std::string_view, ValueSlot> keyBytesByKey;
+        bool withRegions;
+    };
+
+    void writeSnapshot(const DocTree::Table* root, std::string_view source, bool withRegions, std::ostream& output) {
+        std::string snapshot = SnapshotBuilder(withRegions).build(root, source);
+        output.write(snapshot.data(), snapshot.size());
+    }
+
+    std::vector<std::string> parseKeyPath(std::string_view path) {
+        auto isBareKeyChar = [](char c) {
+            return (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z') || (c >= '0' && c <= '9') || c == '_' || c == '-';
+        };
+        auto skipWhitespace = [&path](size_t pos) {
+            while (pos < path.size() && (path[pos] == ' ' || path[pos] == '\t')) ++pos;
+            return pos;
+        };
+        std::vector<std::string> keys;
+        for (size_t pos = skipWhitespace(0);; pos = skipWhitespace(pos + 1)) {
+            size_t end = pos;
+            if (pos < path.size() && (path[pos] == '"' || path[pos] == '\'')) {
+                char quote = path[pos];
+                for (++end; end < path.size() && path[end] != quote; ++end) {
+                    if (quote == '"' && path[end] == '\\') ++end;
+                }
+                if (end >= path.size()) {
+                    throw std::invalid_argument("unterminated quoted key in " + std::string(path));
+                }
+                std::string_view literal = path.substr(pos, ++end - pos);
+                std::string key(literal.size(), '\0');
+                key.resize(DecodeStringLiteral(literal, quote == '"' ? Type::String::Basic : Type::String::Raw, key.data()));
+                keys.push_back(std::move(key));
+            }
+            else {
+                while (end < path.size() && isBareKeyChar(path[end])) ++end;
+                if (end == pos) {
+                    throw std::invalid_argument("expected a key at column " + std::to_string(pos + 1) + " of " + std::string(path));
+                }
+                keys.emplace_back(path.substr(pos, end - pos));
+            }
+            pos = skipWhitespace(end);
+            if (pos == path.size()) {
+                return keys;
+            }
+            if (path[pos] != '.') {
+                throw std::invalid_argument("expected . at column " + std::to_string(pos + 1) + " of " + std::string(path));
+            }
+        }
+    }
+
+    nlohmann::json toJson(const Node& node) {
+        switch (node.getKind()) {
+        case ValueKind::String:
+            return std::string(*node.getString());
+        case ValueKind::Integer:
+            return std::to_string(*node.getInteger());
+        case ValueKind::Float:
+            return *node.getFloat();
+        case ValueKind::Boolean:
+            return *node.getBoolean();
+        case ValueKind::DateTime:
+            return FormatDateTime(*node.getDateTime());
+        case ValueKind::Literal: {
+            std::string literal(*node.getLiteral());
+            if (node.getLiteralKind() != Type::Type::Kind::Integer) {
+                return literal;
+            }
+            // Integers out of the range of int64_t
+            literal.erase(std::remove(literal.begin(), literal.end(), '_'), literal.end());
+            if (!literal.empty() && literal[0] == '+') {
+                literal.erase(literal.begin());
+            }
+            return convertToDecimalString(literal);
+        }
+        case ValueKind::Array: {
+            nlohmann::json array = nlohmann::json::array();
+            for (size_t index = 0; index < node.size(); ++index) {
+                array.push_back(toJson(node[index]));
+            }
+            return array;
+        }
+        case ValueKind::Table: {
+            nlohmann::json object = nlohmann::json::object();
+            for (size_t index = 0; index < node.size(); ++index) {
+                auto [key, member] = node.getMember(index);
+                object[std::string(key)] = toJson(member);
+            }
+            return object;
+        }
+        default:
+            return nullptr;
+        }
+    }
+#endif
+
+    inline bool Snapshot::isCurrentFor(std::string_view source) const {
+        return header->sourceSize == source.size() && header->sourceHash == hashSource(source);
+    }
+} // namespace DocSnapshot
+
+#endif
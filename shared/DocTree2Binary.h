@@ -0,0 +1,444 @@
+#pragma once
+
+#ifndef DOC_TREE_2_BINARY_H
+#define DOC_TREE_2_BINARY_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <cstring>
+#include <ostream>
+#include "DocumentTree.h"
+#include "DateTimeConversion.h"
+#include "NumericConversion.h"
+#include "TomlStringUtils.h"
+
+// Binary encodings of a document tree, written as the tree is walked
+// through a buffer of a fixed size, like DocTree::writeJson. They hold
+// the plain values that writeJson writes, with tables as maps in the
+// order of their keys, except that integers are exact 64-bit integers,
+// floats, infinities and NaNs are doubles, and date-times are typed.
+// Integers out of the 64-bit range of the encoding are written as
+// decimal text, as writeJson writes them, and other literals that do not
+// decode as they are written in the source.
+//
+// CBOR (RFC 8949) writes offset date-times as RFC 3339 text with tag 0
+// and local dates as RFC 3339 full-date text with tag 1004 (RFC 8943).
+// Local date-times and local times, which have no tag, are RFC 3339
+// text.
+//
+// MessagePack writes offset date-times as timestamps (extension type
+// -1) of their instant. Local date-times, local dates and local times
+// use the layout of timestamps with extension types 1, 2 and 3, counting
+// seconds as DateTimeValue does for them.
+namespace DocTree {
+
+#ifndef DEF_GLOBAL
+    extern void writeCbor(const DocTreeNode* node, std::ostream& output);
+    extern void writeMsgPack(const DocTreeNode* node, std::ostream& output);
+#else
+    // Extension types of local date-times, local dates and local times
+    static constexpr int8_t MsgPackLocalDateTimeType = 1;
+    static constexpr int8_t MsgPackLocalDateType = 2;
+    static constexpr int8_t MsgPackLocalTimeType = 3;
+
+    // The walk over the tree, shared by the encodings, which provide the
+    // writers of headers and scalars.
+    template <typename Encoder>
+    class BinaryWriter {
+    public:
+        explicit BinaryWriter(std::ostream& output) : output(output) {
+            buffer.reserve(BufferSize + BufferSize / 4);
+        }
+
+        void write(const DocTreeNode* node) {
+            if (!node) {
+                encoder().writeNull();
+                return;
+            }
+
+            visit(Overloaded{
+                [&](const Value* valueNode) {
+                    writeValue(*valueNode);
+                },
+                [&](const Array* arrayNode) {
+                    encoder().writeArrayHeader(arrayNode->size());
+                    if (arrayNode->getIsPacked()) {
+                        for (size_t index = 0; index < arrayNode->size(); ++index) {
+                            writeValue(arrayNode->getPackedValue(index));
+                            flushIfFull();
+                        }
+                    }
+                    else {
+                        for (const auto& elem : arrayNode->getElems()) {
+                            write(elem);
+                        }
+                    }
+                },
+                [&](const Table* tableNode) {
+                    std::vector<const Key*> keys;
+                    keys.reserve(tableNode->getElems().size());
+                    for (const auto& [key, keyNode] : tableNode->getElems()) {
+                        if (keyNode) keys.push_back(keyNode);
+                    }
+                    std::sort(keys.begin(), keys.end(), [](const Key* left, const Key* right) {
+                        return left->getId() < right->getId();
+                    });
+                    encoder().writeMapHeader(keys.size());
+                    for (const auto* keyNode : keys) {
+                        encoder().writeString(keyNode->getId());
+                        write(keyNode->getValue());
+                    }
+                },
+                [&](const Key* keyNode) {
+                    encoder().writeMapHeader(1);
+                    encoder().writeString(keyNode->getId());
+                    write(keyNode->getValue());
+                }
+            }, node);
+            flushIfFull();
+        }
+
+        void flush() {
+            output.write(buffer.data(), buffer.size());
+            buffer.clear();
+        }
+
+    protected:
+        static constexpr size_t BufferSize = 64 * 1024;
+
+        Encoder& encoder() {
+            return static_cast<Encoder&>(*this);
+        }
+
+        void flushIfFull() {
+            if (buffer.size() >= BufferSize) {
+                flush();
+            }
+        }
+
+        void putByte(uint8_t byte) {
+            buffer.push_back(static_cast<char>(byte));
+        }
+
+        template <typename Integer>
+        void putBigEndian(Integer number) {
+            char bytes[sizeof(Integer)];
+            for (size_t index = 0; index < sizeof(Integer); ++index) {
+                bytes[index] = static_cast<char>(number >> ((sizeof(Integer) - 1 - index) * 8));
+            }
+            buffer.append(bytes, sizeof(Integer));
+        }
+
+        void putDouble(double number) {
+            putBigEndian(std::bit_cast<uint64_t>(number));
+        }
+
+        void putBytes(std::string_view bytes) {
+            buffer.append(bytes);
+        }
+
+        template <typename ValueType>
+        void writeValue(const ValueType& value) {
+            auto type = value.getType();
+            switch (type ? type->getKind() : Type::Type::Kind::Invalid) {
+            case Type::Type::Kind::String:
+                encoder().writeString(value.getString());
+                return;
+            case Type::Type::Kind::Integer: {
+                if (auto integer = value.getInteger()) {
+                    encoder().writeInteger(*integer < 0 ? 0 - static_cast<uint64_t>(*integer) : static_cast<uint64_t>(*integer), *integer < 0);
+                    return;
+                }
+                uint64_t magnitude;
+                bool isNegative;
+                if (ParseIntegerLiteral(value.getValue(), magnitude, isNegative) && encoder().writeInteger(magnitude, isNegative)) {
+                    return;
+                }
+                std::string literal(value.getValue());
+                literal.erase(std::remove(literal.begin(), literal.end(), '_'), literal.end());
+                if (!literal.empty() && literal[0] == '+') {
+                    literal.erase(literal.begin());
+                }
+                encoder().writeString(convertToDecimalString(literal));
+                return;
+            }
+            case Type::Type::Kind::Float:
+            case Type::Type::Kind::SpecialNumber:
+                if (auto number = value.getFloat()) {
+                    encoder().writeFloat(*number);
+                    return;
+                }
+                break;
+            case Type::Type::Kind::Boolean:
+                encoder().writeBoolean(value.getBoolean().value_or(false));
+                return;
+            case Type::Type::Kind::DateTime:
+                if (auto dateTime = value.getDateTime()) {
+                    encoder().writeDateTime(*dateTime);
+                    return;
+                }
+                break;
+            default:
+                break;
+            }
+            encoder().writeString(value.getValue());
+        }
+
+        std::ostream& output;
+        std::string buffer;
+    };
+
+    class CborWriter : public BinaryWriter<CborWriter> {
+    public:
+        using BinaryWriter<CborWriter>::BinaryWriter;
+
+        void writeNull() {
+            putByte(0xF6);
+        }
+
+        void writeBoolean(bool boolean) {
+            putByte(boolean ? 0xF5 : 0xF4);
+        }
+
+        void writeArrayHeader(size_t size) {
+            writeHead(4, size);
+        }
+
+        void writeMapHeader(size_t size) {
+            writeHead(5, size);
+        }
+
+        void writeString(std::string_view str) {
+            writeHead(3, str.size());
+            putBytes(str);
+        }
+
+        // Major type 1 holds -1 - n, so every 64-bit magnitude fits
+        bool writeInteger(uint64_t magnitude, bool isNegative) {
+            if (isNegative && magnitude) {
+                writeHead(1, magnitude - 1);
+            }
+            else {
+                writeHead(0, magnitude);
+            }
+            return true;
+        }
+
+        void writeFloat(double number) {
+            putByte(0xFB);
+            putDouble(number);
+        }
+
+        void writeDateTime(const DateTimeValue& dateTime) {
+            switch (dateTime.getKind()) {
+            case Type::DateTime::OffsetDateTime:
+                writeHead(6, 0);
+                break;
+            case Type::DateTime::LocalDate:
+                writeHead(6, 1004);
+                break;
+            default:
+                break;
+            }
+            writeString(FormatDateTime(dateTime));
+        }
+
+    protected:
+        // The initial byte of a major type and its argument, with the
+        // argument in the shortest form
+        void writeHead(uint8_t majorType, uint64_t argument) {
+            uint8_t major = static_cast<uint8_t>(majorType << 5);
+            if (argument < 24) {
+                putByte(major | static_cast<uint8_t>(argument));
+            }
+            else if (argument <= 0xFF) {
+                putByte(major | 24);
+                putByte(static_cast<uint8_t>(argument));
+            }
+            else if (argument <= 0xFFFF) {
+                putByte(major | 25);
+                putBigEndian(static_cast<uint16_t>(argument));
+            }
+            else if (argument <= 0xFFFFFFFF) {
+                putByte(major | 26);
+                putBigEndian(static_cast<uint32_t>(argument));
+            }
+            else {
+                putByte(major | 27);
+                putBigEndian(argument);
+            }
+        }
+    };
+
+    class MsgPackWriter : public BinaryWriter<MsgPackWriter> {
+    public:
+        using BinaryWriter<MsgPackWriter>::BinaryWriter;
+
+        void writeNull() {
+            putByte(0xC0);
+        }
+
+        void writeBoolean(bool boolean) {
+            putByte(boolean ? 0xC3 : 0xC2);
+        }
+
+        void writeArrayHeader(size_t size) {
+            if (size < 16) {
+                putByte(0x90 | static_cast<uint8_t>(size));
+            }
+            else if (size <= 0xFFFF) {
+                putByte(0xDC);
+                putBigEndian(static_cast<uint16_t>(size));
+            }
+            else {
+                putByte(0xDD);
+                putBigEndian(static_cast<uint32_t>(size));
+            }
+        }
+
+        void writeMapHeader(size_t size) {
+            if (size < 16) {
+                putByte(0x80 | static_cast<uint8_t>(size));
+            }
+            else if (size <= 0xFFFF) {
+                putByte(0xDE);
+                putBigEndian(static_cast<uint16_t>(size));
+            }
+            else {
+                putByte(0xDF);
+                putBigEndian(static_cast<uint32_t>(size));
+            }
+        }
+
+        void writeString(std::string_view str) {
+            if (str.size() < 32) {
+                putByte(0xA0 | static_cast<uint8_t>(str.size()));
+            }
+            else if (str.size() <= 0xFF) {
+                putByte(0xD9);
+                putByte(static_cast<uint8_t>(str.size()));
+            }
+            else if (str.size() <= 0xFFFF) {
+                putByte(0xDA);
+                putBigEndian(static_cast<uint16_t>(str.size()));
+            }
+            else {
+                putByte(0xDB);
+                putBigEndian(static_cast<uint32_t>(str.size()));
+            }
+            putBytes(str);
+        }
+
+        // Negative integers stop at the minimum of int64_t
+        bool writeInteger(uint64_t magnitude, bool isNegative) {
+            if (!isNegative || !magnitude) {
+                if (magnitude < 0x80) {
+                    putByte(static_cast<uint8_t>(magnitude));
+                }
+                else if (magnitude <= 0xFF) {
+                    putByte(0xCC);
+                    putByte(static_cast<uint8_t>(magnitude));
+                }
+                else if (magnitude <= 0xFFFF) {
+                    putByte(0xCD);
+                    putBigEndian(static_cast<uint16_t>(magnitude));
+                }
+                else if (magnitude <= 0xFFFFFFFF) {
+                    putByte(0xCE);
+                    putBigEndian(static_cast<uint32_t>(magnitude));
+                }
+                else {
+                    putByte(0xCF);
+                    putBigEndian(magnitude);
+                }
+                return true;
+            }
+            if (magnitude > uint64_t(1) << 63) {
+                return false;
+            }
+            int64_t integer = static_cast<int64_t>(0 - magnitude);
+            if (integer >= -32) {
+                putByte(static_cast<uint8_t>(integer));
+            }
+            else if (integer >= INT8_MIN) {
+                putByte(0xD0);
+                putByte(static_cast<uint8_t>(integer));
+            }
+            else if (integer >= INT16_MIN) {
+                putByte(0xD1);
+                putBigEndian(static_cast<uint16_t>(integer));
+            }
+            else if (integer >= INT32_MIN) {
+                putByte(0xD2);
+                putBigEndian(static_cast<uint32_t>(integer));
+            }
+            else {
+                putByte(0xD3);
+                putBigEndian(static_cast<uint64_t>(integer));
+            }
+            return true;
+        }
+
+        void writeFloat(double number) {
+            putByte(0xCB);
+            putDouble(number);
+        }
+
+        // The timestamp layouts: 32-bit seconds, 30-bit nanoseconds with
+        // 34-bit seconds, or 32-bit nanoseconds with 64-bit seconds
+        void writeDateTime(const DateTimeValue& dateTime) {
+            int8_t extensionType = -1;
+            switch (dateTime.getKind()) {
+            case Type::DateTime::LocalDateTime:
+                extensionType = MsgPackLocalDateTimeType;
+                break;
+            case Type::DateTime::LocalDate:
+                extensionType = MsgPackLocalDateType;
+                break;
+            case Type::DateTime::LocalTime:
+                extensionType = MsgPackLocalTimeType;
+                break;
+            default:
+                break;
+            }
+            if (dateTime.seconds >= 0 && dateTime.seconds >> 34 == 0) {
+                uint64_t packed = (static_cast<uint64_t>(dateTime.nanoseconds) << 34) | static_cast<uint64_t>(dateTime.seconds);
+                if (packed >> 32 == 0) {
+                    putByte(0xD6);
+                    putByte(static_cast<uint8_t>(extensionType));
+                    putBigEndian(static_cast<uint32_t>(packed));
+                }
+                else {
+                    putByte(0xD7);
+                    putByte(static_cast<uint8_t>(extensionType));
+                    putBigEndian(packed);
+                }
+                return;
+            }
+            putByte(0xC7);
+            putByte(12);
+            putByte(static_cast<uint8_t>(extensionType));
+            putBigEndian(dateTime.nanoseconds);
+            putBigEndian(static_cast<uint64_t>(dateTime.seconds));
+        }
+    };
+
+    void writeCbor(const DocTreeNode* node, std::ostream& output) {
+        CborWriter writer(output);
+        writer.write(node);
+        writer.flush();
+    }
+
+    void writeMsgPack(const DocTreeNode* node, std::ostream& output) {
+        MsgPackWriter writer(output);
+        writer.write(node);
+        writer.flush();
+    }
+#endif
+} // namespace DocTree
+
+#endif
@@ -4,9 +4,17 @@
 #define DOC_TREE_2_JSON_H
 
 #include <stdexcept>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <ostream>
 #include <json.hpp>
 #include "DocumentTree.h"
 #include "TomlStringUtils.h"
+#include "EscapeScanning.h"
+#include "Utf8Validation.h"
 
 using json = nlohmann::json;
 
@@ -14,163 +22,486 @@ namespace DocTree {
 
 #ifndef DEF_GLOBAL
     extern json toJson(const DocTreeNode* node, bool isValueTagged);
+    // Write the JSON text of a node to output as it walks the tree, the
+    // same text as toJson(node).dump(indent) without building the JSON
+    // tree first. Text is written through a buffer of a fixed size, so
+    // memory does not grow with the output. A negative indent writes
+    // compact JSON.
+    extern void writeJson(const DocTreeNode* node, bool isValueTagged, std::ostream& output, int indent = -1);
 #else
-    json toJson(const DocTreeNode* node, bool isValueTagged) {
-        if (!node) {
-            return nullptr; // Handle nullptr nodes as JSON null
-        }
-
-        // Handle Value nodes
-        if (const Value* valueNode = dynamic_cast<const Value*>(node)) {
-            auto [type, valueStr, defPos] = valueNode->get();
+    // Convert a value node, or an element of a packed array, which has the
+    // same accessors.
+    template <typename ValueType>
+    json valueToJson(const ValueType& value, bool isValueTagged) {
+        auto type = value.getType();
+        std::string valueStr(value.getValue());
 
-            if (dynamic_cast<Type::String*>(type)) {
+        switch (type ? type->getKind() : Type::Type::Kind::Invalid) {
+        case Type::Type::Kind::String: {
+            if (isValueTagged) {
+                json valueJson;
+                valueJson["type"] = "string";
+                valueJson["value"] = value.getString();
+                return valueJson;
+            }
+            else {
+                return value.getString();
+            }
+        }
+        case Type::Type::Kind::Integer: {
+            if (auto integer = value.getInteger()) {
                 if (isValueTagged) {
                     json valueJson;
-                    valueJson["type"] = "string";
-                    valueJson["value"] = extractStringLiteralContent(valueStr, ((Type::String*)type)->getType());
+                    valueJson["type"] = "integer";
+                    valueJson["value"] = std::to_string(*integer);
                     return valueJson;
                 }
                 else {
-                    return extractStringLiteralContent(valueStr, ((Type::String*)type)->getType());
+                    return std::to_string(*integer);
                 }
             }
-            else if (dynamic_cast<Type::Integer*>(type)) {
-                std::string valueStrWithoutDelimiter = valueStr;
-                valueStrWithoutDelimiter.erase(std::remove(valueStrWithoutDelimiter.begin(), valueStrWithoutDelimiter.end(), '_'), valueStrWithoutDelimiter.end());
-                if (valueStrWithoutDelimiter[0] == '+') {
-                    valueStrWithoutDelimiter.erase(valueStrWithoutDelimiter.begin());
+            std::string valueStrWithoutDelimiter = valueStr;
+            valueStrWithoutDelimiter.erase(std::remove(valueStrWithoutDelimiter.begin(), valueStrWithoutDelimiter.end(), '_'), valueStrWithoutDelimiter.end());
+            if (valueStrWithoutDelimiter[0] == '+') {
+                valueStrWithoutDelimiter.erase(valueStrWithoutDelimiter.begin());
+            }
+            std::string decimalValueStr = convertToDecimalString(valueStrWithoutDelimiter);
+            if (isValueTagged) {
+                json valueJson;
+                valueJson["type"] = "integer";
+                valueJson["value"] = decimalValueStr;
+                return valueJson;
+            }
+            else {
+                return decimalValueStr;
+            }
+        }
+        case Type::Type::Kind::Float: {
+            if (!isValueTagged) {
+                if (auto number = value.getFloat()) {
+                    return *number;
                 }
-                std::string decimalValueStr = convertToDecimalString(valueStrWithoutDelimiter);
-                if (isValueTagged) {
-                    json valueJson;
-                    valueJson["type"] = "integer";
-                    valueJson["value"] = decimalValueStr;
-                    return valueJson;
+            }
+            std::string valueStrWithoutDelimiter = valueStr;
+            valueStrWithoutDelimiter.erase(std::remove(valueStrWithoutDelimiter.begin(), valueStrWithoutDelimiter.end(), '_'), valueStrWithoutDelimiter.end());
+            if (valueStrWithoutDelimiter[0] == '+') {
+                valueStrWithoutDelimiter.erase(valueStrWithoutDelimiter.begin());
+            }
+            if (isValueTagged) {
+                json valueJson;
+                valueJson["type"] = "float";
+                valueJson["value"] = valueStrWithoutDelimiter;
+                return valueJson;
+            }
+            else {
+                return std::stod(valueStrWithoutDelimiter);
+            }
+        }
+        case Type::Type::Kind::Boolean: {
+            if (isValueTagged) {
+                json valueJson;
+                valueJson["type"] = "bool";
+                valueJson["value"] = valueStr;
+                return valueJson;
+            }
+            else {
+                return value.getBoolean().value_or(false);
+            }
+        }
+        case Type::Type::Kind::DateTime: {
+            // Date-times are written normalized, from their decoded value
+            auto dateTime = value.getDateTime();
+            std::string dateTimeStr = dateTime ? FormatDateTime(*dateTime) : valueStr;
+            if (isValueTagged) {
+                json valueJson;
+                switch (((Type::DateTime*)type)->getType()) {
+                case Type::DateTime::OffsetDateTime:
+                    valueJson["type"] = "datetime";
+                    break;
+                case Type::DateTime::LocalDateTime:
+                    valueJson["type"] = "datetime-local";
+                    break;
+                case Type::DateTime::LocalDate:
+                    valueJson["type"] = "date-local";
+                    break;
+                case Type::DateTime::LocalTime:
+                    valueJson["type"] = "time-local";
+                    break;
+                default:
+                    break;
+                }
+                valueJson["value"] = dateTimeStr;
+                return valueJson;
+            }
+            else {
+                return dateTimeStr; // DateTime as string
+            }
+        }
+        case Type::Type::Kind::SpecialNumber: {
+            if (isValueTagged) {
+                json valueJson;
+                valueJson["type"] = "float";
+                if (((Type::SpecialNumber*)type)->getType() == Type::SpecialNumber::NaN) {
+                    valueJson["value"] = "nan";
                 }
                 else {
-                    return decimalValueStr;
+                    valueJson["value"] = valueStr;
                 }
+                return valueJson;
+            }
+            else if (auto number = value.getFloat()) {
+                return *number;
             }
-            else if (dynamic_cast<Type::Float*>(type)) {
-                std::string valueStrWithoutDelimiter = valueStr;
-                valueStrWithoutDelimiter.erase(std::remove(valueStrWithoutDelimiter.begin(), valueStrWithoutDelimiter.end(), '_'), valueStrWithoutDelimiter.end());
-                if (valueStrWithoutDelimiter[0] == '+') {
-                    valueStrWithoutDelimiter.erase(valueStrWithoutDelimiter.begin());
+            else {
+                if (valueStr == "nan" || valueStr == "+nan") {
+                    return std::numeric_limits<double>::quiet_NaN();
                 }
-                if (isValueTagged) {
-                    json valueJson;
-                    valueJson["type"] = "float";
-                    valueJson["value"] = valueStrWithoutDelimiter;
-                    return valueJson;
+                else if (valueStr == "-nan") {
+                    return -std::numeric_limits<double>::quiet_NaN();
                 }
-                else {
-                    return std::stod(valueStrWithoutDelimiter);
+                else if (valueStr == "inf" || valueStr == "+inf") {
+                    return std::numeric_limits<double>::infinity();
                 }
-            }
-            else if (dynamic_cast<Type::Boolean*>(type)) {
-                if (isValueTagged) {
-                    json valueJson;
-                    valueJson["type"] = "bool";
-                    valueJson["value"] = valueStr;
-                    return valueJson;
+                else if (valueStr == "-inf") {
+                    return -std::numeric_limits<double>::infinity();
                 }
                 else {
-                    return valueStr == "true";
+                    throw std::runtime_error("Invalid SpecialNumber value: " + valueStr);
                 }
             }
-            else if (dynamic_cast<Type::DateTime*>(type)) {
-                if (isValueTagged) {
-                    json valueJson;
-                    switch (((Type::DateTime*)type)->getType()) {
-                    case Type::DateTime::OffsetDateTime:
-                        valueJson["type"] = "datetime";
-                        break;
-                    case Type::DateTime::LocalDateTime:
-                        valueJson["type"] = "datetime-local";
-                        break;
-                    case Type::DateTime::LocalDate:
-                        valueJson["type"] = "date-local";
-                        break;
-                    case Type::DateTime::LocalTime:
-                        valueJson["type"] = "time-local";
-                        break;
-                    default:
-                        break;
+        }
+        default:
+            throw std::runtime_error("Unsupported Type in Value node");
+        }
+    }
+
+    json toJson(const DocTreeNode* node, bool isValueTagged) {
+        if (!node) {
+            return nullptr; // Handle nullptr nodes as JSON null
+        }
+
+        return visit(Overloaded{
+            [&](const Value* valueNode) -> json {
+                return valueToJson(*valueNode, isValueTagged);
+            },
+            [&](const Array* arrayNode) -> json {
+                json arr = json::array();
+                if (arrayNode->getIsPacked()) {
+                    for (size_t index = 0; index < arrayNode->size(); ++index) {
+                        arr.push_back(valueToJson(arrayNode->getPackedValue(index), isValueTagged));
                     }
-                    valueJson["value"] = valueStr;
-                    return valueJson;
+                    return arr;
                 }
-                else {
-                    return valueStr; // DateTime as string
+                for (const auto& elem : arrayNode->getElems()) {
+                    arr.push_back(elem ? toJson(elem, isValueTagged) : json(nullptr));
                 }
+                return arr;
+            },
+            [&](const Table* tableNode) -> json {
+                json obj = json::object();
+                for (const auto& [key, keyNode] : tableNode->getElems()) {
+                    if (!keyNode) continue; // Skip null Key nodes
+                    auto value = keyNode->getValue();
+                    obj[std::string(keyNode->getId())] = value ? toJson(value, isValueTagged) : json(nullptr);
+                }
+                return obj;
+            },
+            // Key nodes, if encountered directly
+            [&](const Key* keyNode) -> json {
+                auto value = keyNode->getValue();
+                json obj = json::object();
+                obj[std::string(keyNode->getId())] = value ? toJson(value, isValueTagged) : json(nullptr);
+                return obj;
             }
-            else if (dynamic_cast<Type::SpecialNumber*>(type)) {
-                if (isValueTagged) {
-                    json valueJson;
-                    valueJson["type"] = "float";
-                    if (((Type::SpecialNumber*)type)->getType() == Type::SpecialNumber::NaN) {
-                        valueJson["value"] = "nan";
+        }, node);
+    }
+
+    class JsonWriter {
+    public:
+        JsonWriter(std::ostream& output, bool isValueTagged, int indent)
+            : output(output), isValueTagged(isValueTagged), indent(indent), depth(0) {
+            buffer.reserve(BufferSize + BufferSize / 4);
+        }
+
+        void write(const DocTreeNode* node) {
+            if (!node) {
+                buffer += "null";
+                return;
+            }
+
+            visit(Overloaded{
+                [&](const Value* valueNode) {
+                    writeValue(*valueNode);
+                },
+                [&](const Array* arrayNode) {
+                    beginContainer('[');
+                    if (arrayNode->getIsPacked()) {
+                        for (size_t index = 0; index < arrayNode->size(); ++index) {
+                            beginElement(index);
+                            writeValue(arrayNode->getPackedValue(index));
+                            flushIfFull();
+                        }
                     }
                     else {
-                        valueJson["value"] = valueStr;
+                        size_t index = 0;
+                        for (const auto& elem : arrayNode->getElems()) {
+                            beginElement(index++);
+                            write(elem);
+                        }
                     }
-                    return valueJson;
-                }
-                else {
-                    if (valueStr == "nan" || valueStr == "+nan") {
-                        return std::numeric_limits<double>::quiet_NaN();
-                    }
-                    else if (valueStr == "-nan") {
-                        return -std::numeric_limits<double>::quiet_NaN();
+                    endContainer(']', !arrayNode->size());
+                },
+                [&](const Table* tableNode) {
+                    // Members are written in the order of their names, as
+                    // json objects keep them
+                    std::vector<const Key*> keys;
+                    keys.reserve(tableNode->getElems().size());
+                    for (const auto& [key, keyNode] : tableNode->getElems()) {
+                        if (keyNode) keys.push_back(keyNode);
                     }
-                    else if (valueStr == "inf" || valueStr == "+inf") {
-                        return std::numeric_limits<double>::infinity();
-                    }
-                    else if (valueStr == "-inf") {
-                        return -std::numeric_limits<double>::infinity();
-                    }
-                    else {
-                        throw std::runtime_error("Invalid SpecialNumber value: " + valueStr);
+                    std::sort(keys.begin(), keys.end(), [](const Key* left, const Key* right) {
+                        return left->getId() < right->getId();
+                    });
+                    beginContainer('{');
+                    for (size_t index = 0; index < keys.size(); ++index) {
+                        beginMember(index, keys[index]->getId());
+                        write(keys[index]->getValue());
                     }
+                    endContainer('}', keys.empty());
+                },
+                [&](const Key* keyNode) {
+                    beginContainer('{');
+                    beginMember(0, keyNode->getId());
+                    write(keyNode->getValue());
+                    endContainer('}', false);
                 }
+            }, node);
+            flushIfFull();
+        }
+
+        void flush() {
+            output.write(buffer.data(), buffer.size());
+            buffer.clear();
+        }
+
+    protected:
+        static constexpr size_t BufferSize = 64 * 1024;
+
+        void flushIfFull() {
+            if (buffer.size() >= BufferSize) {
+                flush();
             }
-            else {
-                throw std::runtime_error("Unsupported Type in Value node");
+        }
+
+        // Containers are laid out as json::dump lays them out
+        void beginContainer(char bracket) {
+            buffer.push_back(bracket);
+            ++depth;
+        }
+
+        void endContainer(char bracket, bool isEmpty) {
+            --depth;
+            if (indent >= 0 && !isEmpty) {
+                newLine();
+            }
+            buffer.push_back(bracket);
+        }
+
+        void beginElement(size_t index) {
+            if (index) {
+                buffer.push_back(',');
             }
+            if (indent >= 0) {
+                newLine();
+            }
+        }
+
+        void beginMember(size_t index, std::string_view name) {
+            beginElement(index);
+            writeString(name);
+            buffer += indent >= 0 ? ": " : ":";
+        }
+
+        void newLine() {
+            buffer.push_back('\n');
+            buffer.append(static_cast<size_t>(indent) * depth, ' ');
         }
 
-        // Handle Array nodes
-        if (const Array* arrayNode = dynamic_cast<const Array*>(node)) {
-            json arr = json::array();
-            const auto elemVec = std::get<0>(arrayNode->get());
-            for (const auto& elem : elemVec) {
-                arr.push_back(elem ? toJson(elem, isValueTagged) : json(nullptr));
+        // Strings that are not known to be valid UTF-8 at a glance, or
+        // that hold control characters, go through the escaper of
+        // nlohmann::json, which also throws its error for invalid UTF-8.
+        void writeString(std::string_view str) {
+            if (!IsUtf8ContentValid(str, true)) {
+                buffer += json(std::string(str)).dump();
+                return;
             }
-            return arr;
+            buffer.push_back('"');
+            AppendEscaped(buffer, str, false);
+            buffer.push_back('"');
         }
 
-        // Handle Table nodes
-        if (const Table* tableNode = dynamic_cast<const Table*>(node)) {
-            json obj = json::object();
-            const auto elemMap = std::get<0>(tableNode->get());
-            for (const auto& [key, keyNode] : elemMap) {
-                if (!keyNode) continue; // Skip null Key nodes
-                auto [id, value, parentTable] = keyNode->get();
-                obj[id] = value ? toJson(value, isValueTagged) : json(nullptr);
+        void writeNumber(double number) {
+            if (!std::isfinite(number)) {
+                buffer += "null";
+                return;
             }
-            return obj;
+            char digits[64];
+            buffer.append(digits, nlohmann::detail::to_chars(digits, digits + sizeof(digits), number));
         }
 
-        // Handle Key nodes (if encountered directly)
-        if (const Key* keyNode = dynamic_cast<const Key*>(node)) {
-            auto [id, value, parentTable] = keyNode->get();
-            json obj = json::object();
-            obj[id] = value ? toJson(value, isValueTagged) : json(nullptr);
-            return obj;
+        // Tagged values are objects of the type and the value as a string
+        void writeTagged(std::string_view type, std::string_view value) {
+            beginContainer('{');
+            beginMember(0, "type");
+            writeString(type);
+            beginMember(1, "value");
+            writeString(value);
+            endContainer('}', false);
         }
 
-        throw std::runtime_error("Unknown DocTreeNode type");
+        // Write the values that decode as valueToJson would convert them,
+        // and leave the others to valueToJson.
+        template <typename ValueType>
+        void writeValue(const ValueType& value) {
+            auto type = value.getType();
+            switch (type ? type->getKind() : Type::Type::Kind::Invalid) {
+            case Type::Type::Kind::String:
+                if (isValueTagged) {
+                    writeTagged("string", value.getString());
+                }
+                else {
+                    writeString(value.getString());
+                }
+                return;
+            case Type::Type::Kind::Integer:
+                if (auto integer = value.getInteger()) {
+                    char digits[24];
+                    std::string_view integerStr(digits, std::to_chars(digits, digits + sizeof(digits), *integer).ptr - digits);
+                    if (isValueTagged) {
+                        writeTagged("integer", integerStr);
+                    }
+                    else {
+                        writeString(integerStr);
+                    }
+                    return;
+                }
+                break;
+            case Type::Type::Kind::Float:
+                if (isValueTagged) {
+                    std::string literal(value.getValue());
+                    literal.erase(std::remove(literal.begin(), literal.end(), '_'), literal.end());
+                    if (!literal.empty() && literal[0] == '+') {
+                        literal.erase(literal.begin());
+                    }
+                    writeTagged("float", literal);
+                    return;
+                }
+                if (auto number = value.getFloat()) {
+                    writeNumber(*number);
+                    return;
+                }
+                break;
+            case Type::Type::Kind::Boolean:
+                if (isValueTagged) {
+                    writeTagged("bool", value.getValue());
+                }
+                else {
+                    buffer += value.getBoolean().value_or(false) ? "true" : "false";
+                }
+                return;
+            case Type::Type::Kind::DateTime: {
+                std::string_view tag;
+                switch (((Type::DateTime*)type)->getType()) {
+                case Type::DateTime::OffsetDateTime:
+                    tag = "datetime";
+                    break;
+                case Type::DateTime::LocalDateTime:
+                    tag = "datetime-local";
+                    break;
+                case Type::DateTime::LocalDate:
+                    tag = "date-local";
+                    break;
+                case Type::DateTime::LocalTime:
+                    tag = "time-local";
+                    break;
+                default:
+                    break;
+                }
+                if (isValueTagged && tag.empty()) {
+                    break;
+                }
+                auto dateTime = value.getDateTime();
+                std::string dateTimeStr = dateTime ? FormatDateTime(*dateTime) : std::string(value.getValue());
+                if (isValueTagged) {
+                    writeTagged(tag, dateTimeStr);
+                }
+                else {
+                    writeString(dateTimeStr);
+                }
+                return;
+            }
+            case Type::Type::Kind::SpecialNumber:
+                if (isValueTagged) {
+                    writeTagged("float", ((Type::SpecialNumber*)type)->getType() == Type::SpecialNumber::NaN ? std::string_view("nan") : value.getValue());
+                    return;
+                }
+                if (auto number = value.getFloat()) {
+                    writeNumber(*number);
+                    return;
+                }
+                break;
+            default:
+                break;
+            }
+            writeJsonValue(valueToJson(value, isValueTagged));
+        }
+
+        // Write a converted value in the layout of the rest of the output
+        void writeJsonValue(const json& value) {
+            switch (value.type()) {
+            case json::value_t::object: {
+                beginContainer('{');
+                size_t index = 0;
+                for (const auto& [name, member] : value.items()) {
+                    beginMember(index++, name);
+                    writeJsonValue(member);
+                }
+                endContainer('}', value.empty());
+                break;
+            }
+            case json::value_t::array: {
+                beginContainer('[');
+                size_t index = 0;
+                for (const auto& elem : value) {
+                    beginElement(index++);
+                    writeJsonValue(elem);
+                }
+                endContainer(']', value.empty());
+                break;
+            }
+            case json::value_t::string:
+                writeString(value.get_ref<const std::string&>());
+                break;
+            case json::value_t::number_float:
+                writeNumber(value.get<double>());
+                break;
+            default:
+                buffer += value.dump();
+                break;
+            }
+        }
+
+        std::ostream& output;
+        std::string buffer;
+        bool isValueTagged;
+        int indent;
+        int depth;
+    };
+
+    void writeJson(const DocTreeNode* node, bool isValueTagged, std::ostream& output, int indent = -1) {
+        JsonWriter writer(output, isValueTagged, indent);
+        writer.write(node);
+        writer.flush();
     }
 #endif
 } // namespace DocTree
@@ -3,248 +3,250 @@
 #ifndef DOC_TREE_2_TOML_H
 #define DOC_TREE_2_TOML_H
 
-#include <iostream>
-#include <sstream>
+#include <ostream>
+#include <string>
+#include <string_view>
 #include <vector>
 #include <algorithm>
-#include <iomanip>
+#include <array>
 #include "DocumentTree.h"
+#include "EscapeScanning.h"
 
 namespace DocTree {
 
 #ifndef DEF_GLOBAL
-    extern void toToml(DocTree::Table* docTree, std::ostream& output);
-    extern std::string toToml(DocTree::Table* docTree);
+    // Append the TOML text of a document to output, which callers can keep
+    // to format documents again without allocating. Keys are written in
+    // source order, or in the order of their names if isSorted.
+    extern void appendToml(const Table* docTree, std::string& output, bool isSorted = false);
+    extern void toToml(const Table* docTree, std::ostream& output, bool isSorted = false);
+    extern std::string toToml(const Table* docTree, bool isSorted = false);
 #else
-    void processInlineTable(Table* table, std::ostream& os, int indent = 0);
-    void processInlineArray(Array* array, std::ostream& os, int indent = 0);
-    void processTable(Table* table, std::ostream& os, const std::string& currentScope, int indent = 0);
-
-    std::string getIndent(int level) {
-        return std::string(level * 2, ' '); // 2 spaces per indent level
+    // Characters of bare keys: A-Za-z0-9_-
+    static constexpr std::array<bool, 256> BareKeyChars = [] {
+        std::array<bool, 256> chars{};
+        for (char c = '0'; c <= '9'; ++c) chars[c] = true;
+        for (char c = 'a'; c <= 'z'; ++c) chars[c] = true;
+        for (char c = 'A'; c <= 'Z'; ++c) chars[c] = true;
+        chars['_'] = true;
+        chars['-'] = true;
+        return chars;
+    }();
+
+    static bool isBareKey(std::string_view key) {
+        return !key.empty() && std::all_of(key.begin(), key.end(), [](char c) { return BareKeyChars[static_cast<unsigned char>(c)]; });
     }
 
-    static bool isBareKey(const std::string& key) {
-        for (char c : key) {
-            if (!((c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_' || c == '-')) {
-                return false;
+    // Writes a document as TOML: the values and inline arrays of each
+    // table first, under the header of the table, then its tables and
+    // arrays of tables. Text goes to a growable buffer, which is written to
+    // an output stream, if any, whenever it fills. The dotted path of the
+    // current table is kept escaped in one string that grows and shrinks
+    // as the walk enters and leaves tables, so headers are written without
+    // escaping or concatenating their keys again.
+    class TomlWriter {
+    public:
+        static constexpr size_t BufferSize = 1 << 16;
+
+        TomlWriter(std::string& buffer, std::ostream* output, bool isSorted)
+            : buffer(buffer), output(output), isSorted(isSorted), isAtStart(buffer.empty()) {}
+
+        void write(const Table* table) {
+            writeTable(table, 0);
+            if (output) {
+                flush();
             }
         }
-        return true;
-    }
 
-    static std::string escapeKey(const std::string& key) {
-        std::ostringstream oss;
-        for (char c : key) {
-            if (c == '"') {
-                oss << "\\\"";
-            }
-            else if (c == '\\') {
-                oss << "\\\\";
-            }
-            else if (c == '\b') {
-                oss << "\\b";
-            }
-            else if (c == '\t') {
-                oss << "\t";
-            }
-            else if (c == '\n') {
-                oss << "\\n";
-            }
-            else if (c == '\f') {
-                oss << "\\f";
-            }
-            else if (c == '\r') {
-                oss << "\\r";
-            }
-            else {
-                if ((c >= 0x00 && c <= 0x08) || (c >= 0x0A && c <= 0x1F) || c == 0x7F) {
-                    oss << "\\u"
-                        << std::hex << std::setw(4) << std::setfill('0')
-                        << static_cast<unsigned int>(static_cast<unsigned char>(c));
-                }
-                else {
-                    oss << c;
-                }
-            }
+    protected:
+        void flush() {
+            output->write(buffer.data(), buffer.size());
+            buffer.clear();
         }
-        return oss.str();
-    }
 
-    void processInlineTable(Table* table, std::ostream& os, int indent) {
-        const auto& elems = table->getElems();
-        std::vector<std::string> keys;
-        for (const auto& [key, _] : elems) keys.push_back(key);
-        std::sort(keys.begin(), keys.end()); // Sort keys lexicographically
-
-        os << "{ ";
-        bool first = true;
-        for (const auto& key : keys) {
-            auto* keyNode = elems.at(key);
-            if (!keyNode) continue;
-            const auto& [id, valueNode, parentTable] = keyNode->get();
-            if (!valueNode) continue;
-
-            if (!first) os << ", ";
-            first = false;
-
-            // Escape and quote key if needed
-            if (isBareKey(id)) {
-                os << id;
-            }
-            else {
-                os << "\"" << escapeKey(id) << "\"";
-            }
-            os << " = ";
-            if (auto* value = dynamic_cast<Value*>(valueNode)) {
-                auto [type, valStr, defPos] = value->get();
-                os << valStr;
-            }
-            else if (auto* array = dynamic_cast<Array*>(valueNode)) {
-                processInlineArray(array, os, indent);
-            }
-            else if (auto* nestedTable = dynamic_cast<Table*>(valueNode)) {
-                processInlineTable(nestedTable, os, indent);
+        void flushIfFull() {
+            if (output && buffer.size() >= BufferSize) {
+                flush();
             }
         }
-        os << " }";
-    }
 
-    void processInlineArray(Array* array, std::ostream& os, int indent) {
-        const auto& elems = array->getElems();
-        os << "[ ";
-        bool first = true;
-        for (const auto& elem : elems) {
-            if (!elem) continue;
-
-            if (!first) os << ", ";
-            first = false;
-
-            if (auto* value = dynamic_cast<Value*>(elem)) {
-                auto [type, valStr, defPos] = value->get();
-                os << valStr;
-            }
-            else if (auto* nestedArray = dynamic_cast<Array*>(elem)) {
-                processInlineArray(nestedArray, os, indent);
-            }
-            else if (auto* table = dynamic_cast<Table*>(elem)) {
-                processInlineTable(table, os, indent);
-            }
+        void writeIndent(int indent) {
+            buffer.append(size_t(indent) * 2, ' '); // 2 spaces per indent level
         }
-        os << " ]";
-    }
 
-    void processArray(const std::string& key, Array* array, std::ostream& os, const std::string& currentScope, int indent) {
-        const auto& elems = array->getElems();
-        bool isArrayOfTables = elems.size() && std::all_of(elems.begin(), elems.end(), [](const auto& elem) {
-            if (!elem) return false;
-            auto* table = dynamic_cast<Table*>(elem);
-            return table && table->getIsExplicitlyDefined();
-        });
-
-        if (isArrayOfTables) {
-            std::string escapedKey;
+        static void appendKey(std::string& out, std::string_view key) {
             if (isBareKey(key)) {
-                escapedKey = key;
+                out += key;
             }
             else {
-                escapedKey = "\"" + escapeKey(key) + "\"";
+                out += '"';
+                AppendEscaped(out, key, true);
+                out += '"';
             }
-            std::string arrayScope = currentScope.empty() ? escapedKey : currentScope + "." + escapedKey;
-
-            for (const auto& elem : elems) {
-                if (!elem) continue;
-                Table* tableElem = static_cast<Table*>(elem);
-                if (os.tellp() != 0) os << "\n";
-                os << getIndent(indent) << "[[" << arrayScope << "]]\n";
-                processTable(tableElem, os, arrayScope, indent + 1);
+        }
+
+        // Headers after the first are set apart by an empty line
+        void writeHeader(std::string_view open, std::string_view close, int indent) {
+            if (!isAtStart) {
+                buffer += '\n';
             }
+            writeIndent(indent);
+            buffer += open;
+            buffer += scope;
+            buffer += close;
+            buffer += '\n';
         }
-        else {
-            os << getIndent(indent);
-            if (isBareKey(key)) {
-                os << key;
+
+        void writeInlineValue(const DocTreeNode* node) {
+            visit(Overloaded{
+                [&](const Value* value) {
+                    buffer += value->getValue();
+                },
+                [&](const Array* array) {
+                    writeInlineArray(array);
+                },
+                [&](const Table* table) {
+                    writeInlineTable(table);
+                },
+                [&](const Key*) {}
+            }, node);
+        }
+
+        void writeInlineArray(const Array* array) {
+            buffer += "[ ";
+            if (array->getIsPacked()) {
+                for (size_t index = 0; index < array->size(); ++index) {
+                    if (index) buffer += ", ";
+                    buffer += array->getPackedValue(index).getValue();
+                }
             }
             else {
-                os << "\"" << escapeKey(key) << "\"";
+                bool isFirst = true;
+                for (const auto& elem : array->getElems()) {
+                    if (!elem) continue;
+                    if (!isFirst) buffer += ", ";
+                    isFirst = false;
+                    writeInlineValue(elem);
+                }
             }
-            os << " = ";
-            processInlineArray(array, os, indent);
-            os << "\n";
+            buffer += " ]";
         }
-    }
 
-    void processTable(Table* table, std::ostream& os, const std::string& currentScope, int indent) {
-        const auto& elems = table->getElems();
-        std::vector<std::string> keys;
-        for (const auto& [key, _] : elems) keys.push_back(key);
-        std::sort(keys.begin(), keys.end()); // Sort keys lexicographically
-
-        // Process non-table values first for better readability
-        for (const auto& key : keys) {
-            auto* keyNode = elems.at(key);
-            if (!keyNode) continue;
-            const auto& [id, valueNode, parentTable] = keyNode->get();
-            if (!valueNode) continue;
-
-            if (dynamic_cast<Value*>(valueNode) || dynamic_cast<Array*>(valueNode)) {
-                os << getIndent(indent);
-                if (auto* value = dynamic_cast<Value*>(valueNode)) {
-                    auto [type, valStr, defPos] = value->get();
-                    if (isBareKey(id)) {
-                        os << id;
-                    }
-                    else {
-                        os << "\"" << escapeKey(id) << "\"";
+        void writeInlineTable(const Table* table) {
+            buffer += "{ ";
+            bool isFirst = true;
+            forEachMember(table, [&](std::string_view id, const DocTreeNode* valueNode) {
+                if (!isFirst) buffer += ", ";
+                isFirst = false;
+                appendKey(buffer, id);
+                buffer += " = ";
+                writeInlineValue(valueNode);
+            });
+            buffer += " }";
+        }
+
+        // Packed arrays hold values only, and are not unpacked to be told
+        // apart from arrays of tables
+        static bool isArrayOfTables(const Array* array) {
+            return !array->getIsPacked() && array->size() && std::all_of(array->getElems().begin(), array->getElems().end(), [](const auto& elem) {
+                auto* table = nodeCast<Table>(elem);
+                return table && table->getIsExplicitlyDefined();
+            });
+        }
+
+        // Calls visitor with the key and value of each member of table,
+        // in source order or in the order of their keys
+        template <typename Visitor>
+        void forEachMember(const Table* table, Visitor&& visitor) {
+            if (!isSorted) {
+                for (const auto& [id, keyNode] : table->getElems()) {
+                    if (keyNode && keyNode->getValue()) {
+                        visitor(id, keyNode->getValue());
                     }
-                    os << " = " << valStr << "\n";
-                }
-                else if (auto* array = dynamic_cast<Array*>(valueNode)) {
-                    processArray(id, array, os, currentScope, indent);
                 }
+                return;
+            }
+            std::vector<const Key*> keys;
+            keys.reserve(table->getElems().size());
+            for (const auto& [id, keyNode] : table->getElems()) {
+                if (keyNode && keyNode->getValue()) keys.push_back(keyNode);
+            }
+            std::sort(keys.begin(), keys.end(), [](const Key* left, const Key* right) {
+                return left->getId() < right->getId();
+            });
+            for (const Key* keyNode : keys) {
+                visitor(keyNode->getId(), keyNode->getValue());
             }
         }
 
-        // Process nested tables last
-        for (const auto& key : keys) {
-            auto* keyNode = elems.at(key);
-            if (!keyNode) continue;
-            const auto& [id, valueNode, parentTable] = keyNode->get();
-            if (!valueNode) continue;
-
-            if (auto* tableValue = dynamic_cast<Table*>(valueNode)) {
-                std::string escapedId;
-                if (isBareKey(id)) {
-                    escapedId = id;
+        void writeTable(const Table* table, int indent) {
+            // Values and inline arrays first, as they belong to the header
+            // written last
+            forEachMember(table, [&](std::string_view id, const DocTreeNode* valueNode) {
+                auto* array = nodeCast<Array>(valueNode);
+                if (nodeCast<Table>(valueNode) || (array && isArrayOfTables(array))) {
+                    return;
                 }
-                else {
-                    escapedId = "\"" + escapeKey(id) + "\"";
+                writeIndent(indent);
+                appendKey(buffer, id);
+                buffer += " = ";
+                writeInlineValue(valueNode);
+                buffer += '\n';
+                isAtStart = false;
+                flushIfFull();
+            });
+
+            // Then tables and arrays of tables, in the same order
+            forEachMember(table, [&](std::string_view id, const DocTreeNode* valueNode) {
+                auto* tableValue = nodeCast<Table>(valueNode);
+                auto* array = nodeCast<Array>(valueNode);
+                if (!tableValue && !(array && isArrayOfTables(array))) {
+                    return;
+                }
+                size_t scopeSize = scope.size();
+                if (scopeSize) {
+                    scope += '.';
                 }
-                //if (tableValue->getIsExplicitlyDefined()) {
-                    std::string newScope = currentScope.empty() ? escapedId : currentScope + "." + escapedId;
+                appendKey(scope, id);
+                if (tableValue) {
                     if (tableValue->getIsExplicitlyDefined()) {
-                        if (os.tellp() != 0) os << "\n";
-                        os << getIndent(indent) << "[" << newScope << "]\n";
+                        writeHeader("[", "]", indent);
+                        isAtStart = false;
                     }
-                    processTable(tableValue, os, newScope, indent);
-                //}
-                //else {
-                //    os << getIndent(indent) << escapedId << " = ";
-                //    processInlineTable(tableValue, os, indent);
-                //    os << "\n";
-                //}
-            }
+                    writeTable(tableValue, indent);
+                }
+                else {
+                    for (const auto& elem : array->getElems()) {
+                        writeHeader("[[", "]]", indent);
+                        isAtStart = false;
+                        writeTable(static_cast<const Table*>(elem), indent + 1);
+                    }
+                }
+                scope.resize(scopeSize);
+            });
         }
+
+        std::string& buffer;
+        std::ostream* output;
+        std::string scope;
+        bool isSorted;
+        bool isAtStart;
+    };
+
+    void appendToml(const Table* docTree, std::string& output, bool isSorted) {
+        TomlWriter(output, nullptr, isSorted).write(docTree);
     }
 
-    void toToml(DocTree::Table* docTree, std::ostream& output) {
-        processTable(docTree, output, "", 0);
+    void toToml(const Table* docTree, std::ostream& output, bool isSorted) {
+        std::string buffer;
+        buffer.reserve(TomlWriter::BufferSize + TomlWriter::BufferSize / 4);
+        TomlWriter(buffer, &output, isSorted).write(docTree);
     }
 
-    std::string toToml(DocTree::Table* docTree) {
-        std::ostringstream output;
-        toToml(docTree, output);
-        return output.str();
+    std::string toToml(const Table* docTree, bool isSorted) {
+        std::string output;
+        appendToml(docTree, output, isSorted);
+        return output;
     }
 #endif
 }
@@ -4,102 +4,306 @@
 #define DOCUMENT_TREE_H
 
 #include <string>
+#include <string_view>
 #include <vector>
-#include <unordered_map>
-#include <tuple>
-#include <any>
+#include <utility>
+#include <cstdint>
+#include <functional>
+#include <algorithm>
+#include <unordered_set>
+#include <optional>
+#include <variant>
+#include <limits>
+#include <memory_resource>
 #include "Type.h"
-#include "TypeUtils.h"
 #include "FilePosition.h"
-
-// get value from variable 'std::any value'
-#define get_any_val(varRealType, varName) \
-    if (value.type() == typeid(varRealType)) { \
-        varName = std::any_cast<varRealType>(value); \
-    } \
-    else { \
-        throw std::invalid_argument("Invalid value type"); \
-    }
+#include "TomlStringUtils.h"
+#include "NumericConversion.h"
+#include "DateTimeConversion.h"
 
 namespace DocTree
 {
+    // Nodes and their strings and containers are all allocated from the
+    // memory resource passed to their constructors, and their destructors
+    // are never run. A tree is freed all at once by releasing the resource,
+    // see Document.
     class DocTreeNode {
     public:
+        enum class Kind {
+            Value,
+            Array,
+            Key,
+            Table
+        };
+
+        DocTreeNode(Kind kind) : kind(kind) {}
         virtual ~DocTreeNode() {}
+
+        Kind getKind() const { return kind; }
+
+    private:
+        Kind kind;
     };
 
     class Value : public DocTreeNode {
     public:
-        Value(Type::Type* type, std::string value, FilePosition::Region defPos) : type(CopyType(type)), value(value), defPos(defPos) {}
+        static constexpr Kind NodeKind = Kind::Value;
+
+        Value(Type::Type* type, std::string_view value, FilePosition::Region defPos, std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+            : DocTreeNode(NodeKind), type(type), value(value, resource), defPos(defPos), isDecoded(false) {}
+
+        Type::Type* getType() const {
+            return type;
+        }
+
+        // The literal as written in the source, for output that keeps it.
+        // The typed getters below decode the literal on first use and keep
+        // the result, so consumers do not parse it again.
+        std::string_view getValue() const {
+            return value;
+        }
 
-        ~Value() {
-            if (type) {
-                Type::DeleteType(type);
+        std::optional<bool> getBoolean() const {
+            decode();
+            auto boolean = std::get_if<bool>(&decoded);
+            return boolean ? std::optional<bool>(*boolean) : std::nullopt;
+        }
+
+        // Integers out of the range of int64_t are not decoded.
+        std::optional<int64_t> getInteger() const {
+            decode();
+            auto integer = std::get_if<int64_t>(&decoded);
+            return integer ? std::optional<int64_t>(*integer) : std::nullopt;
+        }
+
+        // Floats and special numbers. Floats out of the range of double
+        // are not decoded.
+        std::optional<double> getFloat() const {
+            decode();
+            auto number = std::get_if<double>(&decoded);
+            return number ? std::optional<double>(*number) : std::nullopt;
+        }
+
+        std::optional<DateTimeValue> getDateTime() const {
+            decode();
+            auto dateTime = std::get_if<DateTimeValue>(&decoded);
+            return dateTime ? std::optional<DateTimeValue>(*dateTime) : std::nullopt;
+        }
+
+        // The content of a string with its escapes decoded. Strings with
+        // nothing to decode are views of the literal; the others are decoded
+        // to the arena once. Malformed escapes throw each time, as
+        // DecodeStringLiteral does.
+        std::string_view getString() const {
+            auto stringProp = Type::typeCast<Type::String>(type);
+            if (!isDecoded && stringProp) {
+                std::string_view verbatim;
+                if (decodeVerbatimString(stringProp, value, verbatim)) {
+                    decoded = verbatim;
+                }
+                else {
+                    // Decoded straight into the arena, in room for the
+                    // whole literal, which the content never exceeds
+                    char* data = static_cast<char*>(value.get_allocator().resource()->allocate(value.size(), 1));
+                    decoded = std::string_view(data, DecodeStringLiteral(value, stringProp->getType(), data));
+                }
+                isDecoded = true;
             }
+            auto content = std::get_if<std::string_view>(&decoded);
+            return content ? *content : std::string_view();
+        }
+
+        const FilePosition::Region& getDefPos() const {
+            return defPos;
         }
 
-        std::tuple<Type::Type*, std::string, FilePosition::Region> get() const {
-            return std::make_tuple(type, value, defPos);
+        void setDefPos(const FilePosition::Region& defPos) {
+            this->defPos = defPos;
         }
 
-        template <int N>
-        void set(const std::any& value) {
-            if constexpr (N == 0) {
-                get_any_val(Type::Type*, this->type)
+        // Decode an integer literal, with its underscores, sign and base
+        // prefix, if it fits in int64_t.
+        static bool decodeInteger(std::string_view literal, int64_t& integer) {
+            uint64_t magnitude;
+            bool isNegative;
+            if (!ParseIntegerLiteral(literal, magnitude, isNegative) || magnitude > uint64_t(std::numeric_limits<int64_t>::max()) + (isNegative ? 1 : 0)) {
+                return false;
             }
-            else if constexpr (N == 1) {
-                get_any_val(std::string, this->value)
+            integer = static_cast<int64_t>(isNegative ? 0 - magnitude : magnitude);
+            return true;
+        }
+
+        static bool decodeFloat(std::string_view literal, double& number) {
+            return ParseFloatLiteral(literal, number);
+        }
+
+        static bool decodeSpecialNumber(std::string_view literal, double& number) {
+            if (literal == "nan" || literal == "+nan") {
+                number = std::numeric_limits<double>::quiet_NaN();
+            }
+            else if (literal == "-nan") {
+                number = -std::numeric_limits<double>::quiet_NaN();
             }
-            else if constexpr (N == 2) {
-                get_any_val(FilePosition::Region, this->defPos)
+            else if (literal == "inf" || literal == "+inf") {
+                number = std::numeric_limits<double>::infinity();
+            }
+            else if (literal == "-inf") {
+                number = -std::numeric_limits<double>::infinity();
             }
             else {
-                throw std::invalid_argument("Invalid setter index");
+                return false;
             }
+            return true;
+        }
+
+        // Get the content of a string literal that has nothing to decode,
+        // that is a single-line literal string or a basic string without
+        // escapes, as a view of the literal.
+        static bool decodeVerbatimString(const Type::String* type, std::string_view literal, std::string_view& content) {
+            if (literal.size() < 2 || !(type->getType() == Type::String::Raw || (type->getType() == Type::String::Basic && literal.find('\\') == std::string_view::npos))) {
+                return false;
+            }
+            content = literal.substr(1, literal.size() - 2);
+            return true;
+        }
+
+        // Decode a date-time literal that is nothing but the literal.
+        static bool decodeDateTime(std::string_view literal, DateTimeValue& dateTime) {
+            return !literal.empty() && DecodeDateTimeLiteral(literal, 0, dateTime) == literal.size();
         }
 
     protected:
+        // Decode a literal other than a string. Literals that cannot be
+        // decoded leave decoded empty, and consumers fall back to the text.
+        void decode() const {
+            if (isDecoded || !type) {
+                return;
+            }
+            switch (type->getKind()) {
+            case Type::Type::Kind::Boolean:
+                decoded = value == "true";
+                break;
+            case Type::Type::Kind::Integer: {
+                int64_t integer;
+                if (decodeInteger(value, integer)) {
+                    decoded = integer;
+                }
+                break;
+            }
+            case Type::Type::Kind::Float:
+            case Type::Type::Kind::SpecialNumber: {
+                double number;
+                if (type->getKind() == Type::Type::Kind::Float ? decodeFloat(value, number) : decodeSpecialNumber(value, number)) {
+                    decoded = number;
+                }
+                break;
+            }
+            case Type::Type::Kind::DateTime: {
+                DateTimeValue dateTime;
+                if (decodeDateTime(value, dateTime)) {
+                    decoded = dateTime;
+                }
+                break;
+            }
+            case Type::Type::Kind::String:
+                return;
+            default:
+                break;
+            }
+            isDecoded = true;
+        }
+
         Type::Type* type;
-        std::string value;
+        std::pmr::string value;
         FilePosition::Region defPos;
+        mutable bool isDecoded;
+        mutable std::variant<std::monostate, bool, int64_t, double, std::string_view, DateTimeValue> decoded;
     };
 
+    // An array keeps its elements as nodes, or, while they are all value
+    // literals of one type that decode without allocating, packed: the
+    // literals are kept back to back in one buffer and their payloads in
+    // one vector, with the type shared. Arrays of numbers, booleans and
+    // plain strings take a few bytes for each element this way instead of
+    // a node. Elements of arrays have no positions of their own, so packed
+    // elements keep none. Getting the elements as nodes unpacks the array
+    // for good; consumers that only read values use getPackedValue instead.
     class Array : public DocTreeNode {
-        using ValueArray = std::vector<DocTreeNode*>;
-
     public:
-        Array(ValueArray elems, bool isMutable, FilePosition::Region defPos)
-            : elems(elems), isMutable(isMutable), defPos(defPos) {}
+        using ValueArray = std::pmr::vector<DocTreeNode*>;
 
-        ~Array() {
-            for (auto elem : elems) {
-                if (elem) {
-                    delete elem;
-                }
+        static constexpr Kind NodeKind = Kind::Array;
+
+        // An element of a packed array, with the accessors of Value
+        class PackedValue {
+        public:
+            PackedValue(const Array* array, size_t index) : array(array), index(index) {}
+
+            Type::Type* getType() const {
+                return array->packed->type;
             }
-        }
 
-        std::tuple<ValueArray, bool, FilePosition::Region> get() const {
-            return std::make_tuple(elems, isMutable, defPos);
-        }
+            std::string_view getValue() const {
+                const auto& packed = *array->packed;
+                uint32_t start = index ? packed.ends[index - 1] : 0;
+                return std::string_view(packed.text).substr(start, packed.ends[index] - start);
+            }
 
-        template <int N>
-        void set(const std::any& value) {
-            if constexpr (N == 0) {
-                get_any_val(ValueArray, this->elems)
+            std::optional<bool> getBoolean() const {
+                return getType()->getKind() == Type::Type::Kind::Boolean ? std::optional<bool>(array->packed->scalars[index].boolean) : std::nullopt;
             }
-            else if constexpr (N == 1) {
-                get_any_val(bool, this->isMutable)
+
+            std::optional<int64_t> getInteger() const {
+                return getType()->getKind() == Type::Type::Kind::Integer ? std::optional<int64_t>(array->packed->scalars[index].integer) : std::nullopt;
             }
-            else if constexpr (N == 2) {
-                get_any_val(FilePosition::Region, this->defPos)
+
+            std::optional<double> getFloat() const {
+                auto kind = getType()->getKind();
+                return kind == Type::Type::Kind::Float || kind == Type::Type::Kind::SpecialNumber ? std::optional<double>(array->packed->scalars[index].number) : std::nullopt;
             }
-            else {
-                throw std::invalid_argument("Invalid setter index");
+
+            // Packed date-times keep only their text and are decoded on
+            // each call.
+            std::optional<DateTimeValue> getDateTime() const {
+                DateTimeValue dateTime;
+                return getType()->getKind() == Type::Type::Kind::DateTime && Value::decodeDateTime(getValue(), dateTime) ? std::optional<DateTimeValue>(dateTime) : std::nullopt;
+            }
+
+            std::string_view getString() const {
+                auto literal = getValue();
+                return Type::typeCast<Type::String>(getType()) ? literal.substr(1, literal.size() - 2) : std::string_view();
+            }
+
+            FilePosition::Region getDefPos() const {
+                return FilePosition::Region{};
+            }
+
+        private:
+            const Array* array;
+            size_t index;
+        };
+
+        Array(const ValueArray& elems, bool isMutable, FilePosition::Region defPos, std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+            : DocTreeNode(NodeKind), elems(elems, resource), packed(nullptr), isMutable(isMutable), defPos(defPos) {}
+
+        // Add a value literal, packing it if the array is empty or packed
+        // and the literal can join the ones there.
+        void addValue(Type::Type* type, std::string_view literal) {
+            if ((packed || elems.empty()) && pack(type, literal)) {
+                return;
             }
+            unpack();
+            elems.push_back(makeValue(type, literal));
         }
 
-        ValueArray getElems() const {
+        void addElem(DocTreeNode* elem) {
+            unpack();
+            elems.push_back(elem);
+        }
+
+        // Packed arrays have no element nodes; their elements are read with
+        // size and getPackedValue, or made into nodes with unpack
+        const ValueArray& getElems() const {
             return elems;
         }
 
@@ -107,6 +311,31 @@ namespace DocTree
             return elems;
         }
 
+        // Turn the packed elements into value nodes, for callers that
+        // change the array or need its elements as nodes
+        void unpack() {
+            if (!packed) {
+                return;
+            }
+            elems.reserve(packed->ends.size());
+            for (size_t index = 0; index < packed->ends.size(); ++index) {
+                elems.push_back(makeValue(packed->type, getPackedValue(index).getValue()));
+            }
+            packed = nullptr;
+        }
+
+        bool getIsPacked() const {
+            return packed != nullptr;
+        }
+
+        size_t size() const {
+            return packed ? packed->ends.size() : elems.size();
+        }
+
+        PackedValue getPackedValue(size_t index) const {
+            return PackedValue(this, index);
+        }
+
         bool getIsMutable() const {
             return isMutable;
         }
@@ -115,93 +344,288 @@ namespace DocTree
             isMutable = false;
         }
 
+        const FilePosition::Region& getDefPos() const {
+            return defPos;
+        }
+
+        void setDefPos(const FilePosition::Region& defPos) {
+            this->defPos = defPos;
+        }
+
     protected:
+        union Scalar {
+            int64_t integer;
+            double number;
+            bool boolean;
+        };
+
+        struct Packed {
+            explicit Packed(Type::Type* type, std::pmr::memory_resource* resource) : type(type), text(resource), ends(resource), scalars(resource) {}
+
+            Type::Type* type;
+            std::pmr::string text;
+            std::pmr::vector<uint32_t> ends;
+            // Payloads of numbers and booleans; strings and date-times
+            // are read from the text
+            std::pmr::vector<Scalar> scalars;
+        };
+
+        bool pack(Type::Type* type, std::string_view literal) {
+            if (!type || (packed && packed->type != type)) {
+                return false;
+            }
+            Scalar scalar{};
+            bool hasScalar = true;
+            switch (type->getKind()) {
+            case Type::Type::Kind::Boolean:
+                scalar.boolean = literal == "true";
+                break;
+            case Type::Type::Kind::Integer:
+                if (!Value::decodeInteger(literal, scalar.integer)) {
+                    return false;
+                }
+                break;
+            case Type::Type::Kind::Float:
+                if (!Value::decodeFloat(literal, scalar.number)) {
+                    return false;
+                }
+                break;
+            case Type::Type::Kind::SpecialNumber:
+                if (!Value::decodeSpecialNumber(literal, scalar.number)) {
+                    return false;
+                }
+                break;
+            case Type::Type::Kind::String: {
+                std::string_view content;
+                if (!Value::decodeVerbatimString(static_cast<Type::String*>(type), literal, content)) {
+                    return false;
+                }
+                hasScalar = false;
+                break;
+            }
+            case Type::Type::Kind::DateTime:
+                hasScalar = false;
+                break;
+            default:
+                return false;
+            }
+            if (!packed) {
+                auto resource = elems.get_allocator().resource();
+                packed = new (resource->allocate(sizeof(Packed), alignof(Packed))) Packed(type, resource);
+            }
+            if (packed->text.size() + literal.size() > std::numeric_limits<uint32_t>::max()) {
+                return false;
+            }
+            packed->text.append(literal);
+            packed->ends.push_back(static_cast<uint32_t>(packed->text.size()));
+            if (hasScalar) {
+                packed->scalars.push_back(scalar);
+            }
+            return true;
+        }
+
+        Value* makeValue(Type::Type* type, std::string_view literal) const {
+            auto resource = elems.get_allocator().resource();
+            return new (resource->allocate(sizeof(Value), alignof(Value))) Value(type, literal, FilePosition::Region{}, resource);
+        }
+
         ValueArray elems;
+        Packed* packed;
         bool isMutable;
         FilePosition::Region defPos;
     };
 
     class Table;
 
+    // The distinct key names of a document. Each name is copied to the
+    // arena once and every key with that name refers to that copy, so two
+    // interned names are equal exactly when their data pointers are.
+    class KeyInterner {
+    public:
+        explicit KeyInterner(std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+            : resource(resource), names(resource) {}
+
+        // Get the interned copy of name, adding it if it is new.
+        std::string_view intern(std::string_view name) {
+            auto nameIter = names.find(name);
+            if (nameIter != names.end()) {
+                return *nameIter;
+            }
+            // One byte more, so that empty names get storage of their own
+            char* data = static_cast<char*>(resource->allocate(name.size() + 1, 1));
+            std::copy(name.begin(), name.end(), data);
+            return *names.insert(std::string_view(data, name.size())).first;
+        }
+
+        // Get the interned copy of name, or a view with no data if no key
+        // of the document has that name.
+        std::string_view find(std::string_view name) const {
+            auto nameIter = names.find(name);
+            return nameIter == names.end() ? std::string_view() : *nameIter;
+        }
+
+        size_t size() const {
+            return names.size();
+        }
+
+    protected:
+        std::pmr::memory_resource* resource;
+        std::pmr::unordered_set<std::string_view> names;
+    };
+
     class Key : public DocTreeNode {
     public:
-        Key(std::string id, DocTreeNode* value, Table* parentTable) : id(id), value(value), parentTable(parentTable) {}
+        static constexpr Kind NodeKind = Kind::Key;
 
-        ~Key() {
-            if (value) {
-                delete value;
-            }
+        // The id must be interned by the KeyInterner of the document.
+        Key(std::string_view id, DocTreeNode* value, Table* parentTable, std::pmr::memory_resource* = nullptr)
+            : DocTreeNode(NodeKind), id(id), value(value), parentTable(parentTable) {}
+
+        std::string_view getId() const {
+            return id;
         }
 
-        std::tuple<std::string, DocTreeNode*, Table*> get() const {
-            return std::make_tuple(id, value, parentTable);
+        DocTreeNode* getValue() const {
+            return value;
         }
 
-        template <int N>
-        void set(const std::any& value) {
-            if constexpr (N == 0) {
-                get_any_val(std::string, this->id)
-            }
-            else if constexpr (N == 1) {
-                get_any_val(DocTreeNode*, this->value)
-            }
-            else if constexpr (N == 2) {
-                get_any_val(Table*, this->parentTable)
-            }
-            else {
-                throw std::invalid_argument("Invalid setter index");
-            }
+        void setValue(DocTreeNode* value) {
+            this->value = value;
+        }
+
+        Table* getParentTable() const {
+            return parentTable;
         }
 
     protected:
-        std::string id;
+        std::string_view id;
         DocTreeNode* value;
         Table* parentTable;
     };
 
-    class Table : public DocTreeNode {
-        using KeyTable = std::unordered_map<std::string, Key*>;
-
+    // The keys of a table in the order they were added. Entries are kept
+    // in one array, which is scanned for lookups while the table is small.
+    // Past IndexThreshold entries an open-addressing index of entry
+    // positions is kept as well. Names must be interned by the KeyInterner
+    // of the document, and are compared and hashed by their data pointers;
+    // look up other strings through KeyInterner::find first.
+    class KeyMap {
     public:
-        Table(KeyTable elems, bool isMutable, FilePosition::Region defPos, bool isExplicitlyDefined)
-            : elems(elems), isMutable(isMutable), defPos(defPos), isExplicitlyDefined(isExplicitlyDefined) {}
+        using key_type = std::string_view;
+        using mapped_type = Key*;
+        using value_type = std::pair<std::string_view, Key*>;
+        using const_iterator = std::pmr::vector<value_type>::const_iterator;
+        using iterator = const_iterator;
+
+        static constexpr size_t IndexThreshold = 8;
+
+        explicit KeyMap(std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+            : entries(resource), index(resource) {}
 
-        ~Table() {
-            for (auto& elem : elems) {
-                if (elem.second) {
-                    delete elem.second;
+        KeyMap(const KeyMap& other, std::pmr::memory_resource* resource)
+            : entries(other.entries, resource), index(other.index, resource) {}
+
+        void insert_or_assign(std::string_view name, Key* key) {
+            size_t position = locate(name);
+            if (position != NotFound) {
+                entries[position] = { name, key };
+                return;
+            }
+            entries.emplace_back(name, key);
+            if (entries.size() > IndexThreshold) {
+                if (entries.size() * 2 > index.size()) {
+                    rebuildIndex(index.empty() ? IndexThreshold * 4 : index.size() * 2);
+                }
+                else {
+                    addToIndex(entries.size() - 1);
                 }
             }
         }
 
-        std::tuple<KeyTable, bool, FilePosition::Region, bool> get() const {
-            return std::make_tuple(elems, isMutable, defPos, isExplicitlyDefined);
+        const_iterator find(std::string_view name) const {
+            size_t position = locate(name);
+            return position == NotFound ? entries.end() : entries.begin() + position;
         }
 
-        template <int N>
-        void set(const std::any& value) {
-            if constexpr (N == 0) {
-                get_any_val(KeyTable, this->elems)
-            }
-            else if constexpr (N == 1) {
-                get_any_val(bool, this->isMutable)
+        const_iterator begin() const {
+            return entries.begin();
+        }
+
+        const_iterator end() const {
+            return entries.end();
+        }
+
+        size_t size() const {
+            return entries.size();
+        }
+
+        bool empty() const {
+            return entries.empty();
+        }
+
+    protected:
+        static constexpr size_t NotFound = size_t(-1);
+
+        static size_t hash(std::string_view name) {
+            uint64_t address = reinterpret_cast<uintptr_t>(name.data());
+            address ^= address >> 33;
+            address *= 0xff51afd7ed558ccdULL;
+            return static_cast<size_t>(address ^ (address >> 33));
+        }
+
+        size_t locate(std::string_view name) const {
+            if (index.empty()) {
+                for (size_t position = 0; position < entries.size(); ++position) {
+                    if (entries[position].first.data() == name.data()) {
+                        return position;
+                    }
+                }
+                return NotFound;
             }
-            else if constexpr (N == 2) {
-                get_any_val(FilePosition::Region, this->defPos)
+            size_t mask = index.size() - 1;
+            for (size_t slot = hash(name) & mask; index[slot]; slot = (slot + 1) & mask) {
+                if (entries[index[slot] - 1].first.data() == name.data()) {
+                    return index[slot] - 1;
+                }
             }
-            else if constexpr (N == 3) {
-                get_any_val(bool, this->isExplicitlyDefined)
+            return NotFound;
+        }
+
+        // Slots hold the position of an entry plus one, so zero is empty.
+        void addToIndex(size_t position) {
+            size_t mask = index.size() - 1;
+            size_t slot = hash(entries[position].first) & mask;
+            while (index[slot]) {
+                slot = (slot + 1) & mask;
             }
-            else {
-                throw std::invalid_argument("Invalid setter index");
+            index[slot] = static_cast<uint32_t>(position + 1);
+        }
+
+        void rebuildIndex(size_t slotCount) {
+            index.assign(slotCount, 0);
+            for (size_t position = 0; position < entries.size(); ++position) {
+                addToIndex(position);
             }
         }
 
+        std::pmr::vector<value_type> entries;
+        std::pmr::vector<uint32_t> index;
+    };
+
+    class Table : public DocTreeNode {
+    public:
+        using KeyTable = KeyMap;
+
+        static constexpr Kind NodeKind = Kind::Table;
+
+        Table(const KeyTable& elems, bool isMutable, FilePosition::Region defPos, bool isExplicitlyDefined, std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+            : DocTreeNode(NodeKind), elems(elems, resource), isMutable(isMutable), defPos(defPos), isExplicitlyDefined(isExplicitlyDefined) {}
+
         void addElem(Key* key) {
-            elems[std::get<0>(key->get())] = key;
+            elems.insert_or_assign(key->getId(), key);
         }
 
-        KeyTable getElems() const {
+        const KeyTable& getElems() const {
             return elems;
         }
 
@@ -221,12 +645,109 @@ namespace DocTree
             return isExplicitlyDefined;
         }
 
+        void setIsExplicitlyDefined(bool isExplicitlyDefined) {
+            this->isExplicitlyDefined = isExplicitlyDefined;
+        }
+
+        const FilePosition::Region& getDefPos() const {
+            return defPos;
+        }
+
+        void setDefPos(const FilePosition::Region& defPos) {
+            this->defPos = defPos;
+        }
+
     protected:
         KeyTable elems;
         bool isMutable;
         FilePosition::Region defPos;
         bool isExplicitlyDefined;
     };
+
+    // Returns node as a NodeType if it is one, and null otherwise. This is
+    // a check of the kind tag, not a dynamic_cast.
+    template <typename NodeType>
+    NodeType* nodeCast(DocTreeNode* node) {
+        return node && node->getKind() == NodeType::NodeKind ? static_cast<NodeType*>(node) : nullptr;
+    }
+
+    template <typename NodeType>
+    const NodeType* nodeCast(const DocTreeNode* node) {
+        return node && node->getKind() == NodeType::NodeKind ? static_cast<const NodeType*>(node) : nullptr;
+    }
+
+    // Calls visitor with node, which must not be null, cast to the class of
+    // its kind. The visitor is typically an Overloaded set of lambdas, one
+    // for each node class, and all of them must return the same type.
+    template <typename Visitor>
+    decltype(auto) visit(Visitor&& visitor, DocTreeNode* node) {
+        switch (node->getKind()) {
+        case DocTreeNode::Kind::Value:
+            return visitor(static_cast<Value*>(node));
+        case DocTreeNode::Kind::Array:
+            return visitor(static_cast<Array*>(node));
+        case DocTreeNode::Kind::Key:
+            return visitor(static_cast<Key*>(node));
+        default:
+            return visitor(static_cast<Table*>(node));
+        }
+    }
+
+    template <typename Visitor>
+    decltype(auto) visit(Visitor&& visitor, const DocTreeNode* node) {
+        switch (node->getKind()) {
+        case DocTreeNode::Kind::Value:
+            return visitor(static_cast<const Value*>(node));
+        case DocTreeNode::Kind::Array:
+            return visitor(static_cast<const Array*>(node));
+        case DocTreeNode::Kind::Key:
+            return visitor(static_cast<const Key*>(node));
+        default:
+            return visitor(static_cast<const Table*>(node));
+        }
+    }
+
+    template <typename... Visitors>
+    struct Overloaded : Visitors... {
+        using Visitors::operator()...;
+    };
+
+    template <typename... Visitors>
+    Overloaded(Visitors...) -> Overloaded<Visitors...>;
+
+    // Owns a document tree. All nodes are bump-allocated from a chunked
+    // arena, so creating one is a pointer bump and destroying the document
+    // frees every node at once, without walking the tree. Key names are
+    // interned in the same arena.
+    class Document {
+    public:
+        Document() : keyInterner(&arena), root(make<Table>(Table::KeyTable(), true, FilePosition::Region{}, false)) {}
+
+        Document(const Document&) = delete;
+        Document& operator=(const Document&) = delete;
+
+        template <typename NodeType, typename... Args>
+        NodeType* make(Args&&... args) {
+            return new (arena.allocate(sizeof(NodeType), alignof(NodeType))) NodeType(std::forward<Args>(args)..., &arena);
+        }
+
+        Table* getRoot() const {
+            return root;
+        }
+
+        std::string_view intern(std::string_view name) {
+            return keyInterner.intern(name);
+        }
+
+        const KeyInterner& getKeyInterner() const {
+            return keyInterner;
+        }
+
+    protected:
+        std::pmr::monotonic_buffer_resource arena;
+        KeyInterner keyInterner;
+        Table* root;
+    };
 };
 
 #endif
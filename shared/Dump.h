@@ -34,67 +34,64 @@ namespace Dump
     void DumpType(Type::Type* type) {
         if (!type) return;
 
-        if (auto typeType = dynamic_cast<Type::Type*>(type)) {
-            if (auto typeInvalid = dynamic_cast<Type::Invalid*>(type)) {
-                logger << "invalid\n";
+        switch (type->getKind()) {
+        case Type::Type::Kind::Invalid:
+            logger << "invalid\n";
+            break;
+        case Type::Type::Kind::Boolean:
+            logger << "boolean\n";
+            break;
+        case Type::Type::Kind::Integer:
+            logger << "integer\n";
+            break;
+        case Type::Type::Kind::Float:
+            logger << "float\n";
+            break;
+        case Type::Type::Kind::SpecialNumber: {
+            auto specialNumberType = static_cast<Type::SpecialNumber*>(type)->getType();
+            if (specialNumberType == Type::SpecialNumber::NaN) {
+                logger << "NaN\n";
             }
-            else if (dynamic_cast<Type::Valid*>(type)) {
-                if (dynamic_cast<Type::BuiltIn*>(type)) {
-                    if (dynamic_cast<Type::Boolean*>(type)) {
-                        logger << "boolean\n";
-                    }
-                    else if (dynamic_cast<Type::Numeric*>(type)) {
-                        if (dynamic_cast<Type::Integer*>(type)) {
-                            logger << "integer\n";
-                        }
-                        else if (dynamic_cast<Type::Float*>(type)) {
-                            logger << "float\n";
-                        }
-                        else if (auto typeSpecialNumber = dynamic_cast<Type::SpecialNumber*>(type)) {
-                            auto specialNumberType = typeSpecialNumber->getType();
-                            if (specialNumberType == Type::SpecialNumber::NaN) {
-                                logger << "NaN\n";
-                            }
-                            else if (specialNumberType == Type::SpecialNumber::Infinity) {
-                                logger << "infinity\n";
-                            }
-                        }
-                    }
-                    else if (auto typeString = dynamic_cast<Type::String*>(type)) {
-                        auto stringType = typeString->getType();
-                        if (stringType == Type::String::Basic) {
-                            logger << "string\n";
-                        }
-                        else if (stringType == Type::String::MultiLineBasic) {
-                            logger << "multi-line string\n";
-                        }
-                        else if (stringType == Type::String::Raw) {
-                            logger << "literal string\n";
-                        }
-                        else if (stringType == Type::String::MultiLineRaw) {
-                            logger << "multi-line literal string\n";
-                        }
-                    }
-                    else if (auto typeDateTime = dynamic_cast<Type::DateTime*>(type)) {
-                        auto dateTimeType = typeDateTime->getType();
-                        if (dateTimeType == Type::DateTime::OffsetDateTime) {
-                            logger << "offset date-time\n";
-                        }
-                        else if (dateTimeType == Type::DateTime::LocalDateTime) {
-                            logger << "local date-time\n";
-                        }
-                        else if (dateTimeType == Type::DateTime::LocalDate) {
-                            logger << "local date\n";
-                        }
-                        else if (dateTimeType == Type::DateTime::LocalTime) {
-                            logger << "local time\n";
-                        }
-                    }
-                }
+            else if (specialNumberType == Type::SpecialNumber::Infinity) {
+                logger << "infinity\n";
+            }
+            break;
+        }
+        case Type::Type::Kind::String: {
+            auto stringType = static_cast<Type::String*>(type)->getType();
+            if (stringType == Type::String::Basic) {
+                logger << "string\n";
+            }
+            else if (stringType == Type::String::MultiLineBasic) {
+                logger << "multi-line string\n";
+            }
+            else if (stringType == Type::String::Raw) {
+                logger << "literal string\n";
+            }
+            else if (stringType == Type::String::MultiLineRaw) {
+                logger << "multi-line literal string\n";
+            }
+            break;
+        }
+        case Type::Type::Kind::DateTime: {
+            auto dateTimeType = static_cast<Type::DateTime*>(type)->getType();
+            if (dateTimeType == Type::DateTime::OffsetDateTime) {
+                logger << "offset date-time\n";
+            }
+            else if (dateTimeType == Type::DateTime::LocalDateTime) {
+                logger << "local date-time\n";
+            }
+            else if (dateTimeType == Type::DateTime::LocalDate) {
+                logger << "local date\n";
             }
+            else if (dateTimeType == Type::DateTime::LocalTime) {
+                logger << "local time\n";
+            }
+            break;
         }
-        else {
+        default:
             logger << "unknown type\n";
+            break;
         }
     }
 #endif
@@ -108,45 +105,52 @@ namespace Dump
         // Print the current node
         DumpIndent(indent);
 
-        if (auto value = dynamic_cast<DocTree::Value*>(node)) {
-            logger << "Value:\n";
-            DumpIndent(indent + 1);
-            logger << "type: ";
-            DumpType(std::get<0>(value->get()));
-            DumpIndent(indent + 1);
-            logger << "value: " << std::get<1>(value->get()) << "\n";
-        }
-        else if (auto array = dynamic_cast<DocTree::Array*>(node)) {
-            logger << "Array:\n";
-            DumpIndent(indent + 1);
-            logger << "elems:\n";
-            auto elems = std::get<0>(array->get());
-            for (auto elem : elems) {
-                DumpDocumentTree(elem, indent + 2);
-            }
-            DumpIndent(indent + 1);
-            logger << "isDynamic: " << (std::get<1>(array->get()) ? "true" : "false") << "\n";
-        }
-        else if (auto key = dynamic_cast<DocTree::Key*>(node)) {
-            logger << "Key:\n";
-            DumpIndent(indent + 1);
-            logger << "id: " << std::get<0>(key->get()) << "\n";
-            DumpIndent(indent + 1);
-            logger << "value:\n";
-            DumpDocumentTree(std::get<1>(key->get()), indent + 2);
-        }
-        else if (auto table = dynamic_cast<DocTree::Table*>(node)) {
-            logger << "Table\n";
-            DumpIndent(indent + 1);
-            logger << "elems:\n";
-            auto elems = std::get<0>(table->get());
-            for (auto elem : elems) {
-                DumpDocumentTree(elem.second, indent + 2);
+        DocTree::visit(DocTree::Overloaded{
+            [&](DocTree::Value* value) {
+                logger << "Value:\n";
+                DumpIndent(indent + 1);
+                logger << "type: ";
+                DumpType(value->getType());
+                DumpIndent(indent + 1);
+                logger << "value: " << std::string(value->getValue()) << "\n";
+            },
+            [&](DocTree::Array* array) {
+                logger << "Array:\n";
+                DumpIndent(indent + 1);
+                logger << "elems:\n";
+                for (size_t index = 0; array->getIsPacked() && index < array->size(); ++index) {
+                    auto packedValue = array->getPackedValue(index);
+                    DumpIndent(indent + 2);
+                    logger << "Value:\n";
+                    DumpIndent(indent + 3);
+                    logger << "type: ";
+                    DumpType(packedValue.getType());
+                    DumpIndent(indent + 3);
+                    logger << "value: " << std::string(packedValue.getValue()) << "\n";
+                }
+                for (auto elem : array->getElems()) {
+                    DumpDocumentTree(elem, indent + 2);
+                }
+                DumpIndent(indent + 1);
+                logger << "isDynamic: " << (array->getIsMutable() ? "true" : "false") << "\n";
+            },
+            [&](DocTree::Key* key) {
+                logger << "Key:\n";
+                DumpIndent(indent + 1);
+                logger << "id: " << std::string(key->getId()) << "\n";
+                DumpIndent(indent + 1);
+                logger << "value:\n";
+                DumpDocumentTree(key->getValue(), indent + 2);
+            },
+            [&](DocTree::Table* table) {
+                logger << "Table\n";
+                DumpIndent(indent + 1);
+                logger << "elems:\n";
+                for (const auto& elem : table->getElems()) {
+                    DumpDocumentTree(elem.second, indent + 2);
+                }
             }
-        }
-        else {
-            logger << "Unknown node type\n";
-        }
+        }, node);
     }
 #endif
 };
@@ -0,0 +1,339 @@
+#pragma once
+
+#ifndef ESCAPE_SCANNING_H
+#define ESCAPE_SCANNING_H
+
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include "CpuFeatures.h"
+
+// Helpers shared by the string unescapers of TOML and CSL, which write
+// their output straight to storage sized for the escaped text, and by the
+// TOML and JSON emitters, which escape strings the other way.
+//
+// CopyUntilEscape copies the bytes of in up to the first backslash, or
+// the first carriage return too if stopsAtCarriageReturn, to out and
+// returns how many bytes it copied. out must not overlap in and needs
+// room for size bytes, as whole vectors may be stored past the stop.
+//
+// WriteUtf8 writes a code point of up to 0x10FFFF as UTF-8 and returns
+// the number of bytes written.
+//
+// AppendEscaped appends str to out escaped for a quoted string, copying
+// the runs between bytes that need escapes in bulk. Quotes, backslashes
+// and control characters are escaped for JSON; keys of TOML, if
+// isTomlKey, also escape DEL and keep tabs as they are.
+#ifndef DEF_GLOBAL
+extern size_t CopyUntilEscape(const char* in, size_t size, char* out, bool stopsAtCarriageReturn);
+extern size_t WriteUtf8(char* out, uint32_t codePoint);
+extern void AppendEscaped(std::string& out, std::string_view str, bool isTomlKey);
+#else
+static size_t copyUntilEscapeScalar(const char* in, size_t size, char* out, bool stopsAtCarriageReturn) {
+    size_t i = 0;
+    for (; i < size; ++i) {
+        char ch = in[i];
+        if (ch == '\\' || (ch == '\r' && stopsAtCarriageReturn)) {
+            break;
+        }
+        out[i] = ch;
+    }
+    return i;
+}
+
+#ifdef SIMD_X86
+// Without a carriage return to stop at, the second comparison looks for
+// the backslash again.
+SIMD_TARGET("sse4.1")
+static size_t copyUntilEscapeSse(const char* in, size_t size, char* out, bool stopsAtCarriageReturn) {
+    const __m128i backslash = _mm_set1_epi8('\\');
+    const __m128i carriageReturn = _mm_set1_epi8(stopsAtCarriageReturn ? '\r' : '\\');
+    size_t i = 0;
+    for (; i + 16 <= size; i += 16) {
+        __m128i input = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), input);
+        uint32_t stops = static_cast<uint32_t>(_mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(input, backslash), _mm_cmpeq_epi8(input, carriageReturn))));
+        if (stops) {
+            return i + std::countr_zero(stops);
+        }
+    }
+    return i + copyUntilEscapeScalar(in + i, size - i, out + i, stopsAtCarriageReturn);
+}
+
+SIMD_TARGET("avx2")
+static size_t copyUntilEscapeAvx2(const char* in, size_t size, char* out, bool stopsAtCarriageReturn) {
+    const __m256i backslash = _mm256_set1_epi8('\\');
+    const __m256i carriageReturn = _mm256_set1_epi8(stopsAtCarriageReturn ? '\r' : '\\');
+    size_t i = 0;
+    for (; i + 32 <= size; i += 32) {
+        __m256i input = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + i));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), input);
+        uint32_t stops = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_or_si256(_mm256_cmpeq_epi8(input, backslash), _mm256_cmpeq_epi8(input, carriageReturn))));
+        if (stops) {
+            return i + std::countr_zero(stops);
+        }
+    }
+    return i + copyUntilEscapeScalar(in + i, size - i, out + i, stopsAtCarriageReturn);
+}
+#endif
+
+using EscapeCopier = size_t (*)(const char* in, size_t size, char* out, bool stopsAtCarriageReturn);
+
+static EscapeCopier selectEscapeCopier() {
+#ifdef SIMD_X86
+    if (GetCpuFeatures().hasAvx2) {
+        return copyUntilEscapeAvx2;
+    }
+    if (GetCpuFeatures().hasSse41) {
+        return copyUntilEscapeSse;
+    }
+#endif
+    return copyUntilEscapeScalar;
+}
+
+size_t CopyUntilEscape(const char* in, size_t size, char* out, bool stopsAtCarriageReturn) {
+    static const EscapeCopier copier = selectEscapeCopier();
+    // Runs between escapes are mostly short
+    if (size < 16) {
+        return copyUntilEscapeScalar(in, size, out, stopsAtCarriageReturn);
+    }
+    return copier(in, size, out, stopsAtCarriageReturn);
+}
+
+size_t WriteUtf8(char* out, uint32_t codePoint) {
+    if (codePoint <= 0x7F) {
+        out[0] = static_cast<char>(codePoint);
+        return 1;
+    }
+    if (codePoint <= 0x7FF) {
+        out[0] = static_cast<char>(0xC0 | (codePoint >> 6));
+        out[1] = static_cast<char>(0x80 | (codePoint & 0x3F));
+        return 2;
+    }
+    if (codePoint <= 0xFFFF) {
+        out[0] = static_cast<char>(0xE0 | (codePoint >> 12));
+        out[1] = static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F));
+        out[2] = static_cast<char>(0x80 | (codePoint & 0x3F));
+        return 3;
+    }
+    out[0] = static_cast<char>(0xF0 | (codePoint >> 18));
+    out[1] = static_cast<char>(0x80 | ((codePoint >> 12) & 0x3F));
+    out[2] = static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F));
+    out[3] = static_cast<char>(0x80 | (codePoint & 0x3F));
+    return 4;
+}
+
+// The letter after the backslash of the escape of each byte: that of its
+// short escape, 'u' for the other control characters and DEL, which are
+// written as \u00XX, and 0 for bytes written as they are.
+static constexpr std::array<char, 256> EscapeLetters = [] {
+    std::array<char, 256> letters{};
+    for (size_t byte = 0; byte < 0x20; ++byte) {
+        letters[byte] = 'u';
+    }
+    letters[0x7F] = 'u';
+    letters['"'] = '"';
+    letters['\\'] = '\\';
+    letters['\b'] = 'b';
+    letters['\t'] = 't';
+    letters['\n'] = 'n';
+    letters['\f'] = 'f';
+    letters['\r'] = 'r';
+    return letters;
+}();
+
+static bool needsEscape(char ch, bool escapesDelete) {
+    unsigned char byte = static_cast<unsigned char>(ch);
+    return EscapeLetters[byte] && (byte != 0x7F || escapesDelete);
+}
+
+// Write the escape of a byte that needs one. Keys of TOML keep tabs as
+// they are.
+static char* writeEscape(char* out, char ch, bool isTomlKey) {
+    static constexpr char hexDigits[] = "0123456789abcdef";
+    unsigned char byte = static_cast<unsigned char>(ch);
+    char letter = EscapeLetters[byte];
+    if (byte == '\t' && isTomlKey) {
+        *out++ = '\t';
+    }
+    else if (letter != 'u') {
+        *out++ = '\\';
+        *out++ = letter;
+    }
+    else {
+        const char escape[] = { '\\', 'u', '0', '0', hexDigits[byte >> 4], hexDigits[byte & 0xF] };
+        std::memcpy(out, escape, sizeof(escape));
+        out += sizeof(escape);
+    }
+    return out;
+}
+
+static size_t countBytesToEscapeScalar(const char* data, size_t size, bool isTomlKey) {
+    size_t count = 0;
+    for (size_t i = 0; i < size; ++i) {
+        count += needsEscape(data[i], isTomlKey);
+    }
+    return count;
+}
+
+static char* escapeScalar(const char* data, size_t size, char* out, bool isTomlKey) {
+    for (size_t i = 0; i < size; ++i) {
+        if (needsEscape(data[i], isTomlKey)) {
+            out = writeEscape(out, data[i], isTomlKey);
+        }
+        else {
+            *out++ = data[i];
+        }
+    }
+    return out;
+}
+
+#ifdef SIMD_X86
+// The bytes of a vector that need escapes. A byte is a control character
+// when it is its minimum with 0x1F. Outside of TOML keys, which escape
+// DEL, the last comparison looks for the quote again.
+SIMD_TARGET("sse4.1")
+static uint32_t escapeMaskSse(__m128i input, bool isTomlKey) {
+    __m128i isControl = _mm_cmpeq_epi8(_mm_min_epu8(input, _mm_set1_epi8(0x1F)), input);
+    __m128i isQuote = _mm_cmpeq_epi8(input, _mm_set1_epi8('"'));
+    __m128i isBackslash = _mm_cmpeq_epi8(input, _mm_set1_epi8('\\'));
+    __m128i isDelete = _mm_cmpeq_epi8(input, _mm_set1_epi8(isTomlKey ? 0x7F : '"'));
+    return static_cast<uint32_t>(_mm_movemask_epi8(_mm_or_si128(_mm_or_si128(isControl, isQuote), _mm_or_si128(isBackslash, isDelete))));
+}
+
+SIMD_TARGET("avx2")
+static uint32_t escapeMaskAvx2(__m256i input, bool isTomlKey) {
+    __m256i isControl = _mm256_cmpeq_epi8(_mm256_min_epu8(input, _mm256_set1_epi8(0x1F)), input);
+    __m256i isQuote = _mm256_cmpeq_epi8(input, _mm256_set1_epi8('"'));
+    __m256i isBackslash = _mm256_cmpeq_epi8(input, _mm256_set1_epi8('\\'));
+    __m256i isDelete = _mm256_cmpeq_epi8(input, _mm256_set1_epi8(isTomlKey ? 0x7F : '"'));
+    return static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_or_si256(_mm256_or_si256(isControl, isQuote), _mm256_or_si256(isBackslash, isDelete))));
+}
+
+SIMD_TARGET("sse4.1")
+static size_t countBytesToEscapeSse(const char* data, size_t size, bool isTomlKey) {
+    size_t count = 0;
+    size_t i = 0;
+    for (; i + 16 <= size; i += 16) {
+        count += std::popcount(escapeMaskSse(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i)), isTomlKey));
+    }
+    return count + countBytesToEscapeScalar(data + i, size - i, isTomlKey);
+}
+
+SIMD_TARGET("avx2")
+static size_t countBytesToEscapeAvx2(const char* data, size_t size, bool isTomlKey) {
+    size_t count = 0;
+    size_t i = 0;
+    for (; i + 32 <= size; i += 32) {
+        count += std::popcount(escapeMaskAvx2(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i)), isTomlKey));
+    }
+    return count + countBytesToEscapeSse(data + i, size - i, isTomlKey);
+}
+
+// Each vector is stored whole, and the output then moves on past the run
+// up to the first byte that needs an escape, if any. The output has room
+// for the vector as it has room for the rest of the input.
+SIMD_TARGET("sse4.1")
+static char* escapeSse(const char* data, size_t size, char* out, bool isTomlKey) {
+    size_t i = 0;
+    while (i + 16 <= size) {
+        __m128i input = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out), input);
+        uint32_t stops = escapeMaskSse(input, isTomlKey);
+        if (!stops) {
+            out += 16;
+            i += 16;
+            continue;
+        }
+        size_t run = std::countr_zero(stops);
+        out = writeEscape(out + run, data[i + run], isTomlKey);
+        i += run + 1;
+    }
+    return escapeScalar(data + i, size - i, out, isTomlKey);
+}
+
+SIMD_TARGET("avx2")
+static char* escapeAvx2(const char* data, size_t size, char* out, bool isTomlKey) {
+    size_t i = 0;
+    while (i + 32 <= size) {
+        __m256i input = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out), input);
+        uint32_t stops = escapeMaskAvx2(input, isTomlKey);
+        if (!stops) {
+            out += 32;
+            i += 32;
+            continue;
+        }
+        size_t run = std::countr_zero(stops);
+        out = writeEscape(out + run, data[i + run], isTomlKey);
+        i += run + 1;
+    }
+    return escapeSse(data + i, size - i, out, isTomlKey);
+}
+#endif
+
+using EscapeCounter = size_t (*)(const char* data, size_t size, bool isTomlKey);
+using Escaper = char* (*)(const char* data, size_t size, char* out, bool isTomlKey);
+
+static EscapeCounter selectEscapeCounter() {
+#ifdef SIMD_X86
+    if (GetCpuFeatures().hasAvx2) {
+        return countBytesToEscapeAvx2;
+    }
+    if (GetCpuFeatures().hasSse41) {
+        return countBytesToEscapeSse;
+    }
+#endif
+    return countBytesToEscapeScalar;
+}
+
+static Escaper selectEscaper() {
+#ifdef SIMD_X86
+    if (GetCpuFeatures().hasAvx2) {
+        return escapeAvx2;
+    }
+    if (GetCpuFeatures().hasSse41) {
+        return escapeSse;
+    }
+#endif
+    return escapeScalar;
+}
+
+// The output is sized once for the longest escape, six bytes for \u00XX,
+// of every byte that needs one, written through a pointer and cut back to
+// what was written.
+void AppendEscaped(std::string& out, std::string_view str, bool isTomlKey) {
+    static const EscapeCounter counter = selectEscapeCounter();
+    static const Escaper escaper = selectEscaper();
+    bool isShort = str.size() < 16;
+    size_t escapeCount = isShort ? countBytesToEscapeScalar(str.data(), str.size(), isTomlKey) : counter(str.data(), str.size(), isTomlKey);
+    if (!escapeCount) {
+        out.append(str);
+        return;
+    }
+    size_t start = out.size();
+    out.resize(start + str.size() + escapeCount * 5);
+    char* end = isShort ? escapeScalar(str.data(), str.size(), out.data() + start, isTomlKey) : escaper(str.data(), str.size(), out.data() + start, isTomlKey);
+    out.resize(end - out.data());
+}
+
+// The value of a hexadecimal digit, or -1 for any other character
+static int hexDigitValue(char ch) {
+    if (ch >= '0' && ch <= '9') {
+        return ch - '0';
+    }
+    if (ch >= 'a' && ch <= 'f') {
+        return ch - 'a' + 10;
+    }
+    if (ch >= 'A' && ch <= 'F') {
+        return ch - 'A' + 10;
+    }
+    return -1;
+}
+#endif
+
+#endif
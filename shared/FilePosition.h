@@ -3,6 +3,10 @@
 #ifndef FILE_POSITION_H
 #define FILE_POSITION_H
 
+#include <vector>
+#include <string_view>
+#include <algorithm>
+#include <cstdint>
 #include "IntLike.h"
 
 namespace FilePosition {
@@ -90,6 +94,84 @@ namespace FilePosition {
                 PositionHasher{}(value.end);
         }
     };
+
+    // A range of a source as byte offsets. It is the compact form of a
+    // region; the line index of the source turns it into one.
+    struct Span {
+        uint32_t start;
+        uint32_t end;
+
+        bool operator==(const Span& other) const {
+            return start == other.start && end == other.end;
+        }
+
+        bool contains(uint32_t offset) const {
+            return start <= offset && offset <= end;
+        }
+    };
+
+    // Offsets at which the lines of a source start. Lines and columns of
+    // an offset are found by binary search, which is skipped when the
+    // offset is on the line of the last lookup, so walking a source in
+    // order costs constant time per lookup.
+    class LineIndex {
+    public:
+        LineIndex() : lineStarts({ 0 }), sourceSize(0), lastLine(0) {}
+
+        explicit LineIndex(std::string_view source) : sourceSize(static_cast<uint32_t>(source.size())), lastLine(0) {
+            lineStarts.push_back(0);
+            for (size_t lineBreak = source.find('\n'); lineBreak != std::string_view::npos; lineBreak = source.find('\n', lineBreak + 1)) {
+                lineStarts.push_back(static_cast<uint32_t>(lineBreak + 1));
+            }
+        }
+
+        size_t GetLineCount() const {
+            return lineStarts.size();
+        }
+
+        size_t GetLine(uint32_t offset) const {
+            if (!isOnLine(offset, lastLine)) {
+                lastLine = std::upper_bound(lineStarts.begin(), lineStarts.end(), offset) - lineStarts.begin() - 1;
+            }
+            return lastLine;
+        }
+
+        Position GetPosition(uint32_t offset) const {
+            size_t line = GetLine(offset);
+            return { { line, false }, { offset - lineStarts[line], false } };
+        }
+
+        Region GetRegion(const Span& span) const {
+            return { GetPosition(span.start), GetPosition(span.end) };
+        }
+
+        // Get the offset of the position. Positions past the end of a line
+        // are moved to its end and positions past the last line to the end
+        // of the source.
+        uint32_t GetOffset(const Position& position) const {
+            if (position.line.isNegativeValue()) {
+                return 0;
+            }
+            size_t line = position.line.getValue();
+            if (line >= lineStarts.size()) {
+                return sourceSize;
+            }
+            uint32_t lineEnd = line + 1 < lineStarts.size() ? lineStarts[line + 1] - 1 : sourceSize;
+            if (position.column.isNegativeValue()) {
+                return lineStarts[line];
+            }
+            return static_cast<uint32_t>(std::min<size_t>(lineStarts[line] + position.column.getValue(), lineEnd));
+        }
+
+    protected:
+        bool isOnLine(uint32_t offset, size_t line) const {
+            return lineStarts[line] <= offset && (line + 1 == lineStarts.size() || offset < lineStarts[line + 1]);
+        }
+
+        std::vector<uint32_t> lineStarts;
+        uint32_t sourceSize;
+        mutable size_t lastLine;
+    };
 }
 
 #endif // FILE_POSITION_H
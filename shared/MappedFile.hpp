@@ -0,0 +1,118 @@
+#pragma once
+
+#ifndef MAPPEDFILE_H
+#define MAPPEDFILE_H
+
+#include <string>
+#include <string_view>
+#include <stdexcept>
+
+#ifdef _WIN32
+// Keep std::min and std::max usable in the files that include this
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#endif
+
+// Read-only view of a whole file mapped into memory. The lexers work on
+// the view directly, so the file content is never copied.
+class MappedFile {
+public:
+    explicit MappedFile(const std::string& path) {
+#ifdef _WIN32
+        fileHandle = CreateFileA(
+            path.c_str(),
+            GENERIC_READ,
+            FILE_SHARE_READ,
+            NULL,
+            OPEN_EXISTING,
+            FILE_ATTRIBUTE_NORMAL,
+            NULL
+        );
+        if (fileHandle == INVALID_HANDLE_VALUE) {
+            throw std::runtime_error("unable to open " + path);
+        }
+        LARGE_INTEGER fileSize;
+        if (!GetFileSizeEx(fileHandle, &fileSize)) {
+            CloseHandle(fileHandle);
+            throw std::runtime_error("unable to get the size of " + path);
+        }
+        size = static_cast<size_t>(fileSize.QuadPart);
+        if (size) {
+            mappingHandle = CreateFileMappingA(fileHandle, NULL, PAGE_READONLY, 0, 0, NULL);
+            if (!mappingHandle) {
+                CloseHandle(fileHandle);
+                throw std::runtime_error("unable to map " + path);
+            }
+            data = static_cast<const char*>(MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0));
+            if (!data) {
+                CloseHandle(mappingHandle);
+                CloseHandle(fileHandle);
+                throw std::runtime_error("unable to map " + path);
+            }
+        }
+#else
+        fileFd = open(path.c_str(), O_RDONLY);
+        if (fileFd == -1) {
+            throw std::runtime_error("unable to open " + path);
+        }
+        struct stat fileStat;
+        if (fstat(fileFd, &fileStat) == -1) {
+            close(fileFd);
+            throw std::runtime_error("unable to get the size of " + path);
+        }
+        size = static_cast<size_t>(fileStat.st_size);
+        if (size) {
+            void* mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fileFd, 0);
+            if (mapped == MAP_FAILED) {
+                close(fileFd);
+                throw std::runtime_error("unable to map " + path);
+            }
+            data = static_cast<const char*>(mapped);
+        }
+#endif
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    ~MappedFile() {
+#ifdef _WIN32
+        if (data) {
+            UnmapViewOfFile(data);
+        }
+        if (mappingHandle) {
+            CloseHandle(mappingHandle);
+        }
+        CloseHandle(fileHandle);
+#else
+        if (data) {
+            munmap(const_cast<char*>(data), size);
+        }
+        close(fileFd);
+#endif
+    }
+
+    std::string_view view() const {
+        return data ? std::string_view(data, size) : std::string_view();
+    }
+
+private:
+    const char* data = nullptr;
+    size_t size = 0;
+#ifdef _WIN32
+    HANDLE fileHandle = INVALID_HANDLE_VALUE;
+    HANDLE mappingHandle = NULL;
+#else
+    int fileFd = -1;
+#endif
+};
+
+#endif
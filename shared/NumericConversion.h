@@ -0,0 +1,138 @@
+#pragma once
+
+#ifndef NUMERIC_CONVERSION_H
+#define NUMERIC_CONVERSION_H
+
+#include <string>
+#include <string_view>
+#include <charconv>
+#include <cstdint>
+#include <cstdlib>
+#include <cerrno>
+#include <limits>
+#include <cmath>
+
+// Conversion of TOML number literals, without allocating for literals of
+// less than 128 characters. Underscores are skipped wherever they are, as
+// if they were removed from the literal first, and a leading + is dropped.
+//
+// ParseIntegerLiteral reads a decimal, or with a 0x, 0o or 0b prefix a
+// hexadecimal, octal or binary, integer literal with an optional sign.
+// It fails on anything else and when the magnitude does not fit in
+// uint64_t.
+//
+// ParseFloatLiteral reads a float literal as std::stod would, and fails
+// where std::stod would throw, except that it accepts subnormal values,
+// which std::stod takes for out of range. Where the standard library
+// has it, std::from_chars does the conversion, which in current
+// libraries is an Eisel-Lemire parser and does not depend on the locale.
+#ifndef DEF_GLOBAL
+extern bool ParseIntegerLiteral(std::string_view literal, uint64_t& magnitude, bool& isNegative);
+extern bool ParseFloatLiteral(std::string_view literal, double& number);
+#else
+bool ParseIntegerLiteral(std::string_view literal, uint64_t& magnitude, bool& isNegative) {
+    size_t size = literal.size();
+    auto skipUnderscores = [&literal, size](size_t index) {
+        while (index < size && literal[index] == '_') {
+            ++index;
+        }
+        return index;
+    };
+    size_t index = skipUnderscores(0);
+    if (index < size && literal[index] == '+') {
+        index = skipUnderscores(index + 1);
+    }
+    isNegative = index < size && literal[index] == '-';
+    if (isNegative) {
+        index = skipUnderscores(index + 1);
+    }
+    uint64_t base = 10;
+    if (index < size && literal[index] == '0') {
+        size_t prefixIndex = skipUnderscores(index + 1);
+        size_t digitsIndex = skipUnderscores(prefixIndex + 1);
+        if (digitsIndex < size) {
+            switch (literal[prefixIndex]) {
+            case 'x':
+                base = 16;
+                index = digitsIndex;
+                break;
+            case 'o':
+                base = 8;
+                index = digitsIndex;
+                break;
+            case 'b':
+                base = 2;
+                index = digitsIndex;
+                break;
+            default:
+                break;
+            }
+        }
+    }
+    if (index == size) {
+        return false;
+    }
+    const uint64_t maxQuotient = std::numeric_limits<uint64_t>::max() / base;
+    const uint64_t maxRemainder = std::numeric_limits<uint64_t>::max() % base;
+    uint64_t value = 0;
+    for (; index < size; ++index) {
+        char c = literal[index];
+        uint64_t digit;
+        if (c >= '0' && c <= '9') {
+            digit = c - '0';
+        }
+        else if (c >= 'a' && c <= 'f') {
+            digit = c - 'a' + 10;
+        }
+        else if (c >= 'A' && c <= 'F') {
+            digit = c - 'A' + 10;
+        }
+        else if (c == '_') {
+            continue;
+        }
+        else {
+            return false;
+        }
+        if (digit >= base || value > maxQuotient || (value == maxQuotient && digit > maxRemainder)) {
+            return false;
+        }
+        value = value * base + digit;
+    }
+    magnitude = value;
+    return true;
+}
+
+bool ParseFloatLiteral(std::string_view literal, double& number) {
+    // Literals are short; longer ones get a buffer of their own
+    char buffer[128];
+    std::string longBuffer;
+    char* digits = buffer;
+    if (literal.size() >= sizeof(buffer)) {
+        longBuffer.resize(literal.size() + 1);
+        digits = longBuffer.data();
+    }
+    size_t length = 0;
+    bool isSignDropped = false;
+    for (char c : literal) {
+        if (c == '_' || (c == '+' && !length && !isSignDropped)) {
+            isSignDropped = isSignDropped || c == '+';
+            continue;
+        }
+        digits[length++] = c;
+    }
+#if defined(__cpp_lib_to_chars) && __cpp_lib_to_chars >= 201611L
+    // std::from_chars takes no second +, which std::stod does
+    if (!length || digits[0] != '+') {
+        auto [end, error] = std::from_chars(digits, digits + length, number);
+        return end != digits && error == std::errc();
+    }
+#endif
+    digits[length] = '\0';
+    char* end;
+    errno = 0;
+    number = std::strtod(digits, &end);
+    return end != digits && (errno != ERANGE || (number != 0 && std::abs(number) < std::numeric_limits<double>::infinity()));
+}
+#endif
+
+#endif
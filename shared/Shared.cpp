@@ -1,11 +1,17 @@
 // Used for declaration of global variable and function
 #define DEF_GLOBAL
+#include "CpuFeatures.h"
 #include "TomlCheckFunctions.h"
+#include "TomlStructuralIndex.h"
 #include "Log.h"
-#include "TypeUtils.h"
 #include "Dump.h"
 #include "TomlStringUtils.h"
+#include "NumericConversion.h"
+#include "DateTimeConversion.h"
+#include "Utf8Validation.h"
 #include "DocTree2Json.h"
 #include "DocTree2Toml.h"
+#include "DocTree2Binary.h"
+#include "DocSnapshot.h"
 #include "CslCheckFunctions.h"
 #include "CslStringUtils.h"
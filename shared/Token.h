@@ -4,41 +4,89 @@
 #define TOKEN_H
 
 #include <string>
-#include <list>
+#include <string_view>
+#include <vector>
+#include <memory>
+#include <iterator>
+#include <functional>
+#include <algorithm>
 #include <stdexcept>
 #include <tuple>
+#include <cstdint>
+#include <cstddef>
 #include "Type.h"
-#include "TypeUtils.h"
 #include "FilePosition.h"
 
 namespace Token
 {
-    struct TokenPropertyDeallocator {
-        void operator()(Type::Type* type) {
-            Type::DeleteType(type);
-        }
+    enum class TokenKind : uint8_t {
+        Unknown,
+        Datetime,
+        Number,
+        Boolean,
+        Identifier,
+        Punctuator,
+        Operator,
+        Comment,
+        String,
+        Keyword,
+        Type,
     };
 
-    template <typename TokenPropertyType = Type::Type, typename TokenPropertyDeallocator = TokenPropertyDeallocator>
+    // Tokens are kept as parallel arrays of kinds, content ranges,
+    // properties and spans. The content of a token is a range of the
+    // source the list was made for, so lexing copies no text; content
+    // that is not part of the source, such as the unquoted name of a
+    // quoted identifier, is copied to a buffer of the list instead.
+    // Spans are the byte ranges of the tokens in the source, and their
+    // regions are worked out from the line index of the source.
+    // Properties are shared type instances and are not owned by the list.
+    template <typename TokenPropertyType = Type::Type>
     class TokenList {
     public:
-        // content, tokenType, contentType, startLine, startCol, endLine, endCol
-        using Token = std::tuple<std::string, std::string, TokenPropertyType*, FilePosition::Region>;
+        // content, tokenKind, contentType, region
+        using Token = std::tuple<std::string_view, TokenKind, TokenPropertyType*, FilePosition::Region>;
+
+        TokenList() : TokenList(std::string_view()) {}
+
+        explicit TokenList(std::string_view source) :
+            source(source), curTokenOffset(0), curTokenLength(0), curTokenKind(TokenKind::Unknown), curTokenProp(nullptr), tokenBuffered(false), curTokenSpan({ 0, 0 }) {
+            if (source.size() >= OwnedContentFlag) {
+                throw std::length_error("input is too large to be tokenized");
+            }
+            lineIndex = std::make_shared<const FilePosition::LineIndex>(source);
+        }
 
-        TokenList() : curTokenProp(nullptr), tokenBuffered(false), curTokenRegion({ 0, 0, 0, 0 }) {}
         virtual ~TokenList() {}
 
+        // Keep the buffer the list was made for alive as long as the
+        // list, for sources that are not owned by the caller.
+        void AdoptSource(std::shared_ptr<const std::string> sourceBuffer) {
+            sourceOwner = std::move(sourceBuffer);
+        }
+
         // Add the specified token to list.
         // Note that this operation will cause the current
         // buffered token (if available) to be flushed to
         // the list first and then the buffered content and
         // information to be cleared.
-        void AddTokenToList(std::string tokenContent, std::string tokenType,
-            TokenPropertyType* contentType = nullptr,
-            FilePosition::Region region = { 0,0,0,0 }) {
+        // The token spans the specified range of the source, which
+        // is where the content is unless the content is not a range
+        // of the source.
+        void AddTokenToList(std::string_view tokenContent, TokenKind tokenKind,
+            TokenPropertyType* contentType,
+            FilePosition::Span span) {
             FlushBuffer();
-            tokenList.push_back(std::make_tuple(tokenContent, tokenType,
-                contentType, region));
+            kinds.push_back(tokenKind);
+            offsets.push_back(locateContent(tokenContent));
+            lengths.push_back(static_cast<uint32_t>(tokenContent.size()));
+            props.push_back(contentType);
+            spans.push_back(span);
+        }
+
+        void AddTokenToList(std::string_view tokenContent, TokenKind tokenKind,
+            TokenPropertyType* contentType = nullptr) {
+            AddTokenToList(tokenContent, tokenKind, contentType, locateSpan(tokenContent));
         }
 
         // Set information for the current buffered token.
@@ -48,30 +96,22 @@ namespace Token
         // (curTokenProp is assigned to a new value before
         // the old one is used in the token list) to avoid
         // memory leakage.
-        void SetTokenInfo(std::string tokenType,
-            TokenPropertyType* contentType = nullptr,
-            FilePosition::Region region = { 0,0,0,0 }) {
-            curTokenType = tokenType;
-            curTokenRegion = region;
+        void SetTokenInfo(TokenKind tokenKind,
+            TokenPropertyType* contentType = nullptr) {
+            curTokenKind = tokenKind;
         }
 
-        void AppendBufferedToken(const char newContent) {
-            curTokenContent.append(1, newContent);
+        // Append a character of the source to the buffered token. The
+        // buffered content is a range of the source, so each character
+        // must directly follow the ones already buffered.
+        void AppendBufferedToken(std::string_view newContent) {
             if (!tokenBuffered) {
-                if (!tokenList.empty()) {
-                    curTokenRegion = std::get<3>(*std::prev(tokenList.end()));
-                }
-                else {
-                    curTokenRegion = { 0,0,0,0 };
-                }
-            }
-            if (newContent != '\n') {
-                ++curTokenRegion.end.column;
-            }
-            else {
-                ++curTokenRegion.end.line;
-                curTokenRegion.end.column = 0;
+                curTokenOffset = static_cast<uint32_t>(newContent.data() - source.data());
+                curTokenLength = 0;
+                curTokenSpan = { curTokenOffset, curTokenOffset };
             }
+            curTokenLength += static_cast<uint32_t>(newContent.size());
+            curTokenSpan.end += static_cast<uint32_t>(newContent.size());
             tokenBuffered = true;
         }
 
@@ -80,69 +120,283 @@ namespace Token
         }
 
         void FlushBuffer() {
-            if (!curTokenContent.empty()) {
-                tokenList.push_back(std::make_tuple(
-                    curTokenContent, curTokenType,
-                    curTokenProp, curTokenRegion));
-                curTokenContent = "";
-                curTokenType = "";
+            if (curTokenLength) {
+                kinds.push_back(curTokenKind);
+                offsets.push_back(curTokenOffset);
+                lengths.push_back(curTokenLength);
+                props.push_back(curTokenProp);
+                spans.push_back(curTokenSpan);
+                curTokenOffset = 0;
+                curTokenLength = 0;
+                curTokenKind = TokenKind::Unknown;
                 curTokenProp = nullptr;
-                curTokenRegion = { 0,0,0,0 };
+                curTokenSpan = { 0, 0 };
                 tokenBuffered = false;
             }
         }
 
-        std::list<Token>& GetTokenList() {
-            return tokenList;
+        std::string_view GetContent(size_t index) const {
+            uint32_t offset = offsets[index];
+            if (offset & OwnedContentFlag) {
+                return std::string_view(ownedContent).substr(offset & ~OwnedContentFlag, lengths[index]);
+            }
+            return source.substr(offset, lengths[index]);
+        }
+
+        TokenKind GetKind(size_t index) const {
+            return kinds[index];
+        }
+
+        TokenPropertyType* GetProp(size_t index) const {
+            return props[index];
+        }
+
+        const FilePosition::Span& GetSpan(size_t index) const {
+            return spans[index];
+        }
+
+        FilePosition::Region GetRegion(size_t index) const {
+            return lineIndex->GetRegion(spans[index]);
         }
 
-        // Iterator for the elements
-        using iterator = typename std::list<Token>::iterator;
+        Token GetToken(size_t index) const {
+            return Token(GetContent(index), kinds[index], props[index], GetRegion(index));
+        }
+
+        // The line index is shared by the copies of the list and can
+        // outlive it.
+        std::shared_ptr<const FilePosition::LineIndex> GetLineIndex() const {
+            return lineIndex;
+        }
+
+        void reserve(size_t tokenCount) {
+            kinds.reserve(tokenCount);
+            offsets.reserve(tokenCount);
+            lengths.reserve(tokenCount);
+            props.reserve(tokenCount);
+            spans.reserve(tokenCount);
+        }
 
-        iterator begin() {
-            return tokenList.begin();
+        size_t size() const {
+            return kinds.size();
         }
 
-        iterator end() {
-            return tokenList.end();
+        bool empty() const {
+            return kinds.empty();
         }
 
-        // Const iterator for the elements
-        using const_iterator = typename std::list<Token>::const_iterator;
+        // Iterator for the elements. Dereferencing it gives the token as
+        // a tuple of views into the list; tokens are only changed through
+        // the list itself, so the same iterator serves constant lists.
+        class iterator {
+        public:
+            using iterator_category = std::random_access_iterator_tag;
+            using value_type = Token;
+            using difference_type = std::ptrdiff_t;
+            using pointer = void;
+            using reference = Token;
+
+            iterator() : tokenList(nullptr), index(0) {}
+            iterator(const TokenList* tokenList, size_t index) : tokenList(tokenList), index(index) {}
+
+            Token operator*() const {
+                return tokenList->GetToken(index);
+            }
+
+            Token operator[](difference_type offset) const {
+                return tokenList->GetToken(index + offset);
+            }
+
+            iterator& operator++() {
+                ++index;
+                return *this;
+            }
+
+            iterator operator++(int) {
+                iterator old = *this;
+                ++index;
+                return old;
+            }
+
+            iterator& operator--() {
+                --index;
+                return *this;
+            }
+
+            iterator operator--(int) {
+                iterator old = *this;
+                --index;
+                return old;
+            }
+
+            iterator& operator+=(difference_type offset) {
+                index += offset;
+                return *this;
+            }
+
+            iterator& operator-=(difference_type offset) {
+                index -= offset;
+                return *this;
+            }
+
+            iterator operator+(difference_type offset) const {
+                return iterator(tokenList, index + offset);
+            }
+
+            iterator operator-(difference_type offset) const {
+                return iterator(tokenList, index - offset);
+            }
+
+            difference_type operator-(const iterator& other) const {
+                return static_cast<difference_type>(index) - static_cast<difference_type>(other.index);
+            }
+
+            bool operator==(const iterator& other) const {
+                return index == other.index;
+            }
+
+            bool operator!=(const iterator& other) const {
+                return index != other.index;
+            }
+
+            bool operator<(const iterator& other) const {
+                return index < other.index;
+            }
+
+            bool operator>(const iterator& other) const {
+                return index > other.index;
+            }
+
+            bool operator<=(const iterator& other) const {
+                return index <= other.index;
+            }
+
+            bool operator>=(const iterator& other) const {
+                return index >= other.index;
+            }
+
+            // The index of a token is its ID. Token IDs are dense and
+            // stay the same as long as no token is inserted or erased
+            // before the token.
+            size_t GetIndex() const {
+                return index;
+            }
+
+        private:
+            const TokenList* tokenList;
+            size_t index;
+        };
+
+        using const_iterator = iterator;
+
+        iterator begin() const {
+            return iterator(this, 0);
+        }
 
-        const_iterator begin() const {
-            return tokenList.begin();
+        iterator end() const {
+            return iterator(this, size());
         }
 
-        const_iterator end() const {
-            return tokenList.end();
+        // Get the first token whose span ends at or after the offset of
+        // the position. Tokens are in source order and do not overlap, so
+        // the tokens containing the position are among the ones from here
+        // on that start at or before it.
+        iterator FindToken(const FilePosition::Position& position) const {
+            uint32_t offset = lineIndex->GetOffset(position);
+            auto spanIter = std::partition_point(spans.begin(), spans.end(), [offset](const FilePosition::Span& span) {
+                return span.end < offset;
+            });
+            return iterator(this, spanIter - spans.begin());
         }
 
         void clear() {
             FlushBuffer();
-            for (auto& token : tokenList) {
-                TokenPropertyDeallocator()(std::get<2>(token));
-            }
-            tokenList.clear();
+            kinds.clear();
+            offsets.clear();
+            lengths.clear();
+            props.clear();
+            spans.clear();
+            ownedContent.clear();
         }
 
-        iterator insert(const_iterator pos, const Token& token) {
-            return tokenList.insert(pos, token);
+        iterator insert(const_iterator pos, std::string_view tokenContent, TokenKind tokenKind,
+            TokenPropertyType* contentType,
+            FilePosition::Span span) {
+            size_t index = pos.GetIndex();
+            kinds.insert(kinds.begin() + index, tokenKind);
+            offsets.insert(offsets.begin() + index, locateContent(tokenContent));
+            lengths.insert(lengths.begin() + index, static_cast<uint32_t>(tokenContent.size()));
+            props.insert(props.begin() + index, contentType);
+            spans.insert(spans.begin() + index, span);
+            return iterator(this, index);
+        }
+
+        iterator insert(const_iterator pos, std::string_view tokenContent, TokenKind tokenKind,
+            TokenPropertyType* contentType = nullptr) {
+            return insert(pos, tokenContent, tokenKind, contentType, locateSpan(tokenContent));
         }
 
         iterator erase(const_iterator pos) {
-            auto token = *pos;
-            TokenPropertyDeallocator()(std::get<2>(token));
-            return tokenList.erase(pos);
+            size_t index = pos.GetIndex();
+            kinds.erase(kinds.begin() + index);
+            offsets.erase(offsets.begin() + index);
+            lengths.erase(lengths.begin() + index);
+            props.erase(props.begin() + index);
+            spans.erase(spans.begin() + index);
+            return iterator(this, index);
+        }
+
+        void SetTokenKind(const_iterator pos, TokenKind tokenKind) {
+            kinds[pos.GetIndex()] = tokenKind;
         }
 
     protected:
-        std::string curTokenContent;
-        std::string curTokenType;
+        // Set on the offsets of content kept in ownedContent
+        static constexpr uint32_t OwnedContentFlag = uint32_t(1) << 31;
+
+        uint32_t locateContent(std::string_view content) {
+            auto isWithin = [&content](std::string_view buffer) {
+                std::less_equal<const char*> notAfter;
+                return !buffer.empty() && notAfter(buffer.data(), content.data()) && notAfter(content.data() + content.size(), buffer.data() + buffer.size());
+            };
+            if (isWithin(source)) {
+                return static_cast<uint32_t>(content.data() - source.data());
+            }
+            if (isWithin(ownedContent)) {
+                return static_cast<uint32_t>(content.data() - ownedContent.data()) | OwnedContentFlag;
+            }
+            if (ownedContent.size() + content.size() >= OwnedContentFlag) {
+                throw std::length_error("token content is too large to be stored");
+            }
+            uint32_t offset = static_cast<uint32_t>(ownedContent.size());
+            ownedContent.append(content);
+            return offset | OwnedContentFlag;
+        }
+
+        FilePosition::Span locateSpan(std::string_view content) const {
+            std::less_equal<const char*> notAfter;
+            if (source.empty() || !notAfter(source.data(), content.data()) || !notAfter(content.data() + content.size(), source.data() + source.size())) {
+                throw std::invalid_argument("token content is not a range of the source");
+            }
+            uint32_t start = static_cast<uint32_t>(content.data() - source.data());
+            return { start, start + static_cast<uint32_t>(content.size()) };
+        }
+
+        std::string_view source;
+        std::shared_ptr<const std::string> sourceOwner;
+        std::shared_ptr<const FilePosition::LineIndex> lineIndex;
+        std::string ownedContent;
+        uint32_t curTokenOffset;
+        uint32_t curTokenLength;
+        TokenKind curTokenKind;
         TokenPropertyType* curTokenProp;
-        FilePosition::Region curTokenRegion;
         bool tokenBuffered;
-        std::list<Token> tokenList;
+        FilePosition::Span curTokenSpan;
+        std::vector<TokenKind> kinds;
+        std::vector<uint32_t> offsets;
+        std::vector<uint32_t> lengths;
+        std::vector<TokenPropertyType*> props;
+        std::vector<FilePosition::Span> spans;
     };
 };
 
@@ -4,324 +4,513 @@
 #define TOML_CHECK_FUNCTIONS_H
 
 #include <tuple>
+#include <array>
 #include <string>
-#include <boost/regex.hpp>
+#include <string_view>
+#include <cctype>
+#include <algorithm>
 #include "Type.h"
-#include "TypeUtils.h"
+#include "DateTimeConversion.h"
 
 namespace TOML {
-#ifndef DEF_GLOBAL
-    extern std::tuple<size_t, std::string> CheckIdentifier(std::string strToCheck);
-#else
-    std::tuple<size_t, std::string> CheckIdentifier(std::string strToCheck) {
-        size_t identifierStartIndex;
-        std::string identifierContent;
-        boost::regex identifierRegex(R"(^(\s*)([-\w]+))");
-        boost::smatch match;
-        if (boost::regex_search(strToCheck, match, identifierRegex) && !match.prefix().length()) {
-            identifierStartIndex = match[1].length();
-            identifierContent = match[0].str().substr(identifierStartIndex);
-            if (identifierContent == "true" || identifierContent == "false") {
-                identifierStartIndex = 0;
-                identifierContent = "";
+    // Classes used to pick the token kinds worth trying from the first
+    // byte of a token.
+    enum class CharClass : unsigned char {
+        Other,
+        Whitespace,
+        CommentStart,
+        QuoteStart,
+        Digit,
+        Sign,
+        BooleanStart,
+        SpecialNumberStart,
+        KeyChar,
+        Punctuator,
+        Operator
+    };
+
+    inline constexpr std::array<CharClass, 256> CharClassTable = [] {
+        std::array<CharClass, 256> table{};
+        auto assign = [&table](std::string_view chars, CharClass charClass) {
+            for (char ch : chars) {
+                table[static_cast<unsigned char>(ch)] = charClass;
             }
-        }
-        return { identifierStartIndex, identifierContent };
+        };
+        assign("abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ_", CharClass::KeyChar);
+        assign("0123456789", CharClass::Digit);
+        assign("tf", CharClass::BooleanStart);
+        assign("in", CharClass::SpecialNumberStart);
+        assign("+-", CharClass::Sign);
+        assign(" \t\n\v\f\r", CharClass::Whitespace);
+        assign("#", CharClass::CommentStart);
+        assign("\"'", CharClass::QuoteStart);
+        assign("{}[],", CharClass::Punctuator);
+        assign(".=", CharClass::Operator);
+        return table;
+    }();
+
+    inline CharClass GetCharClass(char ch) {
+        return CharClassTable[static_cast<unsigned char>(ch)];
     }
-#endif
+
+    // The scanner below is a hand-written replacement for the regular
+    // expressions the lexer used to run on every token. Each Match*
+    // function looks at the input starting at pos (which must not be
+    // whitespace) and returns the length of the token found there, or 0
+    // if there is none. They accept exactly what the former patterns
+    // accepted, so the token list and the diagnostics stay the same.
 
 #ifndef DEF_GLOBAL
-    extern std::tuple<Type::Type*, size_t, std::string> CheckNumericLiteral(std::string strToCheck);
+    extern bool IsWhitespace(char ch);
+    extern size_t SkipWhitespace(std::string_view str, size_t pos);
 #else
-    std::tuple<Type::Type*, size_t, std::string> CheckNumericLiteral(std::string strToCheck) {
-        Type::Type* literalType = nullptr;
-        size_t literalStartIndex;
-        std::string literalContent;
-        boost::regex integerLiteralRegex(R"(^(\s*)([+-]?(0(?![xob])|[1-9]+(_?\d+)*|0x[\da-fA-F]+(_?[\da-fA-F]+)*|0o[0-7]+(_?[0-7]+)*|0b[01]+(_?[01]+)*)))");
-        boost::regex floatLiteralRegex(R"(^(\s*)([+-]?((0(?![xob])|[1-9]+(_?\d+)*)(\.((\d+_)*\d+))?([eE][-+]?\d+(_?\d+)*)?)))");
-        boost::regex specialNumLiteralRegex(R"(^(\s*)([+-]?(nan|inf)(?![-\w])))");
-        boost::smatch match;
-        if (boost::regex_search(strToCheck, match, specialNumLiteralRegex) && !match.prefix().length()) {
-            auto matchedStr = match[3].str();
-            literalType = new Type::SpecialNumber(matchedStr == "nan" ? Type::SpecialNumber::NaN : Type::SpecialNumber::Infinity);
-        }
-        else {
-            bool matched = false;
-            boost::smatch integerMatch;
-            boost::smatch floatMatch;
-            if (boost::regex_search(strToCheck, integerMatch, integerLiteralRegex) && !integerMatch.prefix().length()) {
-                matched = true;
+    // Same set of characters as \s in the classic locale.
+    bool IsWhitespace(char ch) {
+        return GetCharClass(ch) == CharClass::Whitespace;
+    }
+
+    size_t SkipWhitespace(std::string_view str, size_t pos) {
+        while (pos < str.size() && IsWhitespace(str[pos])) {
+            ++pos;
+        }
+        return pos;
+    }
+
+    static bool isDigitAt(std::string_view str, size_t pos) {
+        return pos < str.size() && str[pos] >= '0' && str[pos] <= '9';
+    }
+
+    static bool isHexDigitAt(std::string_view str, size_t pos) {
+        return pos < str.size() && std::isxdigit(static_cast<unsigned char>(str[pos]));
+    }
+
+    static bool isCharAt(std::string_view str, size_t pos, char ch) {
+        return pos < str.size() && str[pos] == ch;
+    }
+
+    // [-\w]
+    static bool isKeyCharAt(std::string_view str, size_t pos) {
+        if (pos >= str.size()) {
+            return false;
+        }
+        char ch = str[pos];
+        return (ch >= '0' && ch <= '9') || (ch >= 'a' && ch <= 'z') || (ch >= 'A' && ch <= 'Z') || ch == '_' || ch == '-';
+    }
+
+    static size_t countRepeated(std::string_view str, size_t pos, char ch) {
+        size_t count = 0;
+        while (pos + count < str.size() && str[pos + count] == ch) {
+            ++count;
+        }
+        return count;
+    }
+
+    // Digits accepted by isDigit, where single underscores may separate
+    // two digits: d(_?d)*. Returns the position after the last digit.
+    template <typename IsDigit>
+    static size_t scanGroupedDigits(std::string_view str, size_t pos, IsDigit isDigit) {
+        while (true) {
+            if (isDigit(str, pos)) {
+                ++pos;
             }
-            if (boost::regex_search(strToCheck, floatMatch, floatLiteralRegex) && !floatMatch.prefix().length()) {
-                matched = true;
+            else if (isCharAt(str, pos, '_') && isDigit(str, pos + 1)) {
+                pos += 2;
             }
-            if (matched) {
-                if (integerMatch[0].length() >= floatMatch[0].length()) {
-                    match = integerMatch;
-                    literalType = new Type::Integer();
-                }
-                else {
-                    match = floatMatch;
-                    literalType = new Type::Float();
-                }
+            else {
+                return pos;
             }
         }
-        if (literalType) {
-            literalStartIndex = match[1].length();
-            literalContent = match[0].str().substr(literalStartIndex);
-            auto [identifierStartIndex, identifierContent] = CheckIdentifier(strToCheck);
-            if (literalContent.length() < identifierContent.length()) {
-                literalStartIndex = 0;
-                literalContent = "";
-                Type::DeleteType(literalType);
-                literalType = nullptr;
-            }
+    }
+
+    // 0(?![xob])|[1-9]+(_?\d+)*
+    static size_t scanDecimalInteger(std::string_view str, size_t pos) {
+        if (isCharAt(str, pos, '0')) {
+            char next = pos + 1 < str.size() ? str[pos + 1] : '\0';
+            return next == 'x' || next == 'o' || next == 'b' ? pos : pos + 1;
+        }
+        if (pos < str.size() && str[pos] >= '1' && str[pos] <= '9') {
+            return scanGroupedDigits(str, pos + 1, isDigitAt);
         }
-        return { literalType, literalStartIndex, literalContent };
+        return pos;
     }
 #endif
 
 #ifndef DEF_GLOBAL
-    extern std::tuple<Type::Type*, size_t, std::string> CheckBooleanLiteral(std::string strToCheck);
+    extern size_t MatchIdentifier(std::string_view str, size_t pos);
+    extern std::tuple<size_t, std::string> CheckIdentifier(std::string_view strToCheck);
 #else
-    std::tuple<Type::Type*, size_t, std::string> CheckBooleanLiteral(std::string strToCheck) {
-        Type::Type* literalType = nullptr;
-        size_t literalStartIndex;
-        std::string literalContent;
-        boost::regex boolLiteralRegex(R"(^(\s*)((true|false)(?![-\w])))");
-        boost::smatch match;
-        if (boost::regex_search(strToCheck, match, boolLiteralRegex) && !match.prefix().length()) {
-            literalType = new Type::Boolean();
-            literalStartIndex = match[1].length();
-            literalContent = match[0].str().substr(literalStartIndex);
-        }
-        return { literalType, literalStartIndex, literalContent };
+    // [-\w]+, but never the bare words true or false.
+    size_t MatchIdentifier(std::string_view str, size_t pos) {
+        size_t end = pos;
+        while (isKeyCharAt(str, end)) {
+            ++end;
+        }
+        auto identifier = str.substr(pos, end - pos);
+        if (identifier == "true" || identifier == "false") {
+            return 0;
+        }
+        return end - pos;
+    }
+
+    std::tuple<size_t, std::string> CheckIdentifier(std::string_view strToCheck) {
+        size_t identifierStartIndex = SkipWhitespace(strToCheck, 0);
+        size_t identifierLength = MatchIdentifier(strToCheck, identifierStartIndex);
+        if (!identifierLength) {
+            return { 0, "" };
+        }
+        return { identifierStartIndex, std::string(strToCheck.substr(identifierStartIndex, identifierLength)) };
     }
 #endif
 
 #ifndef DEF_GLOBAL
-    extern std::tuple<Type::Type*, size_t, std::string> CheckDateTimeLiteral(std::string strToCheck);
+    extern std::tuple<Type::Type*, size_t> MatchNumericLiteral(std::string_view str, size_t pos);
+    extern std::tuple<Type::Type*, size_t, std::string> CheckNumericLiteral(const std::string& strToCheck);
 #else
-    bool isLeapYear(int year) {
-        return (year % 4 == 0 && year % 100 != 0) || (year % 400 == 0);
-    }
+    std::tuple<Type::Type*, size_t> MatchNumericLiteral(std::string_view str, size_t pos) {
+        size_t signLength = pos < str.size() && (str[pos] == '+' || str[pos] == '-') ? 1 : 0;
+        size_t bodyStart = pos + signLength;
 
-    bool isValidDatePart(const std::string& part, int min, int max) {
-        if (part.empty() || part.size() > 2 || !std::all_of(part.begin(), part.end(), ::isdigit)) {
-            return false;
+        // [+-]?(nan|inf)(?![-\w])
+        auto special = str.substr(bodyStart, 3);
+        if ((special == "nan" || special == "inf") && !isKeyCharAt(str, bodyStart + 3)) {
+            auto type = special == "nan" ? Type::SpecialNumber::NaN : Type::SpecialNumber::Infinity;
+            return { Type::SpecialNumber::instance(type), signLength + 3 };
         }
-        int value = std::stoi(part);
-        return value >= min && value <= max;
-    }
 
-    bool isValidDate(const std::string& dateStr) {
-        if (dateStr.length() != 10 || dateStr[4] != '-' || dateStr[7] != '-') {
-            return false;
+        // [+-]?(0(?![xob])|[1-9]+(_?\d+)*|0x[\da-fA-F]+(_?[\da-fA-F]+)*|0o[0-7]+(_?[0-7]+)*|0b[01]+(_?[01]+)*)
+        size_t integerEnd = scanDecimalInteger(str, bodyStart);
+        if (integerEnd == bodyStart && isCharAt(str, bodyStart, '0') && bodyStart + 2 < str.size()) {
+            auto isOctalDigitAt = [](std::string_view str, size_t pos) {
+                return pos < str.size() && str[pos] >= '0' && str[pos] <= '7';
+            };
+            auto isBinaryDigitAt = [](std::string_view str, size_t pos) {
+                return pos < str.size() && (str[pos] == '0' || str[pos] == '1');
+            };
+            size_t digitsStart = bodyStart + 2;
+            switch (str[bodyStart + 1]) {
+            case 'x':
+                if (isHexDigitAt(str, digitsStart)) {
+                    integerEnd = scanGroupedDigits(str, digitsStart, isHexDigitAt);
+                }
+                break;
+            case 'o':
+                if (isOctalDigitAt(str, digitsStart)) {
+                    integerEnd = scanGroupedDigits(str, digitsStart, isOctalDigitAt);
+                }
+                break;
+            case 'b':
+                if (isBinaryDigitAt(str, digitsStart)) {
+                    integerEnd = scanGroupedDigits(str, digitsStart, isBinaryDigitAt);
+                }
+                break;
+            }
         }
+        size_t integerLength = integerEnd == bodyStart ? 0 : integerEnd - pos;
 
-        std::string yearStr = dateStr.substr(0, 4);
-        std::string monthStr = dateStr.substr(5, 2);
-        std::string dayStr = dateStr.substr(8, 2);
-
-        // Check if all characters are digits
-        if (!std::all_of(yearStr.begin(), yearStr.end(), ::isdigit)) return false;
-
-        int year = std::stoi(yearStr);
-        int month = std::stoi(monthStr);
-        int day = std::stoi(dayStr);
-
-        if (year < 1 || month < 1 || month > 12) return false;
-
-        // Days in each month
-        int daysInMonth[] = { 31, isLeapYear(year) ? 29 : 28, 31, 30, 31, 30,
-                              31, 31, 30, 31, 30, 31 };
-
-        if (day < 1 || day > daysInMonth[month - 1]) return false;
+        // [+-]?((0(?![xob])|[1-9]+(_?\d+)*)(\.((\d+_)*\d+))?([eE][-+]?\d+(_?\d+)*)?)
+        size_t floatLength = 0;
+        size_t floatEnd = scanDecimalInteger(str, bodyStart);
+        if (floatEnd != bodyStart) {
+            if (isCharAt(str, floatEnd, '.') && isDigitAt(str, floatEnd + 1)) {
+                floatEnd = scanGroupedDigits(str, floatEnd + 1, isDigitAt);
+            }
+            if (isCharAt(str, floatEnd, 'e') || isCharAt(str, floatEnd, 'E')) {
+                size_t exponentStart = floatEnd + 1;
+                if (isCharAt(str, exponentStart, '+') || isCharAt(str, exponentStart, '-')) {
+                    ++exponentStart;
+                }
+                if (isDigitAt(str, exponentStart)) {
+                    floatEnd = scanGroupedDigits(str, exponentStart, isDigitAt);
+                }
+            }
+            floatLength = floatEnd - pos;
+        }
 
-        return true;
+        if (!integerLength && !floatLength) {
+            return { nullptr, 0 };
+        }
+        size_t literalLength = integerLength >= floatLength ? integerLength : floatLength;
+        // A literal that is only the prefix of a longer bare key is not a number.
+        size_t identifierLength = MatchIdentifier(str, pos);
+        if (literalLength < identifierLength) {
+            return { nullptr, 0 };
+        }
+        if (integerLength >= floatLength) {
+            return { Type::Integer::instance(), integerLength };
+        }
+        return { Type::Float::instance(), floatLength };
     }
 
-    std::tuple<Type::Type*, size_t, std::string> CheckDateTimeLiteral(std::string strToCheck) {
-        Type::Type* literalType = nullptr;
-        size_t literalStartIndex;
-        std::string literalContent;
-        boost::regex offsetDateTimeRegex(R"(^(\s*)((\d{4}-\d{2}-\d{2})[Tt ]([01]\d|2[0-3]):[0-5]\d:[0-5]\d(\.\d+)?([Zz]|[+-]([01]\d|2[0-3]):[0-5]\d)))");
-        boost::regex localDateTimeRegex(R"(^(\s*)((\d{4}-\d{2}-\d{2})[Tt ]([01]\d|2[0-3]):[0-5]\d:[0-5]\d(\.\d+)?))");
-        boost::regex localDateRegex(R"(^(\s*)(\d{4}-\d{2}-\d{2}))");
-        boost::regex localTimeRegex(R"(^(\s*)(([01]\d|2[0-3]):[0-5]\d:[0-5]\d(\.\d+)?))");
-        boost::smatch match;
-        if (boost::regex_search(strToCheck, match, offsetDateTimeRegex) && !match.prefix().length() && isValidDate(match[3].str())) {
-            literalType = new Type::DateTime(Type::DateTime::OffsetDateTime);
+    std::tuple<Type::Type*, size_t, std::string> CheckNumericLiteral(const std::string& strToCheck) {
+        size_t literalStartIndex = SkipWhitespace(strToCheck, 0);
+        auto [literalType, literalLength] = MatchNumericLiteral(strToCheck, literalStartIndex);
+        if (!literalType) {
+            return { nullptr, 0, "" };
         }
-        else if (boost::regex_search(strToCheck, match, localDateTimeRegex) && !match.prefix().length() && isValidDate(match[3].str())) {
-            literalType = new Type::DateTime(Type::DateTime::LocalDateTime);
+        return { literalType, literalStartIndex, strToCheck.substr(literalStartIndex, literalLength) };
+    }
+#endif
+
+#ifndef DEF_GLOBAL
+    extern size_t MatchBooleanLiteral(std::string_view str, size_t pos);
+    extern std::tuple<Type::Type*, size_t, std::string> CheckBooleanLiteral(const std::string& strToCheck);
+#else
+    // (true|false)(?![-\w])
+    size_t MatchBooleanLiteral(std::string_view str, size_t pos) {
+        for (std::string_view word : { std::string_view("true"), std::string_view("false") }) {
+            if (str.substr(pos, word.size()) == word && !isKeyCharAt(str, pos + word.size())) {
+                return word.size();
+            }
         }
-        else if (boost::regex_search(strToCheck, match, localDateRegex) && !match.prefix().length() && isValidDate(match[2].str())) {
-            literalType = new Type::DateTime(Type::DateTime::LocalDate);
+        return 0;
+    }
+
+    std::tuple<Type::Type*, size_t, std::string> CheckBooleanLiteral(const std::string& strToCheck) {
+        size_t literalStartIndex = SkipWhitespace(strToCheck, 0);
+        size_t literalLength = MatchBooleanLiteral(strToCheck, literalStartIndex);
+        if (!literalLength) {
+            return { nullptr, 0, "" };
         }
-        else if (boost::regex_search(strToCheck, match, localTimeRegex) && !match.prefix().length()) {
-            literalType = new Type::DateTime(Type::DateTime::LocalTime);
+        return { Type::Boolean::instance(), literalStartIndex, strToCheck.substr(literalStartIndex, literalLength) };
+    }
+#endif
+
+#ifndef DEF_GLOBAL
+    extern std::tuple<Type::Type*, size_t> MatchDateTimeLiteral(std::string_view str, size_t pos);
+    extern std::tuple<Type::Type*, size_t, std::string> CheckDateTimeLiteral(const std::string& strToCheck);
+#else
+    // The literal is decoded on the way and its value dropped, as tokens
+    // only keep their text; Value decodes it again when asked.
+    std::tuple<Type::Type*, size_t> MatchDateTimeLiteral(std::string_view str, size_t pos) {
+        DateTimeValue dateTime;
+        size_t literalLength = DecodeDateTimeLiteral(str, pos, dateTime);
+        if (!literalLength) {
+            return { nullptr, 0 };
         }
-        if (literalType) {
-            literalStartIndex = match[1].length();
-            literalContent = match[0].str().substr(literalStartIndex);
+        return { Type::DateTime::instance(dateTime.getKind()), literalLength };
+    }
+
+    std::tuple<Type::Type*, size_t, std::string> CheckDateTimeLiteral(const std::string& strToCheck) {
+        size_t literalStartIndex = SkipWhitespace(strToCheck, 0);
+        auto [literalType, literalLength] = MatchDateTimeLiteral(strToCheck, literalStartIndex);
+        if (!literalType) {
+            return { nullptr, 0, "" };
         }
-        return { literalType, literalStartIndex, literalContent };
+        return { literalType, literalStartIndex, strToCheck.substr(literalStartIndex, literalLength) };
     }
 #endif
 
 #ifndef DEF_GLOBAL
-    extern std::tuple<size_t, std::string> CheckPunctuator(std::string strToCheck);
+    extern size_t MatchPunctuator(std::string_view str, size_t pos);
+    extern std::tuple<size_t, std::string> CheckPunctuator(const std::string& strToCheck);
 #else
-    std::tuple<size_t, std::string> CheckPunctuator(std::string strToCheck) {
-        size_t punctuatorStartIndex;
-        std::string punctuatorContent;
-        boost::regex punctuatorRegex(R"(^(\s*)(\{|\}|\[|\]|,))");
-        boost::smatch match;
-        if (boost::regex_search(strToCheck, match, punctuatorRegex) && !match.prefix().length()) {
-            punctuatorStartIndex = match[1].length();
-            punctuatorContent = match[0].str().substr(punctuatorStartIndex);
-        }
-        return { punctuatorStartIndex, punctuatorContent };
+    size_t MatchPunctuator(std::string_view str, size_t pos) {
+        if (pos >= str.size()) {
+            return 0;
+        }
+        switch (str[pos]) {
+        case '{': case '}': case '[': case ']': case ',':
+            return 1;
+        default:
+            return 0;
+        }
+    }
+
+    std::tuple<size_t, std::string> CheckPunctuator(const std::string& strToCheck) {
+        size_t punctuatorStartIndex = SkipWhitespace(strToCheck, 0);
+        size_t punctuatorLength = MatchPunctuator(strToCheck, punctuatorStartIndex);
+        if (!punctuatorLength) {
+            return { 0, "" };
+        }
+        return { punctuatorStartIndex, strToCheck.substr(punctuatorStartIndex, punctuatorLength) };
     }
 #endif
 
 #ifndef DEF_GLOBAL
-    extern std::tuple<size_t, std::string> CheckOperator(std::string strToCheck);
+    extern size_t MatchOperator(std::string_view str, size_t pos);
+    extern std::tuple<size_t, std::string> CheckOperator(const std::string& strToCheck);
 #else
-    std::tuple<size_t, std::string> CheckOperator(std::string strToCheck) {
-        size_t operatorStartIndex;
-        std::string operatorContent;
-        boost::regex operatorRegex(R"(^(\s*)(\.|=))");
-        boost::smatch match;
-        if (boost::regex_search(strToCheck, match, operatorRegex) && !match.prefix().length()) {
-            operatorStartIndex = match[1].length();
-            operatorContent = match[0].str().substr(operatorStartIndex);
-        }
-        return { operatorStartIndex, operatorContent };
+    size_t MatchOperator(std::string_view str, size_t pos) {
+        return pos < str.size() && (str[pos] == '.' || str[pos] == '=') ? 1 : 0;
+    }
+
+    std::tuple<size_t, std::string> CheckOperator(const std::string& strToCheck) {
+        size_t operatorStartIndex = SkipWhitespace(strToCheck, 0);
+        size_t operatorLength = MatchOperator(strToCheck, operatorStartIndex);
+        if (!operatorLength) {
+            return { 0, "" };
+        }
+        return { operatorStartIndex, strToCheck.substr(operatorStartIndex, operatorLength) };
     }
 #endif
 
 #ifndef DEF_GLOBAL
-    extern std::tuple<size_t, std::string> CheckComment(std::string strToCheck);
+    extern size_t MatchComment(std::string_view str, size_t pos);
+    extern std::tuple<size_t, std::string> CheckComment(const std::string& strToCheck);
 #else
-    std::tuple<size_t, std::string> CheckComment(std::string strToCheck) {
-        size_t commentStartIndex;
-        std::string commentContent;
-        boost::regex commentRegex(R"(^(\s*)(#[^\n]*))");
-        boost::smatch match;
-        if (boost::regex_search(strToCheck, match, commentRegex) && !match.prefix().length()) {
-            commentStartIndex = match[1].length();
-            commentContent = match[0].str().substr(commentStartIndex);
-        }
-        return { commentStartIndex, commentContent };
+    // #[^\n]*, not including the \r of a CRLF line ending
+    size_t MatchComment(std::string_view str, size_t pos) {
+        if (!isCharAt(str, pos, '#')) {
+            return 0;
+        }
+        size_t end = str.find('\n', pos);
+        if (end == std::string_view::npos) {
+            return str.size() - pos;
+        }
+        if (str[end - 1] == '\r') {
+            --end;
+        }
+        return end - pos;
+    }
+
+    std::tuple<size_t, std::string> CheckComment(const std::string& strToCheck) {
+        size_t commentStartIndex = SkipWhitespace(strToCheck, 0);
+        size_t commentLength = MatchComment(strToCheck, commentStartIndex);
+        if (!commentLength) {
+            return { 0, "" };
+        }
+        return { commentStartIndex, strToCheck.substr(commentStartIndex, commentLength) };
     }
 #endif
 
 #ifndef DEF_GLOBAL
-    extern std::tuple<Type::Type*, size_t, std::string> CheckStringLiteral(std::string strToCheck);
+    extern std::tuple<Type::Type*, size_t> MatchStringLiteral(std::string_view str, size_t pos);
+    extern std::tuple<Type::Type*, size_t, std::string> CheckStringLiteral(const std::string& strToCheck);
 #else
-    std::tuple<Type::Type*, size_t, std::string> CheckStringLiteral(std::string strToCheck) {
-        Type::Type* literalType = nullptr;
-        size_t literalStartIndex;
-        std::string literalContent;
-        boost::regex basicStringLiteralRegex(R"(^(\s*)("([^"\\\n]|\\[btnfr"\\]|\\u[\da-fA-F]{4}|\\U[\da-fA-F]{8})*"))");
-        boost::regex multiLineBasicStringLiteralRegex(R"mlbslr(^(\s*)("""((("{0,2})(?!")([^"\\]|\\[btnfr"\\]|\\u[\da-fA-F]{4}|\\U[\da-fA-F]{8}|\\[ \f\r\t\v]*\n\s*|((?<![^\\]")"(?!"))|((?<![^\\]")("")(?!")))*(?<![^\\]")("{0,2}))|(((?<="{3})("{1,2})(?="{3}))?))"""))mlbslr");
-        boost::regex literalStringLiteralRegex(R"(^(\s*)('([^'\n])*'))");
-        boost::regex multiLineLiteralStringLiteralRegex(R"(^(\s*)('''((('{0,2})(?!')([^']|((?<!')'(?!'))|((?<!')('')(?!'))|('(?='{3}\s?))|)*(?<!')('{0,2}))|(((?<='{3})('{1,2})(?='{3}))?))'''))");
-        int matched = 0;
-        boost::smatch basicStringMatch;
-        boost::smatch multiLineBasicStringMatch;
-        boost::smatch literalStringMatch;
-        boost::smatch multiLineLiteralStringMatch;
-        boost::smatch& match = basicStringMatch;
-        if (boost::regex_search(strToCheck, basicStringMatch, basicStringLiteralRegex) && !basicStringMatch.prefix().length()) {
-            matched = 1;
-        }
-        if (boost::regex_search(strToCheck, literalStringMatch, literalStringLiteralRegex) && !literalStringMatch.prefix().length()) {
-            if (literalStringMatch[0].length() > match[0].length()) {
-                match = literalStringMatch;
-                matched = 3;
+    // "([^"\\\n]|\\[btnfr"\\]|\\u[\da-fA-F]{4}|\\U[\da-fA-F]{8})*"
+    static size_t matchBasicString(std::string_view str, size_t pos) {
+        size_t cur = pos + 1;
+        while (cur < str.size()) {
+            char ch = str[cur];
+            if (ch == '"') {
+                return cur + 1 - pos;
             }
-        }
-        if (boost::regex_search(strToCheck, multiLineBasicStringMatch, multiLineBasicStringLiteralRegex) && !multiLineBasicStringMatch.prefix().length()) {
-            if (multiLineBasicStringMatch[0].length() > match[0].length()) {
-                match = multiLineBasicStringMatch;
-                matched = 2;
+            if (ch == '\n') {
+                return 0;
+            }
+            if (ch != '\\') {
+                ++cur;
+                continue;
             }
+            size_t escapeLength = 0;
+            char escaped = cur + 1 < str.size() ? str[cur + 1] : '\0';
+            switch (escaped) {
+            case 'b': case 't': case 'n': case 'f': case 'r': case '"': case '\\':
+                escapeLength = 2;
+                break;
+            case 'u': case 'U': {
+                size_t hexCount = escaped == 'u' ? 4 : 8;
+                escapeLength = 2 + hexCount;
+                for (size_t i = cur + 2; i < cur + escapeLength; ++i) {
+                    if (!isHexDigitAt(str, i)) {
+                        return 0;
+                    }
+                }
+                break;
+            }
+            default:
+                return 0;
+            }
+            cur += escapeLength;
         }
-        else if (boost::regex_search(strToCheck, multiLineLiteralStringMatch, multiLineLiteralStringLiteralRegex) && !multiLineLiteralStringMatch.prefix().length()) {
-            if (multiLineLiteralStringMatch[0].length() > match[0].length()) {
-                match = multiLineLiteralStringMatch;
-                matched = 4;
+        return 0;
+    }
+
+    // '([^'\n])*'
+    static size_t matchLiteralString(std::string_view str, size_t pos) {
+        for (size_t cur = pos + 1; cur < str.size(); ++cur) {
+            if (str[cur] == '\'') {
+                return cur + 1 - pos;
+            }
+            if (str[cur] == '\n') {
+                return 0;
             }
         }
-        if (matched) {
-            switch (matched) {
-            case 1:
-                literalType = new Type::String(Type::String::Basic);
-                break;
-            case 2:
-                literalType = new Type::String(Type::String::MultiLineBasic);
+        return 0;
+    }
+
+    // Both multi-line forms end at the first run of three or more
+    // delimiters, which may carry up to two extra delimiters that belong
+    // to the content. A string that opens with three or more delimiters
+    // only ever spans the delimiter run itself. Escapes are only checked
+    // for basic strings, where an invalid one rejects the whole literal.
+    static size_t matchMultiLineString(std::string_view str, size_t pos, char delimiter) {
+        size_t cur = pos + 3;
+        size_t openingRun = countRepeated(str, cur, delimiter);
+        if (openingRun >= 3) {
+            return 3 + std::min<size_t>(openingRun, 5);
+        }
+        cur += openingRun;
+        while (cur < str.size()) {
+            char ch = str[cur];
+            if (ch == delimiter) {
+                size_t run = countRepeated(str, cur, delimiter);
+                if (run >= 3) {
+                    return cur + std::min<size_t>(run, 5) - pos;
+                }
+                cur += run;
+                continue;
+            }
+            if (ch != '\\' || delimiter == '\'') {
+                ++cur;
+                continue;
+            }
+            char escaped = cur + 1 < str.size() ? str[cur + 1] : '\0';
+            switch (escaped) {
+            case 'b': case 't': case 'n': case 'f': case 'r': case '"': case '\\':
+                cur += 2;
                 break;
-            case 3:
-                literalType = new Type::String(Type::String::Raw);
+            case 'u': case 'U': {
+                size_t hexCount = escaped == 'u' ? 4 : 8;
+                for (size_t i = cur + 2; i < cur + 2 + hexCount; ++i) {
+                    if (!isHexDigitAt(str, i)) {
+                        return 0;
+                    }
+                }
+                cur += 2 + hexCount;
                 break;
-            case 4:
-                literalType = new Type::String(Type::String::MultiLineRaw);
+            }
+            default: {
+                // Line ending backslash: \\[ \f\r\t\v]*\n\s*
+                size_t next = cur + 1;
+                while (next < str.size() && str[next] != '\n' && IsWhitespace(str[next])) {
+                    ++next;
+                }
+                if (!isCharAt(str, next, '\n')) {
+                    return 0;
+                }
+                cur = SkipWhitespace(str, next + 1);
                 break;
             }
-            literalStartIndex = match[1].length();
-            literalContent = match[0].str().substr(literalStartIndex);
+            }
         }
-        return { literalType, literalStartIndex, literalContent };
+        return 0;
     }
-#endif
 
-#ifndef DEF_GLOBAL
-    extern bool HasIncompleteString(const std::string& input);
-#else
-    std::string firstAppearedStringOrCommentStarter(const std::string& input) {
-        size_t posSingle = input.find("'''");
-        size_t posDouble = input.find("\"\"\"");
-        size_t posHash = input.find("#");
-
-        // Set to string::npos if not found
-        if (posSingle == std::string::npos) posSingle = input.length() + 1;
-        if (posDouble == std::string::npos) posDouble = input.length() + 1;
-        if (posHash == std::string::npos) posHash = input.length() + 1;
-
-        if (posSingle < posDouble && posSingle < posHash) {
-            return "'''";
+    std::tuple<Type::Type*, size_t> MatchStringLiteral(std::string_view str, size_t pos) {
+        if (pos >= str.size() || (str[pos] != '"' && str[pos] != '\'')) {
+            return { nullptr, 0 };
         }
-        else if (posDouble < posSingle && posDouble < posHash) {
-            return "\"\"\"";
+        char delimiter = str[pos];
+        bool isBasic = delimiter == '"';
+        size_t singleLineLength = isBasic ? matchBasicString(str, pos) : matchLiteralString(str, pos);
+        size_t multiLineLength = countRepeated(str, pos, delimiter) >= 3 ? matchMultiLineString(str, pos, delimiter) : 0;
+        if (multiLineLength > singleLineLength) {
+            return { Type::String::instance(isBasic ? Type::String::MultiLineBasic : Type::String::MultiLineRaw), multiLineLength };
         }
-        else if (posHash < posSingle && posHash < posDouble) {
-            return "#";
-        }
-        else {
-            return "";
+        if (singleLineLength) {
+            return { Type::String::instance(isBasic ? Type::String::Basic : Type::String::Raw), singleLineLength };
         }
+        return { nullptr, 0 };
     }
 
-    bool HasIncompleteString(const std::string& input) {
-        boost::regex commentRegex(R"((\s*)(#[^\n]*))");
-        boost::regex multiLineBasicStringLiteralRegex(R"mlbslr(("""((("{0,2})(?!")([^"\\]|\\[btnfr"\\]|\\u[\da-fA-F]{4}|\\U[\da-fA-F]{8}|\\[ \f\r\t\v]*\n\s*|((?<![^\\]")"(?!"))|((?<![^\\]")("")(?!")))*(?<![^\\]")("{0,2}))|(((?<="{3})("{1,2})(?="{3}))?))"""))mlbslr");
-        boost::regex multiLineLiteralStringLiteralRegex(R"(('''((('{0,2})(?!')([^']|((?<!')'(?!'))|((?<!')('')(?!'))|('(?='{3}\s?))|)*(?<!')('{0,2}))|(((?<='{3})('{1,2})(?='{3}))?))'''))");
-        boost::regex tripleQuoteStart(R"(("""|'''))");
-
-        bool commentAppearsFirst = firstAppearedStringOrCommentStarter(input) == "#";
-
-        auto cleanedInput = boost::regex_replace(boost::regex_replace(boost::regex_replace(input, commentAppearsFirst ? commentRegex : multiLineLiteralStringLiteralRegex, ""), multiLineBasicStringLiteralRegex, ""), commentAppearsFirst ? multiLineLiteralStringLiteralRegex : commentRegex, "");
-
-        // Check if the input starts with a triple quote but isn't a complete string
-        boost::smatch match;
-        if (boost::regex_search(cleanedInput, match, tripleQuoteStart)) {
-            return true;
+    std::tuple<Type::Type*, size_t, std::string> CheckStringLiteral(const std::string& strToCheck) {
+        size_t literalStartIndex = SkipWhitespace(strToCheck, 0);
+        auto [literalType, literalLength] = MatchStringLiteral(strToCheck, literalStartIndex);
+        if (!literalType) {
+            return { nullptr, 0, "" };
         }
-
-        return false;
+        return { literalType, literalStartIndex, strToCheck.substr(literalStartIndex, literalLength) };
     }
 #endif
 }
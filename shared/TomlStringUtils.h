@@ -4,194 +4,155 @@
 #define TOML_STRING_UTILS_H
 
 #include <string>
+#include <string_view>
+#include <algorithm>
 #include <cstdint>
 #include <stdexcept>
 #include <regex>
 #include <limits>
-
+#include <charconv>
+#include "NumericConversion.h"
+#include "EscapeScanning.h"
+
+// DecodeStringLiteral writes the content of a string literal of the
+// given Type::String::StringType to out, which needs room for as many
+// bytes as the literal has: decoding never makes content longer. It
+// returns the size of the content. Malformed escapes throw
+// std::invalid_argument.
 #ifndef DEF_GLOBAL
+extern size_t DecodeStringLiteral(std::string_view stringLiteral, int type, char* out);
 extern std::string extractStringLiteralContent(const std::string& stringLiteral, int type);
 #else
-// Helper function to append Unicode code point as UTF-8
-void appendUtf8(std::string& str, uint32_t codePoint) {
-    if (codePoint > 0x10FFFF || (codePoint >= 0xD800 && codePoint <= 0xDFFF)) {
-        throw std::invalid_argument("Invalid Unicode code point");
-    }
-
-    if (codePoint <= 0x7F) {
-        str += static_cast<char>(codePoint);
-    }
-    else if (codePoint <= 0x7FF) {
-        str += static_cast<char>(0xC0 | (codePoint >> 6));
-        str += static_cast<char>(0x80 | (codePoint & 0x3F));
-    }
-    else if (codePoint <= 0xFFFF) {
-        str += static_cast<char>(0xE0 | (codePoint >> 12));
-        str += static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F));
-        str += static_cast<char>(0x80 | (codePoint & 0x3F));
-    }
-    else {
-        str += static_cast<char>(0xF0 | (codePoint >> 18));
-        str += static_cast<char>(0x80 | ((codePoint >> 12) & 0x3F));
-        str += static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F));
-        str += static_cast<char>(0x80 | (codePoint & 0x3F));
-    }
+// Whitespace that may follow a line ending backslash on its line
+static bool isLineWhitespace(char ch) {
+    return ch == ' ' || ch == '\t' || ch == '\f' || ch == '\r' || ch == '\v';
 }
 
-std::string removeLineContinuations(const std::string& input) {
-    std::istringstream stream(input);
-    std::string result;
-    std::string currentLine;
-    bool continuing = false;
-    bool trailingNewLine = input.size() && input.back() == '\n';
-
-    std::string line;
-    while (std::getline(stream, line)) {
-        // Remove any carriage return if present (for Windows line endings)
-        if (!line.empty() && line.back() == '\r') {
-            line.pop_back();
-        }
-
-        size_t backslashCount = 0;
-
-        // Count trailing backslashes
-        for (size_t i = line.length(); i > 0 && (line[i - 1] == '\\' || std::string(" \t\f\r\n\v").find(line[i - 1]) != std::string::npos); --i) {
-            if (line[i - 1] == '\\') {
-                ++backslashCount;
-            }
+// Decode a basic string in one pass. Runs without escapes are copied as
+// they are; escapes, and for multi-line strings line ending backslashes
+// and the CR of CRLF line breaks, are handled as they are reached.
+static size_t unescapeBasicString(std::string_view content, bool isMultiLine, char* out) {
+    const char* in = content.data();
+    size_t size = content.size();
+    size_t i = 0;
+    char* end = out;
+    while (true) {
+        size_t run = CopyUntilEscape(in + i, size - i, end, isMultiLine);
+        i += run;
+        end += run;
+        if (i == size) {
+            return end - out;
         }
-
-        bool isContinuation = (backslashCount % 2 == 1);
-
-        if (continuing) {
-            // Strip leading whitespace from this line
-            size_t firstNonWs = line.find_first_not_of(" \t\f\r\v");
-            if (firstNonWs != std::string::npos) {
-                line = line.substr(firstNonWs);
-            }
-            else { // line was all whitespace
-                line.clear();
-                continue;
+        if (in[i] == '\r') {
+            // Line breaks are kept as LF
+            if (i + 1 < size && in[i + 1] != '\n') {
+                *end++ = '\r';
             }
+            ++i;
+            continue;
         }
-
-        if (isContinuation) {
-            // Remove one backslash from the end
-            line.erase(line.find_last_of('\\'), std::string::npos);
-            currentLine += line;
-            continuing = true;
-        }
-        else {
-            currentLine += line;
-            result += currentLine + (stream.peek() == -1 && !trailingNewLine ? "" : "\n");
-            currentLine.clear();
-            continuing = false;
+        if (i + 1 >= size) {
+            throw std::invalid_argument("Dangling backslash in string");
         }
-    }
-
-    // Add any leftover line (if input didn't end with newline)
-    if (!currentLine.empty()) {
-        result += currentLine;
-    }
-
-    return result;
-}
-
-// Process basic string escapes
-std::string unescapeBasicString(const std::string& content, bool isMultiLine) {
-    std::string processed = content;
-
-    // Handle line continuations for multi-line
-    if (isMultiLine) {
-        processed = removeLineContinuations(processed);
-    }
-
-    std::string result;
-    for (size_t i = 0; i < processed.size(); ++i) {
-        if (processed[i] == '\\') {
-            if (i + 1 >= processed.size()) {
-                throw std::invalid_argument("Dangling backslash in string");
+        char c = in[i + 1];
+        switch (c) {
+        case 'b':  *end++ = '\b'; break;
+        case 't':  *end++ = '\t'; break;
+        case 'n':  *end++ = '\n'; break;
+        case 'f':  *end++ = '\f'; break;
+        case 'r':  *end++ = '\r'; break;
+        case '"':  *end++ = '"';  break;
+        case '\\': *end++ = '\\'; break;
+        case 'u':
+        case 'U': {
+            size_t hexCount = c == 'u' ? 4 : 8;
+            const char* error = c == 'u' ? "Invalid \\u escape" : "Invalid \\U escape";
+            if (i + 1 + hexCount >= size) {
+                throw std::invalid_argument(error);
             }
-
-            char c = processed[++i];
-            switch (c) {
-            case 'b':  result += '\b'; break;
-            case 't':  result += '\t'; break;
-            case 'n':  result += '\n'; break;
-            case 'f':  result += '\f'; break;
-            case 'r':  result += '\r'; break;
-            case '"':   result += '"';  break;
-            case '\\':  result += '\\'; break;
-            case 'u': {
-                if (i + 4 >= processed.size()) {
-                    throw std::invalid_argument("Invalid \\u escape");
-                }
-                std::string hex = processed.substr(i + 1, 4);
-                i += 4;
-                uint32_t code = std::stoul(hex, nullptr, 16);
-                if (code > 0x10FFFF || (code >= 0xD800 && code <= 0xDFFF)) {
-                    throw std::invalid_argument("Invalid Unicode code point");
+            uint32_t code = 0;
+            for (size_t j = i + 2; j < i + 2 + hexCount; ++j) {
+                int digit = hexDigitValue(in[j]);
+                if (digit < 0) {
+                    throw std::invalid_argument(error);
                 }
-                appendUtf8(result, code);
-                break;
+                code = code << 4 | static_cast<uint32_t>(digit);
             }
-            case 'U': {
-                if (i + 8 >= processed.size()) {
-                    throw std::invalid_argument("Invalid \\U escape");
-                }
-                std::string hex = processed.substr(i + 1, 8);
-                i += 8;
-                uint32_t code = std::stoul(hex, nullptr, 16);
-                if (code > 0x10FFFF || (code >= 0xD800 && code <= 0xDFFF)) {
-                    throw std::invalid_argument("Invalid Unicode code point");
-                }
-                appendUtf8(result, code);
-                break;
+            if (code > 0x10FFFF || (code >= 0xD800 && code <= 0xDFFF)) {
+                throw std::invalid_argument("Invalid Unicode code point");
             }
-            default:
+            end += WriteUtf8(end, code);
+            i += hexCount;
+            break;
+        }
+        default: {
+            // A line ending backslash drops the line break and all the
+            // whitespace and line breaks after it
+            size_t next = i + 1;
+            while (isMultiLine && next < size && isLineWhitespace(in[next])) {
+                ++next;
+            }
+            if (!isMultiLine || next == size || in[next] != '\n') {
                 throw std::invalid_argument(std::string("Invalid escape sequence: \\") + c);
             }
+            while (next < size && (isLineWhitespace(in[next]) || in[next] == '\n')) {
+                ++next;
+            }
+            i = next;
+            continue;
         }
-        else {
-            result += processed[i];
         }
+        i += 2;
     }
-    return result;
 }
 
-// Process literal strings
-std::string processLiteralString(const std::string& content, bool isMultiLine) {
-    std::string result = content;
-    // Trim leading newline for multi-line
-    if (isMultiLine && !result.empty() && result[0] == '\n') {
-        result.erase(0, 1);
+// Literal strings are copied as they are, except for the CR of CRLF line
+// breaks in multi-line ones
+static size_t copyLiteralString(std::string_view content, bool isMultiLine, char* out) {
+    if (!isMultiLine) {
+        std::copy(content.begin(), content.end(), out);
+        return content.size();
+    }
+    char* end = out;
+    size_t i = 0;
+    while (i < content.size()) {
+        size_t lineEnd = content.find("\r\n", i);
+        if (lineEnd == std::string_view::npos) {
+            lineEnd = content.size();
+        }
+        end = std::copy(content.data() + i, content.data() + lineEnd, end);
+        i = lineEnd + 1;
     }
-    return result;
+    return end - out;
 }
 
-std::string extractStringLiteralContent(const std::string& stringLiteral, int type) {
-    switch (type) {
-    case 0: { // Basic string
-        std::string content = stringLiteral.substr(1, stringLiteral.length() - 2);
-        return unescapeBasicString(content, false);
+size_t DecodeStringLiteral(std::string_view stringLiteral, int type, char* out) {
+    if (type < 0 || type > 3) {
+        throw std::invalid_argument("Not a valid string type");
     }
-    case 1: { // Multi-line basic string
-        std::string content = stringLiteral.substr(3, stringLiteral.length() - 6);
-        if (!content.empty() && content[0] == '\n') content.erase(0, 1);
-        return unescapeBasicString(content, true);
+    bool isMultiLine = type == 1 || type == 3;
+    size_t delimiterLength = isMultiLine ? 3 : 1;
+    if (stringLiteral.size() < 2 * delimiterLength) {
+        throw std::invalid_argument("Not a valid string literal");
     }
-    case 2: { // Literal string
-        std::string content = stringLiteral.substr(1, stringLiteral.length() - 2);
-        return processLiteralString(content, false);
+    std::string_view content = stringLiteral.substr(delimiterLength, stringLiteral.size() - 2 * delimiterLength);
+    // Trim the newline immediately following the opening delimiter
+    if (isMultiLine && content.starts_with('\n')) {
+        content.remove_prefix(1);
     }
-    case 3: { // Multi-line literal string
-        std::string content = stringLiteral.substr(3, stringLiteral.length() - 6);
-        if (!content.empty() && content[0] == '\n') content.erase(0, 1);
-        return processLiteralString(content, true);
+    else if (isMultiLine && content.starts_with("\r\n")) {
+        content.remove_prefix(2);
     }
-    default:
-        throw std::invalid_argument("Not a valid string type");
+    if (type == 0 || type == 1) {
+        return unescapeBasicString(content, isMultiLine, out);
     }
+    return copyLiteralString(content, isMultiLine, out);
+}
+
+std::string extractStringLiteralContent(const std::string& stringLiteral, int type) {
+    std::string content(stringLiteral.size(), '\0');
+    content.resize(DecodeStringLiteral(stringLiteral, type, content.data()));
+    return content;
 }
 
 #endif
@@ -200,6 +161,14 @@ std::string extractStringLiteralContent(const std::string& stringLiteral, int ty
 extern std::string convertToDecimalString(std::string input);
 #else
 std::string convertToDecimalString(std::string input) {
+    uint64_t magnitude;
+    bool isNegative;
+    if (ParseIntegerLiteral(input, magnitude, isNegative)) {
+        char digits[21];
+        auto end = std::to_chars(digits, digits + sizeof(digits), magnitude).ptr;
+        return (isNegative && magnitude ? "-" : "") + std::string(digits, end);
+    }
+    // Not a well-formed literal; what std::stoull makes of it is kept
     if (input.empty()) {
         return "Empty string";
     }
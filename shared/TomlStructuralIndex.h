@@ -0,0 +1,213 @@
+#pragma once
+
+#ifndef TOML_STRUCTURAL_INDEX_H
+#define TOML_STRUCTURAL_INDEX_H
+
+#include <array>
+#include <bit>
+#include <vector>
+#include <string_view>
+#include <cstdint>
+#include <stdexcept>
+#include <limits>
+#include "CpuFeatures.h"
+#include "TomlCheckFunctions.h"
+
+namespace TOML {
+    // Offsets of the line breaks of a document that end its lines, in
+    // order. Line breaks inside multi-line strings are left out, so a line
+    // that opens a multi-line string runs up to the line closing it.
+    struct StructuralIndex {
+        std::vector<uint32_t> lineBreaks;
+        // Offset of the multi-line string still open at the end of the
+        // document, if any
+        size_t unclosedStringStart = std::string_view::npos;
+    };
+
+#ifndef DEF_GLOBAL
+    extern StructuralIndex BuildStructuralIndex(std::string_view input);
+#else
+    // Bytes the index pass stops at: line breaks and the bytes that open,
+    // close or escape inside strings and comments. Punctuators and
+    // operators are left to the lexer, which reads every line anyway.
+    inline constexpr std::array<bool, 256> SpecialByteTable = [] {
+        std::array<bool, 256> table{};
+        table['\n'] = true;
+        table['"'] = true;
+        table['\''] = true;
+        table['#'] = true;
+        table['\\'] = true;
+        return table;
+    }();
+
+    static void markSpecialBytesScalar(const unsigned char* data, size_t size, uint64_t* bits) {
+        for (size_t i = 0; i < size; ++i) {
+            if (SpecialByteTable[data[i]]) {
+                bits[i >> 6] |= uint64_t(1) << (i & 63);
+            }
+        }
+    }
+
+#ifdef SIMD_X86
+    // The special bytes are told apart with two nibble lookups. The high
+    // nibble table gives each group of bytes sharing a high nibble a bit,
+    // and the low nibble table sets the bits of the groups that contain a
+    // byte with that low nibble:
+    //   0x0_: \n   0x2_: " # '   0x5_: backslash
+#define STRUCTURAL_INDEX_HIGH_NIBBLE \
+    1, 0, 2, 0, 0, 4, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0
+#define STRUCTURAL_INDEX_LOW_NIBBLE \
+    0, 0, 2, 2, 0, 0, 0, 2, 0, 0, 1, 0, 4, 0, 0, 0
+
+    SIMD_TARGET("sse4.1")
+    static void markSpecialBytesSse(const unsigned char* data, size_t size, uint64_t* bits) {
+        const __m128i highNibbleTable = _mm_setr_epi8(STRUCTURAL_INDEX_HIGH_NIBBLE);
+        const __m128i lowNibbleTable = _mm_setr_epi8(STRUCTURAL_INDEX_LOW_NIBBLE);
+        const __m128i lowNibble = _mm_set1_epi8(0x0F);
+        const __m128i zero = _mm_setzero_si128();
+        size_t i = 0;
+        for (; i + 64 <= size; i += 64) {
+            uint64_t blockBits = 0;
+            for (size_t j = 0; j < 64; j += 16) {
+                __m128i input = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i + j));
+                __m128i high = _mm_shuffle_epi8(highNibbleTable, _mm_and_si128(_mm_srli_epi16(input, 4), lowNibble));
+                __m128i low = _mm_shuffle_epi8(lowNibbleTable, _mm_and_si128(input, lowNibble));
+                uint32_t isOther = static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_and_si128(high, low), zero)));
+                blockBits |= uint64_t(~isOther & 0xFFFF) << j;
+            }
+            bits[i >> 6] = blockBits;
+        }
+        markSpecialBytesScalar(data + i, size - i, bits + (i >> 6));
+    }
+
+    SIMD_TARGET("avx2")
+    static void markSpecialBytesAvx2(const unsigned char* data, size_t size, uint64_t* bits) {
+        const __m256i highNibbleTable = _mm256_setr_epi8(STRUCTURAL_INDEX_HIGH_NIBBLE, STRUCTURAL_INDEX_HIGH_NIBBLE);
+        const __m256i lowNibbleTable = _mm256_setr_epi8(STRUCTURAL_INDEX_LOW_NIBBLE, STRUCTURAL_INDEX_LOW_NIBBLE);
+        const __m256i lowNibble = _mm256_set1_epi8(0x0F);
+        const __m256i zero = _mm256_setzero_si256();
+        size_t i = 0;
+        for (; i + 64 <= size; i += 64) {
+            uint64_t blockBits = 0;
+            for (size_t j = 0; j < 64; j += 32) {
+                __m256i input = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i + j));
+                __m256i high = _mm256_shuffle_epi8(highNibbleTable, _mm256_and_si256(_mm256_srli_epi16(input, 4), lowNibble));
+                __m256i low = _mm256_shuffle_epi8(lowNibbleTable, _mm256_and_si256(input, lowNibble));
+                uint32_t isOther = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_and_si256(high, low), zero)));
+                blockBits |= uint64_t(~isOther) << j;
+            }
+            bits[i >> 6] = blockBits;
+        }
+        markSpecialBytesScalar(data + i, size - i, bits + (i >> 6));
+    }
+#endif
+
+    static void markSpecialBytes(const unsigned char* data, size_t size, uint64_t* bits) {
+#ifdef SIMD_X86
+        if (GetCpuFeatures().hasAvx2) {
+            markSpecialBytesAvx2(data, size, bits);
+            return;
+        }
+        if (GetCpuFeatures().hasSse41) {
+            markSpecialBytesSse(data, size, bits);
+            return;
+        }
+#endif
+        markSpecialBytesScalar(data, size, bits);
+    }
+
+    // The first pass marks every special byte in a bitmap with SIMD. The
+    // second walks only the marked bytes, tracking strings and comments
+    // the way the lexer reads them, and lists the line breaks outside of
+    // strings.
+    StructuralIndex BuildStructuralIndex(std::string_view input) {
+        if (input.size() > std::numeric_limits<uint32_t>::max()) {
+            throw std::length_error("input is too large to be indexed");
+        }
+        StructuralIndex structuralIndex;
+        std::vector<uint64_t> specialBytes((input.size() + 63) / 64);
+        markSpecialBytes(reinterpret_cast<const unsigned char*>(input.data()), input.size(), specialBytes.data());
+        auto nextSpecialByte = [&](size_t from) {
+            size_t word = from >> 6;
+            if (word >= specialBytes.size()) {
+                return input.size();
+            }
+            uint64_t bits = specialBytes[word] & (~uint64_t(0) << (from & 63));
+            while (!bits) {
+                if (++word == specialBytes.size()) {
+                    return input.size();
+                }
+                bits = specialBytes[word];
+            }
+            return (word << 6) + std::countr_zero(bits);
+        };
+        char openDelimiter = '\0';
+        size_t pos = 0;
+        while ((pos = nextSpecialByte(pos)) < input.size()) {
+            char ch = input[pos];
+            if (openDelimiter) {
+                // Multi-line strings end at the first run of three or more
+                // delimiters, which may carry two extra ones
+                if (ch == openDelimiter) {
+                    size_t run = countRepeated(input, pos, ch);
+                    if (run >= 3) {
+                        openDelimiter = '\0';
+                        pos += std::min<size_t>(run, 5);
+                    }
+                    else {
+                        pos += run;
+                    }
+                }
+                else if (ch == '\\' && openDelimiter == '"') {
+                    pos += 2;
+                }
+                else {
+                    ++pos;
+                }
+                continue;
+            }
+            if (ch == '\\') {
+                ++pos;
+                continue;
+            }
+            if (ch == '\n') {
+                structuralIndex.lineBreaks.push_back(static_cast<uint32_t>(pos));
+                ++pos;
+                continue;
+            }
+            if (ch == '#') {
+                pos = input.find('\n', pos);
+                if (pos == std::string_view::npos) {
+                    break;
+                }
+                continue;
+            }
+            size_t run = countRepeated(input, pos, ch);
+            if (run >= 6) {
+                // Empty multi-line string, which may carry two more delimiters
+                pos += std::min<size_t>(run, 8);
+            }
+            else if (run >= 3) {
+                openDelimiter = ch;
+                structuralIndex.unclosedStringStart = pos;
+                pos += 3;
+            }
+            else if (run == 2) {
+                pos += 2;
+            }
+            else {
+                // The lexer takes a quote that does not start a valid
+                // single-line string as an unknown token and goes on after it
+                size_t length = ch == '"' ? matchBasicString(input, pos) : matchLiteralString(input, pos);
+                pos += length ? length : 1;
+            }
+        }
+        if (!openDelimiter) {
+            structuralIndex.unclosedStringStart = std::string_view::npos;
+        }
+        return structuralIndex;
+    }
+#endif
+}
+
+#endif
@@ -10,78 +10,138 @@
 
 namespace Type
 {
+    // Types carry nothing but their class and subtype, so there is a single
+    // immutable instance of each, obtained with instance(). Tokens and
+    // values share these instances and never own or free them.
     class Type {
     public:
-        Type() {}
+        enum class Kind {
+            Invalid,
+            Boolean,
+            Integer,
+            Float,
+            SpecialNumber,
+            String,
+            DateTime
+        };
+
+        Type(Kind kind) : kind(kind) {}
         virtual ~Type() {}
+
+        Kind getKind() const { return kind; }
+
+    private:
+        Kind kind;
     };
 
     class Invalid : public Type {
     public:
-        Invalid() {}
+        static constexpr Kind TypeKind = Kind::Invalid;
+
+        static Invalid* instance() {
+            static Invalid invalid;
+            return &invalid;
+        }
+
         virtual ~Invalid() {}
+
+    protected:
+        Invalid() : Type(TypeKind) {}
     };
 
     class Valid : public Type {
     public:
-        Valid() {}
+        Valid(Kind kind) : Type(kind) {}
         virtual ~Valid() {}
     };
 
     class BuiltIn : public Valid {
     public:
-        BuiltIn() {}
+        BuiltIn(Kind kind) : Valid(kind) {}
         virtual ~BuiltIn() {}
     };
 
     class Boolean : public BuiltIn {
     public:
-        Boolean() {}
+        static constexpr Kind TypeKind = Kind::Boolean;
+
+        static Boolean* instance() {
+            static Boolean boolean;
+            return &boolean;
+        }
+
         virtual ~Boolean() {}
+
+    protected:
+        Boolean() : BuiltIn(TypeKind) {}
     };
 
     class Numeric : public BuiltIn {
     public:
-        Numeric() {}
+        Numeric(Kind kind) : BuiltIn(kind) {}
         virtual ~Numeric() {}
     };
 
     class Integer : public Numeric {
     public:
-        Integer() {}
+        static constexpr Kind TypeKind = Kind::Integer;
+
+        static Integer* instance() {
+            static Integer integer;
+            return &integer;
+        }
+
         virtual ~Integer() {}
+
+    protected:
+        Integer() : Numeric(TypeKind) {}
     };
 
     class Float : public Numeric {
     public:
-        Float() {}
+        static constexpr Kind TypeKind = Kind::Float;
+
+        static Float* instance() {
+            static Float floatType;
+            return &floatType;
+        }
+
         virtual ~Float() {}
+
+    protected:
+        Float() : Numeric(TypeKind) {}
     };
 
     class SpecialNumber : public Numeric {
     public:
+        static constexpr Kind TypeKind = Kind::SpecialNumber;
+
         enum SpecialNumberType {
             NaN,
             Infinity
         };
 
-        SpecialNumber(SpecialNumberType type) : type(type) {}
+        static SpecialNumber* instance(SpecialNumberType type) {
+            static SpecialNumber specialNumbers[] = { NaN, Infinity };
+            return &specialNumbers[type];
+        }
+
         virtual ~SpecialNumber() {}
 
         SpecialNumberType getType() const {
             return type;
         }
 
-        void setType(SpecialNumberType type) {
-            this->type = type;
-        }
-
     protected:
-        SpecialNumberType type;
+        SpecialNumber(SpecialNumberType type) : Numeric(TypeKind), type(type) {}
+
+        const SpecialNumberType type;
     };
 
     class String : public BuiltIn {
     public:
+        static constexpr Kind TypeKind = Kind::String;
+
         enum StringType {
             Basic,
             MultiLineBasic,
@@ -89,23 +149,27 @@ namespace Type
             MultiLineRaw
         };
 
-        String(StringType type) : type(type) {}
+        static String* instance(StringType type) {
+            static String strings[] = { Basic, MultiLineBasic, Raw, MultiLineRaw };
+            return &strings[type];
+        }
+
         virtual ~String() {}
 
         StringType getType() const {
             return type;
         }
 
-        void setType(StringType type) {
-            this->type = type;
-        }
-
     protected:
-        StringType type;
+        String(StringType type) : BuiltIn(TypeKind), type(type) {}
+
+        const StringType type;
     };
 
     class DateTime : public BuiltIn {
     public:
+        static constexpr Kind TypeKind = Kind::DateTime;
+
         enum DateTimeType {
             OffsetDateTime,
             LocalDateTime,
@@ -113,20 +177,34 @@ namespace Type
             LocalTime
         };
 
-        DateTime(DateTimeType type) : type(type) {}
+        static DateTime* instance(DateTimeType type) {
+            static DateTime dateTimes[] = { OffsetDateTime, LocalDateTime, LocalDate, LocalTime };
+            return &dateTimes[type];
+        }
+
         virtual ~DateTime() {}
 
         DateTimeType getType() const {
             return type;
         }
 
-        void setType(DateTimeType type) {
-            this->type = type;
-        }
-
     protected:
-        DateTimeType type;
+        DateTime(DateTimeType type) : BuiltIn(TypeKind), type(type) {}
+
+        const DateTimeType type;
     };
+
+    // Returns type as a TypeClass if it is one, and null otherwise, by
+    // checking the kind tag
+    template <typename TypeClass>
+    TypeClass* typeCast(Type* type) {
+        return type && type->getKind() == TypeClass::TypeKind ? static_cast<TypeClass*>(type) : nullptr;
+    }
+
+    template <typename TypeClass>
+    const TypeClass* typeCast(const Type* type) {
+        return type && type->getKind() == TypeClass::TypeKind ? static_cast<const TypeClass*>(type) : nullptr;
+    }
 };
 
 #endif
@@ -11,6 +11,10 @@
 #include <streambuf>
 
 #ifdef _WIN32
+// Keep std::min and std::max usable in the files that include this
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
 #include <windows.h>
 #else
 #include <fcntl.h>
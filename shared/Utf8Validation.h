@@ -0,0 +1,333 @@
+#pragma once
+
+#ifndef UTF8_VALIDATION_H
+#define UTF8_VALIDATION_H
+
+#include <bit>
+#include <string_view>
+#include <cstdint>
+#include <cstring>
+#include "CpuFeatures.h"
+
+// Checks that the content of a string or comment is well-formed UTF-8
+// and free of the control characters TOML forbids in it. Tab is always
+// allowed; multi-line content may also contain LF, and CR when directly
+// followed by LF.
+#ifndef DEF_GLOBAL
+extern bool IsUtf8ContentValid(std::string_view content, bool isMultiLine);
+#else
+static bool isUtf8ContentValidScalar(const unsigned char* data, size_t size, bool isMultiLine) {
+    size_t i = 0;
+    while (i < size) {
+        uint32_t codepoint = 0;
+        unsigned char c = data[i];
+
+        size_t bytes = 0;
+        if ((c & 0x80) == 0) {
+            // 1-byte ASCII
+            codepoint = c;
+            bytes = 1;
+        }
+        else if ((c & 0xE0) == 0xC0) {
+            // 2-byte
+            if (i + 1 >= size) return false;
+            unsigned char c1 = data[i + 1];
+            if ((c1 & 0xC0) != 0x80) return false;
+
+            codepoint = ((c & 0x1F) << 6) | (c1 & 0x3F);
+            if (codepoint < 0x80) return false;  // Overlong
+            bytes = 2;
+        }
+        else if ((c & 0xF0) == 0xE0) {
+            // 3-byte
+            if (i + 2 >= size) return false;
+            unsigned char c1 = data[i + 1];
+            unsigned char c2 = data[i + 2];
+            if ((c1 & 0xC0) != 0x80 || (c2 & 0xC0) != 0x80) return false;
+
+            codepoint = ((c & 0x0F) << 12) |
+                ((c1 & 0x3F) << 6) |
+                (c2 & 0x3F);
+            if (codepoint < 0x800) return false;        // Overlong
+            if (codepoint >= 0xD800 && codepoint <= 0xDFFF) return false;  // Surrogates
+            bytes = 3;
+        }
+        else if ((c & 0xF8) == 0xF0) {
+            // 4-byte
+            if (i + 3 >= size) return false;
+            unsigned char c1 = data[i + 1];
+            unsigned char c2 = data[i + 2];
+            unsigned char c3 = data[i + 3];
+            if ((c1 & 0xC0) != 0x80 ||
+                (c2 & 0xC0) != 0x80 ||
+                (c3 & 0xC0) != 0x80) return false;
+
+            codepoint = ((c & 0x07) << 18) |
+                ((c1 & 0x3F) << 12) |
+                ((c2 & 0x3F) << 6) |
+                (c3 & 0x3F);
+            if (codepoint < 0x10000 || codepoint > 0x10FFFF) return false;  // Overlong or out of range
+            bytes = 4;
+        }
+        else {
+            // Invalid leading byte
+            return false;
+        }
+
+        if (!isMultiLine &&
+            (codepoint >= 0x0000 && codepoint <= 0x0008 ||
+                codepoint >= 0x000A && codepoint <= 0x001F ||
+                codepoint == 0x007F)) {
+            return false;
+        }
+
+        if (isMultiLine) {
+            if (codepoint >= 0x0000 && codepoint <= 0x0008 ||
+                codepoint == 0x000B || codepoint == 0x000C ||
+                codepoint >= 0x000E && codepoint <= 0x001F ||
+                codepoint == 0x007F) {
+                return false;
+            }
+            else if (codepoint == 0x000D &&
+                (i + 1 >= size || data[i + 1] != 0x000A)) {
+                return false;
+            }
+        }
+
+        i += bytes;
+    }
+
+    return true;
+}
+
+#ifdef SIMD_X86
+// The vector kernels classify every byte together with the one before it
+// through three 16-entry nibble lookups (the "lookup4" scheme used by
+// simdjson). Each error kind owns a bit, and a byte pair is invalid when
+// a bit survives the AND of the three lookups. A second check makes sure
+// the bytes two and three positions after 3- and 4-byte leads are
+// continuations. Blocks without any non-ASCII byte skip all of this.
+namespace Utf8Validation {
+    constexpr char TooShort = 1 << 0;   // 11______ 0_______, 11______ 11______
+    constexpr char TooLong = 1 << 1;    // 0_______ 10______
+    constexpr char Overlong3 = 1 << 2;  // 11100000 100_____
+    constexpr char TooLarge = 1 << 3;   // 11110100 1001____, 11110100 101_____, 11110101+ 10______
+    constexpr char Surrogate = 1 << 4;  // 11101101 101_____
+    constexpr char Overlong2 = 1 << 5;  // 1100000_ 10______
+    constexpr char TooLarge1000 = 1 << 6; // 11110101+ 1000____
+    constexpr char Overlong4 = 1 << 6;  // 11110000 1000____
+    constexpr char TwoConts = (char)(1 << 7); // 10______ 10______
+    constexpr char Carry = TooShort | TooLong | TwoConts;
+
+#define UTF8_VALIDATION_BYTE_1_HIGH \
+    TooLong, TooLong, TooLong, TooLong, \
+    TooLong, TooLong, TooLong, TooLong, \
+    TwoConts, TwoConts, TwoConts, TwoConts, \
+    TooShort | Overlong2, \
+    TooShort, \
+    TooShort | Overlong3 | Surrogate, \
+    TooShort | TooLarge | TooLarge1000 | Overlong4
+#define UTF8_VALIDATION_BYTE_1_LOW \
+    Carry | Overlong3 | Overlong2 | Overlong4, \
+    Carry | Overlong2, \
+    Carry, \
+    Carry, \
+    Carry | TooLarge, \
+    Carry | TooLarge | TooLarge1000, \
+    Carry | TooLarge | TooLarge1000, \
+    Carry | TooLarge | TooLarge1000, \
+    Carry | TooLarge | TooLarge1000, \
+    Carry | TooLarge | TooLarge1000, \
+    Carry | TooLarge | TooLarge1000, \
+    Carry | TooLarge | TooLarge1000, \
+    Carry | TooLarge | TooLarge1000, \
+    Carry | TooLarge | TooLarge1000 | Surrogate, \
+    Carry | TooLarge | TooLarge1000, \
+    Carry | TooLarge | TooLarge1000
+#define UTF8_VALIDATION_BYTE_2_HIGH \
+    TooShort, TooShort, TooShort, TooShort, \
+    TooShort, TooShort, TooShort, TooShort, \
+    TooLong | Overlong2 | TwoConts | Overlong3 | TooLarge1000 | Overlong4, \
+    TooLong | Overlong2 | TwoConts | Overlong3 | TooLarge, \
+    TooLong | Overlong2 | TwoConts | Surrogate | TooLarge, \
+    TooLong | Overlong2 | TwoConts | Surrogate | TooLarge, \
+    TooShort, TooShort, TooShort, TooShort
+}
+
+SIMD_TARGET("sse4.1")
+static bool isUtf8ContentValidSse(const unsigned char* data, size_t size, bool isMultiLine) {
+    using namespace Utf8Validation;
+    const __m128i byte1HighTable = _mm_setr_epi8(UTF8_VALIDATION_BYTE_1_HIGH);
+    const __m128i byte1LowTable = _mm_setr_epi8(UTF8_VALIDATION_BYTE_1_LOW);
+    const __m128i byte2HighTable = _mm_setr_epi8(UTF8_VALIDATION_BYTE_2_HIGH);
+    const __m128i lowNibble = _mm_set1_epi8(0x0F);
+    // Anything above these in the last three bytes starts a sequence that
+    // has to continue in the next block
+    const __m128i incompleteLimit = _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, (char)0xEF, (char)0xDF, (char)0xBF);
+    const __m128i controlLimit = _mm_set1_epi8(0x1F);
+    const __m128i deleteChar = _mm_set1_epi8(0x7F);
+    const __m128i tabChar = _mm_set1_epi8('\t');
+    const __m128i lineFeed = _mm_set1_epi8('\n');
+    const __m128i carriageReturn = _mm_set1_epi8('\r');
+    __m128i error = _mm_setzero_si128();
+    __m128i previous = _mm_setzero_si128();
+    __m128i previousIncomplete = _mm_setzero_si128();
+    unsigned char tail[16];
+    for (size_t i = 0; i < size; i += 16) {
+        __m128i input;
+        if (size - i >= 16) {
+            input = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+        }
+        else {
+            // Pad the tail with spaces, which are neither control
+            // characters nor part of a sequence
+            std::memset(tail, ' ', sizeof(tail));
+            std::memcpy(tail, data + i, size - i);
+            input = _mm_loadu_si128(reinterpret_cast<const __m128i*>(tail));
+        }
+
+        __m128i isControl = _mm_or_si128(_mm_cmpeq_epi8(_mm_min_epu8(input, controlLimit), input), _mm_cmpeq_epi8(input, deleteChar));
+        __m128i isAllowed = _mm_cmpeq_epi8(input, tabChar);
+        if (isMultiLine) {
+            isAllowed = _mm_or_si128(isAllowed, _mm_or_si128(_mm_cmpeq_epi8(input, lineFeed), _mm_cmpeq_epi8(input, carriageReturn)));
+        }
+        if (_mm_movemask_epi8(_mm_andnot_si128(isAllowed, isControl))) {
+            return false;
+        }
+        if (isMultiLine) {
+            uint32_t crMask = static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(input, carriageReturn)));
+            for (; crMask; crMask &= crMask - 1) {
+                size_t crIndex = i + std::countr_zero(crMask);
+                if (crIndex + 1 >= size || data[crIndex + 1] != '\n') {
+                    return false;
+                }
+            }
+        }
+
+        if (!_mm_movemask_epi8(input)) {
+            // ASCII only, a sequence left open by the previous block is cut short
+            error = _mm_or_si128(error, previousIncomplete);
+            previousIncomplete = _mm_setzero_si128();
+        }
+        else {
+            __m128i prev1 = _mm_alignr_epi8(input, previous, 15);
+            __m128i prev2 = _mm_alignr_epi8(input, previous, 14);
+            __m128i prev3 = _mm_alignr_epi8(input, previous, 13);
+            __m128i byte1High = _mm_shuffle_epi8(byte1HighTable, _mm_and_si128(_mm_srli_epi16(prev1, 4), lowNibble));
+            __m128i byte1Low = _mm_shuffle_epi8(byte1LowTable, _mm_and_si128(prev1, lowNibble));
+            __m128i byte2High = _mm_shuffle_epi8(byte2HighTable, _mm_and_si128(_mm_srli_epi16(input, 4), lowNibble));
+            __m128i specialCases = _mm_and_si128(_mm_and_si128(byte1High, byte1Low), byte2High);
+            __m128i isThirdByte = _mm_subs_epu8(prev2, _mm_set1_epi8((char)(0xE0 - 0x80)));
+            __m128i isFourthByte = _mm_subs_epu8(prev3, _mm_set1_epi8((char)(0xF0 - 0x80)));
+            __m128i mustBeContinuation = _mm_and_si128(_mm_or_si128(isThirdByte, isFourthByte), _mm_set1_epi8((char)0x80));
+            error = _mm_or_si128(error, _mm_xor_si128(mustBeContinuation, specialCases));
+            previousIncomplete = _mm_subs_epu8(input, incompleteLimit);
+        }
+        previous = input;
+    }
+    error = _mm_or_si128(error, previousIncomplete);
+    return _mm_testz_si128(error, error);
+}
+
+SIMD_TARGET("avx2")
+static bool isUtf8ContentValidAvx2(const unsigned char* data, size_t size, bool isMultiLine) {
+    using namespace Utf8Validation;
+    const __m256i byte1HighTable = _mm256_setr_epi8(UTF8_VALIDATION_BYTE_1_HIGH, UTF8_VALIDATION_BYTE_1_HIGH);
+    const __m256i byte1LowTable = _mm256_setr_epi8(UTF8_VALIDATION_BYTE_1_LOW, UTF8_VALIDATION_BYTE_1_LOW);
+    const __m256i byte2HighTable = _mm256_setr_epi8(UTF8_VALIDATION_BYTE_2_HIGH, UTF8_VALIDATION_BYTE_2_HIGH);
+    const __m256i lowNibble = _mm256_set1_epi8(0x0F);
+    const __m256i incompleteLimit = _mm256_setr_epi8(
+        -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+        -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, (char)0xEF, (char)0xDF, (char)0xBF);
+    const __m256i controlLimit = _mm256_set1_epi8(0x1F);
+    const __m256i deleteChar = _mm256_set1_epi8(0x7F);
+    const __m256i tabChar = _mm256_set1_epi8('\t');
+    const __m256i lineFeed = _mm256_set1_epi8('\n');
+    const __m256i carriageReturn = _mm256_set1_epi8('\r');
+    __m256i error = _mm256_setzero_si256();
+    __m256i previous = _mm256_setzero_si256();
+    __m256i previousIncomplete = _mm256_setzero_si256();
+    unsigned char tail[32];
+    for (size_t i = 0; i < size; i += 32) {
+        __m256i input;
+        if (size - i >= 32) {
+            input = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+        }
+        else {
+            std::memset(tail, ' ', sizeof(tail));
+            std::memcpy(tail, data + i, size - i);
+            input = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(tail));
+        }
+
+        __m256i isControl = _mm256_or_si256(_mm256_cmpeq_epi8(_mm256_min_epu8(input, controlLimit), input), _mm256_cmpeq_epi8(input, deleteChar));
+        __m256i isAllowed = _mm256_cmpeq_epi8(input, tabChar);
+        if (isMultiLine) {
+            isAllowed = _mm256_or_si256(isAllowed, _mm256_or_si256(_mm256_cmpeq_epi8(input, lineFeed), _mm256_cmpeq_epi8(input, carriageReturn)));
+        }
+        if (_mm256_movemask_epi8(_mm256_andnot_si256(isAllowed, isControl))) {
+            return false;
+        }
+        if (isMultiLine) {
+            uint32_t crMask = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(input, carriageReturn)));
+            for (; crMask; crMask &= crMask - 1) {
+                size_t crIndex = i + std::countr_zero(crMask);
+                if (crIndex + 1 >= size || data[crIndex + 1] != '\n') {
+                    return false;
+                }
+            }
+        }
+
+        if (!_mm256_movemask_epi8(input)) {
+            error = _mm256_or_si256(error, previousIncomplete);
+            previousIncomplete = _mm256_setzero_si256();
+        }
+        else {
+            // Shifting in bytes across the two 128-bit lanes takes a
+            // permute of the previous and current block first
+            __m256i crossed = _mm256_permute2x128_si256(previous, input, 0x21);
+            __m256i prev1 = _mm256_alignr_epi8(input, crossed, 15);
+            __m256i prev2 = _mm256_alignr_epi8(input, crossed, 14);
+            __m256i prev3 = _mm256_alignr_epi8(input, crossed, 13);
+            __m256i byte1High = _mm256_shuffle_epi8(byte1HighTable, _mm256_and_si256(_mm256_srli_epi16(prev1, 4), lowNibble));
+            __m256i byte1Low = _mm256_shuffle_epi8(byte1LowTable, _mm256_and_si256(prev1, lowNibble));
+            __m256i byte2High = _mm256_shuffle_epi8(byte2HighTable, _mm256_and_si256(_mm256_srli_epi16(input, 4), lowNibble));
+            __m256i specialCases = _mm256_and_si256(_mm256_and_si256(byte1High, byte1Low), byte2High);
+            __m256i isThirdByte = _mm256_subs_epu8(prev2, _mm256_set1_epi8((char)(0xE0 - 0x80)));
+            __m256i isFourthByte = _mm256_subs_epu8(prev3, _mm256_set1_epi8((char)(0xF0 - 0x80)));
+            __m256i mustBeContinuation = _mm256_and_si256(_mm256_or_si256(isThirdByte, isFourthByte), _mm256_set1_epi8((char)0x80));
+            error = _mm256_or_si256(error, _mm256_xor_si256(mustBeContinuation, specialCases));
+            previousIncomplete = _mm256_subs_epu8(input, incompleteLimit);
+        }
+        previous = input;
+    }
+    error = _mm256_or_si256(error, previousIncomplete);
+    return _mm256_testz_si256(error, error);
+}
+#endif
+
+using Utf8ContentValidator = bool (*)(const unsigned char* data, size_t size, bool isMultiLine);
+
+static Utf8ContentValidator selectUtf8ContentValidator() {
+#ifdef SIMD_X86
+    if (GetCpuFeatures().hasAvx2) {
+        return isUtf8ContentValidAvx2;
+    }
+    if (GetCpuFeatures().hasSse41) {
+        return isUtf8ContentValidSse;
+    }
+#endif
+    return isUtf8ContentValidScalar;
+}
+
+bool IsUtf8ContentValid(std::string_view content, bool isMultiLine) {
+    static const Utf8ContentValidator validator = selectUtf8ContentValidator();
+    const unsigned char* data = reinterpret_cast<const unsigned char*>(content.data());
+    // Most keys and values are shorter than a vector
+    if (content.size() < 16) {
+        return isUtf8ContentValidScalar(data, content.size(), isMultiLine);
+    }
+    return validator(data, content.size(), isMultiLine);
+}
+#endif
+
+#endif
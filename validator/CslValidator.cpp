@@ -6,7 +6,7 @@
 #include <sstream>
 #include <algorithm>
 #include <cmath>
-#include "../shared/CSLRepresentation.h"
+#include "../shared/CslRepresentation.h"
 #include "../shared/DocumentTree.h"
 #include "../shared/FilePosition.h"
 #include "../shared/TomlStringUtils.h"
@@ -17,11 +17,12 @@ namespace CSLValidator {
 
     class Validator {
     protected:
-        using Value = std::variant<double, bool, std::string, std::monostate>;
+        using Value = std::variant<double, bool, std::string, std::monostate, DateTimeValue>;
         enum class ValueType { Number, Boolean, String, Null };
 
         const std::shared_ptr<CSL::ConfigSchema> schema;
         const DocTree::Table* docRoot;
+        const DocTree::KeyInterner& keyInterner;
         ErrorWarningList errors;
         ErrorWarningList warnings;
         std::string currentPath;
@@ -34,6 +35,17 @@ namespace CSLValidator {
             warnings.emplace_back(message, region);
         }
 
+        // Find the key of a table by name. Table keys are interned by the
+        // document, so a name no key of the document has is rejected by the
+        // interner without looking at the table.
+        const DocTree::Key* findKey(const DocTree::Table* table, std::string_view name) const {
+            auto internedName = keyInterner.find(name);
+            if (!internedName.data()) return nullptr;
+            const auto& tableElems = table->getElems();
+            auto it = tableElems.find(internedName);
+            return it == tableElems.end() ? nullptr : it->second;
+        }
+
         // Resolve a path in the current document context
         const DocTree::DocTreeNode* resolvePath(const std::string& path, const DocTree::Table* context) const {
             const DocTree::Table* currentTable = context;
@@ -41,13 +53,12 @@ namespace CSLValidator {
             std::string segment;
 
             while (std::getline(iss, segment, '.')) {
-                auto currentTableElems = currentTable->getElems();
-                auto it = currentTableElems.find(segment);
-                if (it == currentTableElems.end()) return nullptr;
+                auto foundKey = findKey(currentTable, segment);
+                if (!foundKey) return nullptr;
 
-                if (auto keyNode = dynamic_cast<DocTree::Key*>(it->second)) {
-                    auto valueNode = std::get<1>(keyNode->get());
-                    if (auto table = dynamic_cast<DocTree::Table*>(valueNode)) {
+                if (auto keyNode = DocTree::nodeCast<DocTree::Key>(foundKey)) {
+                    auto valueNode = keyNode->getValue();
+                    if (auto table = DocTree::nodeCast<DocTree::Table>(valueNode)) {
                         currentTable = table;
                     }
                     else {
@@ -59,33 +70,30 @@ namespace CSLValidator {
         }
 
         FilePosition::Region getDocNodeDefPos(const DocTree::DocTreeNode* docNode) {
-            if (auto valueNode = dynamic_cast<const DocTree::Value*>(docNode)) {
-                return std::get<2>(valueNode->get());
-            }
-            else if (auto tableNode = dynamic_cast<const DocTree::Table*>(docNode)) {
-                return std::get<2>(tableNode->get());
-            }
-            else if (auto arrayNode = dynamic_cast<const DocTree::Array*>(docNode)) {
-                return std::get<2>(arrayNode->get());
-            }
-            else {
+            if (!docNode) {
                 return {};
             }
+            return DocTree::visit(DocTree::Overloaded{
+                [](const DocTree::Value* valueNode) { return valueNode->getDefPos(); },
+                [](const DocTree::Table* tableNode) { return tableNode->getDefPos(); },
+                [](const DocTree::Array* arrayNode) { return arrayNode->getDefPos(); },
+                [](const DocTree::Key*) { return FilePosition::Region{}; }
+            }, docNode);
         }
 
         bool validateType(const CSL::CSLType* schemaType, const DocTree::DocTreeNode* docNode, const std::string& path) {
             switch (schemaType->getKind()) {
             case CSL::CSLType::Kind::Primitive: {
                 auto primitiveType = static_cast<const CSL::PrimitiveType*>(schemaType);
-                if (auto valueNode = dynamic_cast<const DocTree::Value*>(docNode)) {
-                    return validatePrimitive(primitiveType, valueNode);
+                if (auto valueNode = DocTree::nodeCast<DocTree::Value>(docNode)) {
+                    return validatePrimitive(primitiveType, *valueNode);
                 }
                 addError("Expected " + path + " as a primitive value", getDocNodeDefPos(docNode));
                 return false;
             }
             case CSL::CSLType::Kind::Table: {
                 auto tableType = static_cast<const CSL::TableType*>(schemaType);
-                if (auto tableNode = dynamic_cast<const DocTree::Table*>(docNode)) {
+                if (auto tableNode = DocTree::nodeCast<DocTree::Table>(docNode)) {
                     return validateTable(tableType, tableNode, path);
                 }
                 addError("Expected " + path + " as a table", getDocNodeDefPos(docNode));
@@ -93,7 +101,7 @@ namespace CSLValidator {
             }
             case CSL::CSLType::Kind::Array: {
                 auto arrayType = static_cast<const CSL::ArrayType*>(schemaType);
-                if (auto arrayNode = dynamic_cast<const DocTree::Array*>(docNode)) {
+                if (auto arrayNode = DocTree::nodeCast<DocTree::Array>(docNode)) {
                     return validateArray(arrayType, arrayNode, path);
                 }
                 addError("Expected " + path + " as an array", getDocNodeDefPos(docNode));
@@ -104,14 +112,14 @@ namespace CSLValidator {
                 return validateUnion(unionType, docNode, path);
             }
             case CSL::CSLType::Kind::AnyTable: {
-                if (!dynamic_cast<const DocTree::Table*>(docNode)) {
+                if (!DocTree::nodeCast<DocTree::Table>(docNode)) {
                     addError("Expected " + path + " as an any table", getDocNodeDefPos(docNode));
                     return false;
                 }
                 return true;
             }
             case CSL::CSLType::Kind::AnyArray: {
-                if (!dynamic_cast<const DocTree::Array*>(docNode)) {
+                if (!DocTree::nodeCast<DocTree::Array>(docNode)) {
                     addError("Expected " + path + " as an any array", getDocNodeDefPos(docNode));
                     return false;
                 }
@@ -124,8 +132,42 @@ namespace CSLValidator {
             }
         }
 
-        bool validatePrimitive(const CSL::PrimitiveType* schemaType, const DocTree::Value* valueNode) {
-            Value actualValue = convertDocValue(valueNode);
+        // Elements of packed arrays are values without nodes, so only
+        // primitive types and unions of them match them.
+        bool validateType(const CSL::CSLType* schemaType, const DocTree::Array::PackedValue& value, const std::string& path) {
+            switch (schemaType->getKind()) {
+            case CSL::CSLType::Kind::Primitive:
+                return validatePrimitive(static_cast<const CSL::PrimitiveType*>(schemaType), value);
+            case CSL::CSLType::Kind::Table:
+                addError("Expected " + path + " as a table", value.getDefPos());
+                return false;
+            case CSL::CSLType::Kind::Array:
+                addError("Expected " + path + " as an array", value.getDefPos());
+                return false;
+            case CSL::CSLType::Kind::Union: {
+                for (const auto& memberType : static_cast<const CSL::UnionType*>(schemaType)->getMemberTypes()) {
+                    if (validateType(memberType.get(), value, path)) {
+                        return true;
+                    }
+                }
+                addError("Value of " + path + " doesn't match any union member type", value.getDefPos());
+                return false;
+            }
+            case CSL::CSLType::Kind::AnyTable:
+                addError("Expected " + path + " as an any table", value.getDefPos());
+                return false;
+            case CSL::CSLType::Kind::AnyArray:
+                addError("Expected " + path + " as an any array", value.getDefPos());
+                return false;
+            default:
+                addError("Unsupported type kind", schemaType->getRegion());
+                return false;
+            }
+        }
+
+        template <typename ValueType>
+        bool validatePrimitive(const CSL::PrimitiveType* schemaType, const ValueType& value) {
+            Value actualValue = convertDocValue(value);
             const auto& allowedValues = schemaType->getAllowedValues();
             std::vector<Value> allowedValuesActualValue;
             for (auto& allowedValue : allowedValues) {
@@ -136,7 +178,7 @@ namespace CSLValidator {
             // Check allowed values
             if (!allowedValues.empty()) {
                 if (std::find(allowedValuesActualValue.begin(), allowedValuesActualValue.end(), actualValue) == allowedValuesActualValue.end()) {
-                    addError("Value '" + std::get<1>(valueNode->get()) + "' not in allowed values", getDocNodeDefPos(valueNode));
+                    addError("Value '" + std::string(value.getValue()) + "' not in allowed values", value.getDefPos());
                     return false;
                 }
             }
@@ -144,35 +186,35 @@ namespace CSLValidator {
             auto annotaions = schemaType->getAnnotations();
             for (const auto& annotation : annotaions) {
                 if (!evaluateAnnotation(annotation, actualValue)) {
-                    addError("Failed to validate key against annotation '" + annotation.get()->getName() + "'.", getDocNodeDefPos(valueNode));
+                    addError("Failed to validate key against annotation '" + annotation.get()->getName() + "'.", value.getDefPos());
                     return false;
                 }
             }
 
             // Type validation
-            auto valueNodeType = std::get<0>(valueNode->get());
+            auto valueType = value.getType();
             switch (schemaType->getPrimitive()) {
             case CSL::PrimitiveType::Primitive::String:
-                if (!dynamic_cast<Type::String*>(valueNodeType)) {
-                    addError("Expected string value", getDocNodeDefPos(valueNode));
+                if (!Type::typeCast<Type::String>(valueType)) {
+                    addError("Expected string value", value.getDefPos());
                     return false;
                 }
                 break;
             case CSL::PrimitiveType::Primitive::Number:
-                if (!(dynamic_cast<Type::Integer*>(valueNodeType) || dynamic_cast<Type::Float*>(valueNodeType) || dynamic_cast<Type::SpecialNumber*>(valueNodeType))) {
-                    addError("Expected numeric value", getDocNodeDefPos(valueNode));
+                if (!(Type::typeCast<Type::Integer>(valueType) || Type::typeCast<Type::Float>(valueType) || Type::typeCast<Type::SpecialNumber>(valueType))) {
+                    addError("Expected numeric value", value.getDefPos());
                     return false;
                 }
                 break;
             case CSL::PrimitiveType::Primitive::Boolean:
-                if (!dynamic_cast<Type::Boolean*>(valueNodeType)) {
-                    addError("Expected boolean value", getDocNodeDefPos(valueNode));
+                if (!Type::typeCast<Type::Boolean>(valueType)) {
+                    addError("Expected boolean value", value.getDefPos());
                     return false;
                 }
                 break;
             case CSL::PrimitiveType::Primitive::Datetime:
-                if (!dynamic_cast<Type::DateTime*>(valueNodeType)) {
-                    addError("Expected datetime value", getDocNodeDefPos(valueNode));
+                if (!Type::typeCast<Type::DateTime>(valueType)) {
+                    addError("Expected datetime value", value.getDefPos());
                     return false;
                 }
                 break;
@@ -186,12 +228,14 @@ namespace CSLValidator {
             const auto& explicitKeys = schemaType->getExplicitKeys();
             const auto& wildcardKey = schemaType->getWildcardKey();
 
-            // Validate explicit keys
+            // Validate explicit keys, keeping their interned names to tell
+            // the other keys of the table apart by pointer
+            std::vector<std::string_view> explicitKeyNames;
             for (const auto& keyDef : explicitKeys) {
-                auto tableNodeElems = tableNode->getElems();
-                auto it = tableNodeElems.find(keyDef.name);
+                explicitKeyNames.push_back(keyInterner.find(keyDef.name));
+                auto foundKey = findKey(tableNode, keyDef.name);
                 std::string newPath = path + "." + keyDef.name;
-                if (it == tableNodeElems.end()) {
+                if (!foundKey) {
                     if (!keyDef.isOptional) {
                         addError("Missing required key: " + newPath, getDocNodeDefPos(tableNode));
                         valid = false;
@@ -199,14 +243,14 @@ namespace CSLValidator {
                     continue;
                 }
 
-                auto keyValueNode = std::get<1>(it->second->get());
+                auto keyValueNode = foundKey->getValue();
                 if (!validateType(keyDef.type.get(), keyValueNode, newPath)) {
                     valid = false;
                 }
 
                 if (keyDef.annotations.size()) {
                     for (const auto& annotation : keyDef.annotations) {
-                        if (!(dynamic_cast<DocTree::Value*>(keyValueNode) && evaluateAnnotation(annotation, convertDocValue((DocTree::Value*)keyValueNode)))) {
+                        if (!(DocTree::nodeCast<DocTree::Value>(keyValueNode) && evaluateAnnotation(annotation, convertDocValue(*(DocTree::Value*)keyValueNode)))) {
                             valid = false;
                             break;
                         }
@@ -216,19 +260,19 @@ namespace CSLValidator {
 
             // Validate wildcard keys
             for (const auto& [keyName, keyNode] : tableNode->getElems()) {
-                if (std::none_of(explicitKeys.begin(), explicitKeys.end(),
-                    [&](const auto& k) { return k.name == keyName; })) {
-                    auto keyValueNode = std::get<1>(keyNode->get());
+                if (std::none_of(explicitKeyNames.begin(), explicitKeyNames.end(),
+                    [&](std::string_view name) { return name.data() == keyName.data(); })) {
+                    auto keyValueNode = keyNode->getValue();
                     if (wildcardKey) {
                         std::string newPath = path + ".*";
                         if (!validateType(wildcardKey->type.get(), keyValueNode, newPath)) {
-                            addError("Key '" + path + "." + keyName + "' failed to match the type of the wildcard key",
+                            addError("Key '" + path + "." + std::string(keyName) + "' failed to match the type of the wildcard key",
                                 getDocNodeDefPos(keyValueNode));
                             valid = false;
                         }
                     }
                     else {
-                        addWarning("Key " + path + "." + keyName + " is not in the schema", getDocNodeDefPos(keyValueNode));
+                        addWarning("Key " + path + "." + std::string(keyName) + " is not in the schema", getDocNodeDefPos(keyValueNode));
                     }
                 }
             }
@@ -248,6 +292,15 @@ namespace CSLValidator {
             auto elementType = schemaType->getElementType();
             int index = 0;
 
+            if (arrayNode->getIsPacked()) {
+                for (size_t elemIndex = 0; elemIndex < arrayNode->size(); ++elemIndex) {
+                    std::string elemPath = path + "[" + std::to_string(index++) + "]";
+                    if (!validateType(elementType.get(), arrayNode->getPackedValue(elemIndex), elemPath)) {
+                        valid = false;
+                    }
+                }
+                return valid;
+            }
             for (auto elem : arrayNode->getElems()) {
                 std::string elemPath = path + "[" + std::to_string(index++) + "]";
                 if (!validateType(elementType.get(), elem, elemPath)) {
@@ -390,10 +443,15 @@ namespace CSLValidator {
         }
 
         Value convertDocValue(const Type::Type* type, const std::string& valueStr) {
-            if (dynamic_cast<const Type::String*>(type)) {
+            switch (type ? type->getKind() : Type::Type::Kind::Invalid) {
+            case Type::Type::Kind::String: {
                 return valueStr;
             }
-            else if (dynamic_cast<const Type::Integer*>(type)) {
+            case Type::Type::Kind::Integer: {
+                int64_t integer;
+                if (DocTree::Value::decodeInteger(valueStr, integer)) {
+                    return static_cast<double>(integer);
+                }
                 std::string cleaned = valueStr;
                 cleaned.erase(std::remove(cleaned.begin(), cleaned.end(), '_'), cleaned.end());
                 if (cleaned.empty()) return 0.0;
@@ -407,7 +465,11 @@ namespace CSLValidator {
                 }
                 catch (...) { return std::monostate{}; }
             }
-            else if (dynamic_cast<const Type::Float*>(type)) {
+            case Type::Type::Kind::Float: {
+                double number;
+                if (DocTree::Value::decodeFloat(valueStr, number)) {
+                    return number;
+                }
                 std::string cleaned = valueStr;
                 cleaned.erase(std::remove(cleaned.begin(), cleaned.end(), '_'), cleaned.end());
                 if (cleaned.empty()) return 0.0;
@@ -417,13 +479,17 @@ namespace CSLValidator {
                 try { return std::stod(cleaned); }
                 catch (...) { return std::monostate{}; }
             }
-            else if (dynamic_cast<const Type::Boolean*>(type)) {
+            case Type::Type::Kind::Boolean: {
                 return valueStr == "true";
             }
-            else if (dynamic_cast<const Type::DateTime*>(type)) {
+            case Type::Type::Kind::DateTime: {
+                DateTimeValue dateTime;
+                if (DocTree::Value::decodeDateTime(valueStr, dateTime)) {
+                    return dateTime;
+                }
                 return valueStr;
             }
-            else if (dynamic_cast<const Type::SpecialNumber*>(type)) {
+            case Type::Type::Kind::SpecialNumber: {
                 if (valueStr == "nan" || valueStr == "+nan") {
                     return std::numeric_limits<double>::quiet_NaN();
                 }
@@ -440,20 +506,36 @@ namespace CSLValidator {
                     return std::monostate{};
                 }
             }
-            return std::monostate{};
+            default:
+                return std::monostate{};
+            }
         }
 
-        Value convertDocValue(const DocTree::Value* valueNode) {
-            auto [typeInfo, valueStr, defPos] = valueNode->get();
-            return convertDocValue(typeInfo, valueStr);
+        // Use the decoded payload of a value node or of an element of a
+        // packed array, if any, and parse the literal otherwise.
+        template <typename ValueType>
+        Value convertDocValue(const ValueType& value) {
+            if (auto integer = value.getInteger()) {
+                return static_cast<double>(*integer);
+            }
+            if (auto number = value.getFloat()) {
+                return *number;
+            }
+            if (auto boolean = value.getBoolean()) {
+                return *boolean;
+            }
+            if (auto dateTime = value.getDateTime()) {
+                return *dateTime;
+            }
+            return convertDocValue(value.getType(), std::string(value.getValue()));
         }
 
         Value resolveKeyValue(const std::string& path, const DocTree::Table* context) {
             const DocTree::DocTreeNode* node = resolvePath(path, context);
             if (!node) return std::monostate{};
 
-            if (auto valueNode = dynamic_cast<const DocTree::Value*>(node)) {
-                return convertDocValue(valueNode);
+            if (auto valueNode = DocTree::nodeCast<DocTree::Value>(node)) {
+                return convertDocValue(*valueNode);
             }
             return true; // Exists but not a value node
         }
@@ -462,31 +544,18 @@ namespace CSLValidator {
             // Handle null cases
             if (!a || !b) return a == b;
 
-            // Value comparison
-            if (auto aVal = dynamic_cast<DocTree::Value*>(a)) {
-                if (auto bVal = dynamic_cast<DocTree::Value*>(b)) {
-                    return compareValues(convertDocValue(aVal), convertDocValue(bVal), true);
-                }
-                return false;
-            }
+            if (a->getKind() != b->getKind()) return false;
 
-            // Table comparison
-            if (auto aTable = dynamic_cast<DocTree::Table*>(a)) {
-                if (auto bTable = dynamic_cast<DocTree::Table*>(b)) {
-                    return compareTables(aTable, bTable);
-                }
-                return false;
-            }
-
-            // Array comparison
-            if (auto aArray = dynamic_cast<DocTree::Array*>(a)) {
-                if (auto bArray = dynamic_cast<DocTree::Array*>(b)) {
-                    return compareArrays(aArray, bArray);
-                }
+            switch (a->getKind()) {
+            case DocTree::DocTreeNode::Kind::Value:
+                return compareValues(convertDocValue(*static_cast<DocTree::Value*>(a)), convertDocValue(*static_cast<DocTree::Value*>(b)), true);
+            case DocTree::DocTreeNode::Kind::Table:
+                return compareTables(static_cast<DocTree::Table*>(a), static_cast<DocTree::Table*>(b));
+            case DocTree::DocTreeNode::Kind::Array:
+                return compareArrays(static_cast<DocTree::Array*>(a), static_cast<DocTree::Array*>(b));
+            default:
                 return false;
             }
-
-            return false;
         }
 
         bool compareTables(const DocTree::Table* a, const DocTree::Table* b) {
@@ -496,23 +565,38 @@ namespace CSLValidator {
             // Check all keys in A exist in B with matching values
             for (const auto& [key, aNode] : aElems) {
                 auto bIt = bElems.find(key);
-                if (bIt == bElems.end() || !deepCompare(std::get<1>(aNode->get()), std::get<1>(bIt->second->get()))) {
+                if (bIt == bElems.end() || !deepCompare(aNode->getValue(), bIt->second->getValue())) {
                     return false;
                 }
             }
             return true;
         }
 
-        bool compareArrays(const DocTree::Array* a, const DocTree::Array* b) {
-            const auto& aItems = a->getElems();
-            const auto& bItems = b->getElems();
+        // Elements of packed arrays are compared by their payloads, without
+        // making nodes of them
+        bool compareArrayElems(const DocTree::Array* a, size_t aIndex, const DocTree::Array* b, size_t bIndex) {
+            if (!a->getIsPacked() && !b->getIsPacked()) {
+                return deepCompare(a->getElems()[aIndex], b->getElems()[bIndex]);
+            }
+            auto valueOf = [this](const DocTree::Array* array, size_t index) -> std::optional<Value> {
+                if (array->getIsPacked()) {
+                    return convertDocValue(array->getPackedValue(index));
+                }
+                auto valueNode = DocTree::nodeCast<DocTree::Value>(array->getElems()[index]);
+                return valueNode ? std::optional<Value>(convertDocValue(*valueNode)) : std::nullopt;
+            };
+            auto aValue = valueOf(a, aIndex);
+            auto bValue = valueOf(b, bIndex);
+            return aValue && bValue && compareValues(*aValue, *bValue, true);
+        }
 
+        bool compareArrays(const DocTree::Array* a, const DocTree::Array* b) {
             // Check array lengths if order matters
             // For subset semantics, check all elements exist regardless of order
-            for (auto aItem : aItems) {
+            for (size_t aIndex = 0; aIndex < a->size(); ++aIndex) {
                 bool found = false;
-                for (auto bItem : bItems) {
-                    if (deepCompare(aItem, bItem)) {
+                for (size_t bIndex = 0; bIndex < b->size(); ++bIndex) {
+                    if (compareArrayElems(a, aIndex, b, bIndex)) {
                         found = true;
                         break;
                     }
@@ -524,13 +608,13 @@ namespace CSLValidator {
 
         bool evaluateSubsetFunction(const std::vector<std::variant<DocTree::DocTreeNode*, std::vector<std::string>>>& args) {
             try {
-                // Extract array elements
-                std::vector<DocTree::DocTreeNode*> sourceElements;
-                std::vector<DocTree::DocTreeNode*> targetElements;
+                // Extract arrays
+                const DocTree::Array* sourceArray = nullptr;
+                const DocTree::Array* targetArray = nullptr;
 
                 if (auto firstArg = *std::get_if<DocTree::DocTreeNode*>(&args[0])) {
-                    if (auto arrayNode = dynamic_cast<DocTree::Array*>(firstArg)) {
-                        sourceElements = arrayNode->getElems();
+                    if (auto arrayNode = DocTree::nodeCast<DocTree::Array>(firstArg)) {
+                        sourceArray = arrayNode;
                     }
                     else {
                         errors.push_back({ "First argument of subset must be an array", getDocNodeDefPos(firstArg) });
@@ -543,8 +627,8 @@ namespace CSLValidator {
                 }
 
                 if (auto secondArg = *std::get_if<DocTree::DocTreeNode*>(&args[1])) {
-                    if (auto arrayNode = dynamic_cast<DocTree::Array*>(secondArg)) {
-                        targetElements = arrayNode->getElems();
+                    if (auto arrayNode = DocTree::nodeCast<DocTree::Array>(secondArg)) {
+                        targetArray = arrayNode;
                     }
                     else {
                         errors.push_back({ "Second argument of subset must be an array", getDocNodeDefPos(secondArg) });
@@ -557,7 +641,7 @@ namespace CSLValidator {
                 }
 
                 // Handle empty source array
-                if (sourceElements.empty()) return true;
+                if (!sourceArray->size()) return true;
 
                 // Get comparison properties if specified
                 std::vector<std::string> properties;
@@ -572,20 +656,26 @@ namespace CSLValidator {
                 }
 
                 // Validate each source element
-                for (DocTree::DocTreeNode* sourceElem : sourceElements) {
+                for (size_t sourceIndex = 0; sourceIndex < sourceArray->size(); ++sourceIndex) {
                     bool found = false;
 
                     if (properties.empty()) {
-                        for (DocTree::DocTreeNode* targetElem : targetElements) {
-                            if (deepCompare(sourceElem, targetElem)) {
+                        for (size_t targetIndex = 0; targetIndex < targetArray->size(); ++targetIndex) {
+                            if (compareArrayElems(sourceArray, sourceIndex, targetArray, targetIndex)) {
                                 found = true;
                                 break;
                             }
                         }
                     }
                     else {
-                        // Object property comparison
-                        const DocTree::Table* sourceObj = dynamic_cast<DocTree::Table*>(sourceElem);
+                        // Object property comparison. Packed arrays hold
+                        // values only, so none of their elements is one.
+                        if (sourceArray->getIsPacked()) {
+                            errors.push_back({ "Source element is not an object", sourceArray->getPackedValue(sourceIndex).getDefPos() });
+                            return false;
+                        }
+                        DocTree::DocTreeNode* sourceElem = sourceArray->getElems()[sourceIndex];
+                        const DocTree::Table* sourceObj = DocTree::nodeCast<DocTree::Table>(sourceElem);
                         if (!sourceObj) {
                             errors.push_back({ "Source element is not an object", getDocNodeDefPos(sourceElem) });
                             return false;
@@ -603,8 +693,8 @@ namespace CSLValidator {
                         }
 
                         // Check against target objects
-                        for (DocTree::DocTreeNode* targetElem : targetElements) {
-                            const DocTree::Table* targetObj = dynamic_cast<DocTree::Table*>(targetElem);
+                        for (DocTree::DocTreeNode* targetElem : targetArray->getElems()) {
+                            const DocTree::Table* targetObj = DocTree::nodeCast<DocTree::Table>(targetElem);
                             if (!sourceObj) {
                                 errors.push_back({ "Target element is not an object", getDocNodeDefPos(targetElem) });
                                 return false;
@@ -666,14 +756,14 @@ namespace CSLValidator {
             try {
                 if (funcName == "count_keys") {
                     auto arg = *std::get_if<DocTree::DocTreeNode*>(&argValues[0]);
-                    if (auto table = dynamic_cast<DocTree::Table*>(arg)) {
+                    if (auto table = DocTree::nodeCast<DocTree::Table>(arg)) {
                         return static_cast<double>(table->getElems().size());
                     }
                 }
                 else if (funcName == "all_keys") {
                     auto arg = *std::get_if<DocTree::DocTreeNode*>(&argValues[0]);
                     std::vector<DocTree::DocTreeNode*> keys;
-                    if (auto table = dynamic_cast<DocTree::Table*>(arg)) {
+                    if (auto table = DocTree::nodeCast<DocTree::Table>(arg)) {
                         for (const auto& [_, key] : table->getElems()) {
                             keys.push_back(key);
                         }
@@ -694,6 +784,10 @@ namespace CSLValidator {
         }
 
         bool evaluateAnnotation(const std::shared_ptr<CSL::Annotation>& annotation, const Value& targetValue) {
+            // String annotations see date-times as their normalized text
+            if (auto dateTime = std::get_if<DateTimeValue>(&targetValue)) {
+                return evaluateAnnotation(annotation, Value(FormatDateTime(*dateTime)));
+            }
             auto annotationName = annotation->getName();
             if (annotationName == "regex") {
                 auto pattern = std::get<std::string>(evaluateExprValue(annotation->getArgs()[0], nullptr));
@@ -810,8 +904,8 @@ namespace CSLValidator {
                 if (funcCall->getFuncName() == "all_keys" && std::holds_alternative<std::vector<DocTree::DocTreeNode*>>(funcCallValue)) {
                     auto keys = std::get<std::vector<DocTree::DocTreeNode*>>(funcCallValue);
                     for (auto& key : keys) {
-                        if (auto keyNode = dynamic_cast<DocTree::Key*>(key)) {
-                            targetValues.push_back(std::get<0>(keyNode->get()));
+                        if (auto keyNode = DocTree::nodeCast<DocTree::Key>(key)) {
+                            targetValues.push_back(std::string(keyNode->getId()));
                         }
                         else {
                             errors.push_back({ "Invalid key from all_keys function", getDocNodeDefPos(key) });
@@ -965,6 +1059,20 @@ namespace CSLValidator {
                 if (op == "<=") return l <= r;
                 if (op == ">=") return l >= r;
             }
+            else if (std::holds_alternative<DateTimeValue>(lhs)) {
+                // Only date-times of one kind are ordered
+                const auto& l = std::get<DateTimeValue>(lhs);
+                const auto& r = std::get<DateTimeValue>(rhs);
+                if (l.kind == r.kind) {
+                    if (op == "<") return l < r;
+                    if (op == ">") return r < l;
+                    if (op == "<=") return !(r < l);
+                    if (op == ">=") return !(l < r);
+                }
+                else if (op == "<" || op == ">" || op == "<=" || op == ">=") {
+                    return false;
+                }
+            }
 
             if (op == "&&") return convertToBool(lhs) && convertToBool(rhs);
             if (op == "||") return convertToBool(lhs) || convertToBool(rhs);
@@ -995,6 +1103,11 @@ namespace CSLValidator {
                 std::string strB = std::get<std::string>(b);
                 return checkEquality ? (strA == strB) : (strA != strB);
             }
+            if (std::holds_alternative<DateTimeValue>(a)) {
+                const auto& dateTimeA = std::get<DateTimeValue>(a);
+                const auto& dateTimeB = std::get<DateTimeValue>(b);
+                return checkEquality ? (dateTimeA == dateTimeB) : (dateTimeA != dateTimeB);
+            }
             return false;
         }
 
@@ -1002,6 +1115,7 @@ namespace CSLValidator {
             if (std::holds_alternative<bool>(value)) return std::get<bool>(value);
             if (std::holds_alternative<double>(value)) return std::get<double>(value) != 0;
             if (std::holds_alternative<std::string>(value)) return !std::get<std::string>(value).empty();
+            if (std::holds_alternative<DateTimeValue>(value)) return true;
             return false;
         }
 
@@ -1018,8 +1132,8 @@ namespace CSLValidator {
         }
 
     public:
-        Validator(const std::shared_ptr<CSL::ConfigSchema> schema, const DocTree::Table* docRoot)
-            : schema(schema), docRoot(docRoot) {
+        Validator(const std::shared_ptr<CSL::ConfigSchema> schema, const DocTree::Document* document)
+            : schema(schema), docRoot(document->getRoot()), keyInterner(document->getKeyInterner()) {
         }
 
         std::tuple<ErrorWarningList, ErrorWarningList> validate() {
@@ -1031,9 +1145,9 @@ namespace CSLValidator {
 
 } // namespace CSLValidator
 
-std::tuple<std::vector<std::tuple<std::string, FilePosition::Region>>, std::vector<std::tuple<std::string, FilePosition::Region>>> CslValidatorMain(std::string schemaName, std::vector<std::shared_ptr<CSL::ConfigSchema>> schemas, DocTree::Table* docTree) {
+std::tuple<std::vector<std::tuple<std::string, FilePosition::Region>>, std::vector<std::tuple<std::string, FilePosition::Region>>> CslValidatorMain(std::string schemaName, std::vector<std::shared_ptr<CSL::ConfigSchema>> schemas, const DocTree::Document* document) {
     if (schemaName.empty() && schemas.size() == 1) {
-        CSLValidator::Validator validator(schemas[0], docTree);
+        CSLValidator::Validator validator(schemas[0], document);
         return validator.validate();
     }
 
@@ -1046,7 +1160,7 @@ std::tuple<std::vector<std::tuple<std::string, FilePosition::Region>>, std::vect
     }
 
     if (schema) {
-        CSLValidator::Validator validator(schema, docTree);
+        CSLValidator::Validator validator(schema, document);
         return validator.validate();
     }
     return { { { "Cannot find config schema " + schemaName, {} } }, {} };